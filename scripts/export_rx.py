@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+
+"""Receive a bulk export of the record log (src/app_export.c) and append it to a file.
+
+The output file holds the record frames as received, CRC checked. When it already
+holds records, the export resumes after the last one, so an interrupted dump is
+continued by running the same command again:
+
+    scripts/export_rx.py /dev/pts/3 log.bin            # native_sim, second pty
+    scripts/export_rx.py /dev/ttyACM0 log.bin -b 1000000
+
+A frame lost on the line, a CRC failure or a record that does not follow the
+previous one, stops the writing: the rest of the stream is dropped and asked for
+again from the lost record, so the file never holds a hole. Records the device no
+longer has are flagged by it and accepted.
+"""
+
+import argparse
+import os
+import struct
+import sys
+import termios
+import time
+import tty
+import zlib
+
+REQUEST_MAGIC = 0x52585336          # "6SXR"
+FRAME_MAGIC = 0x46585336            # "6SXF"
+FRAME_RECORD = 1
+FRAME_END = 2
+FLAG_GAP = 0x01                     # the device skipped records before this one
+
+# magic, type, flags, length, seq, time_ms
+FRAME_HDR = struct.Struct("<IBBHIQ")
+FRAME_CRC_SIZE = 4
+MAGIC_BYTES = struct.pack("<I", FRAME_MAGIC)
+# requests again after a lost frame, without any record written in between
+MAX_REREQUESTS = 3
+
+
+def parse_frame(buf, pos):
+    """Return (frame, next position) for the frame at pos, (None, pos) if incomplete,
+    (False, pos) if the bytes at pos are not a valid frame."""
+    if len(buf) - pos < FRAME_HDR.size:
+        return None, pos
+    magic, ftype, flags, length, seq, time_ms = FRAME_HDR.unpack_from(buf, pos)
+    if magic != FRAME_MAGIC or ftype not in (FRAME_RECORD, FRAME_END):
+        return False, pos
+    end = pos + FRAME_HDR.size + length + FRAME_CRC_SIZE
+    if len(buf) < end:
+        return None, pos
+    (crc,) = struct.unpack_from("<I", buf, end - FRAME_CRC_SIZE)
+    if zlib.crc32(buf[pos:end - FRAME_CRC_SIZE]) != crc:
+        return False, pos
+    return (ftype, seq, time_ms, bytes(buf[pos:end]), flags), end
+
+
+def last_record_seq(path):
+    """Sequence number of the last complete record of an earlier export, or None."""
+    if not os.path.exists(path):
+        return None
+    with open(path, "rb") as f:
+        buf = f.read()
+    last, pos = None, 0
+    while True:
+        frame, pos = parse_frame(buf, pos)
+        if not frame:
+            break
+        last = frame[1]
+    if pos != len(buf):
+        # a frame cut short by the interruption, dropped and received again
+        with open(path, "r+b") as f:
+            f.truncate(pos)
+    return last
+
+
+def send_request(fd, start):
+    request = struct.pack("<II", REQUEST_MAGIC, start)
+    os.write(fd, request + struct.pack("<I", zlib.crc32(request)))
+
+
+def open_port(path, baud):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    os.set_blocking(fd, False)
+    if baud:
+        attrs = termios.tcgetattr(fd)
+        speed = getattr(termios, "B%d" % baud)
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="export UART: pty of native_sim or serial device")
+    parser.add_argument("output", help="file receiving the record frames")
+    parser.add_argument("-b", "--baud", type=int, default=0,
+                        help="line speed of a real UART (ptys have none)")
+    parser.add_argument("-s", "--start", type=int,
+                        help="first record to ask for, instead of resuming the file")
+    parser.add_argument("-t", "--timeout", type=float, default=5.0,
+                        help="seconds of silence before giving up")
+    args = parser.parse_args()
+
+    start = args.start
+    if start is None:
+        last = last_record_seq(args.output)
+        start = 0 if last is None else (last + 1) & 0xFFFFFFFF
+
+    fd = open_port(args.port, args.baud)
+    send_request(fd, start)
+
+    buf = bytearray()
+    records = errors = received = 0
+    next_seq = start
+    # a frame was lost: nothing is written until the stream restarts at next_seq
+    lost = False
+    rerequests = 0
+    t0 = time.monotonic()
+    last_rx = t0
+    done = False
+
+    with open(args.output, "ab") as out:
+        while not done:
+            try:
+                chunk = os.read(fd, 65536)
+            except BlockingIOError:
+                chunk = b""
+            if chunk:
+                buf += chunk
+                received += len(chunk)
+                last_rx = time.monotonic()
+            elif time.monotonic() - last_rx > args.timeout:
+                break
+            else:
+                time.sleep(0.01)
+                continue
+
+            pos = 0
+            while not done:
+                frame, end = parse_frame(buf, pos)
+                if frame is None:
+                    break
+                if frame is False:
+                    # resynchronize on the next magic. the bytes skipped may have held a
+                    # record, the following ones are not written
+                    errors += 1
+                    lost = True
+                    nxt = buf.find(MAGIC_BYTES, pos + 1)
+                    pos = nxt if nxt >= 0 else max(len(buf) - 3, pos + 1)
+                    continue
+                ftype, seq, _, raw, flags = frame
+                pos = end
+                if not lost and seq != next_seq and not flags & FLAG_GAP:
+                    # a whole frame went missing between two good ones, or before the end
+                    errors += 1
+                    lost = True
+                if ftype == FRAME_RECORD:
+                    if not lost:
+                        out.write(raw)
+                        records += 1
+                        rerequests = 0
+                        next_seq = (seq + 1) & 0xFFFFFFFF
+                elif not lost:
+                    next_seq = seq
+                    done = True
+                elif rerequests < MAX_REREQUESTS:
+                    # the device listens again once its stream ended
+                    print("frame lost, asking again from record %d" % next_seq)
+                    rerequests += 1
+                    lost = False
+                    send_request(fd, next_seq)
+                else:
+                    break
+            del buf[:pos]
+            out.flush()
+            if lost and rerequests >= MAX_REREQUESTS:
+                break
+
+    os.close(fd)
+    elapsed = max(time.monotonic() - t0, 1e-6)
+    print("%d records from %d, %d bytes in %.2f s (%.0f B/s), %d framing errors"
+          % (records, start, received, elapsed, received / elapsed, errors))
+    if not done:
+        # the file ends with the last record before the loss, a rerun resumes there
+        print("interrupted, run again to resume at record %d" % next_seq)
+        return 1
+    print("complete, next export starts at record %d" % next_seq)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
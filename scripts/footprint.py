@@ -0,0 +1,255 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+
+"""RAM and ROM footprint per module, from the GNU ld map of a build.
+
+The application modules (src/app_*.c) are listed one by one, the Zephyr and
+toolchain libraries one line each. Initialized data counts in both RAM and ROM.
+The build runs it after each link and writes build/footprint.txt:
+
+    scripts/footprint.py build/zephyr/zephyr.map
+    scripts/footprint.py build/zephyr/zephyr.map --objects -s rom
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# sections that take no space in the image
+SKIP_PREFIXES = (".debug", ".comment", ".ARM.attributes", ".stab", ".gnu.attributes",
+                 ".symtab", ".strtab", ".shstrtab", "/DISCARD/")
+# regions of the map that are not memories: the linker default, and the interrupt list
+# Zephyr only links into the intermediate image
+SKIP_REGIONS = ("*default*", "IDT_LIST")
+# RAM only sections, whatever their load address
+RAM_ONLY = (".bss", ".sbss", ".noinit", "COMMON", ".tbss")
+
+APP_LIBRARY = "libapp.a"
+
+HEX = r"0x([0-9a-fA-F]+)"
+OUT_SECTION = re.compile(r"^(\S+)(?:\s+%s\s+%s(?:\s+load address %s)?)?\s*$" % (HEX, HEX, HEX))
+OUT_ADDRESSES = re.compile(r"^\s+%s\s+%s(?:\s+load address %s)?\s*$" % (HEX, HEX, HEX))
+IN_SECTION = re.compile(r"^ (\S+)(?:\s+%s\s+%s(?:\s+(.+?))?)?\s*$" % (HEX, HEX))
+IN_ADDRESSES = re.compile(r"^\s+%s\s+%s(?:\s+(.+?))?\s*$" % (HEX, HEX))
+REGION = re.compile(r"^(\S+)\s+%s\s+%s(?:\s+(\S+))?\s*$" % (HEX, HEX))
+MEMBER = re.compile(r"^(.*)\(([^()]+)\)$")
+
+
+class Region:
+    def __init__(self, name, origin, length, attrs):
+        self.name = name
+        self.origin = origin
+        self.length = length
+        upper = name.upper()
+        self.ram = "RAM" in upper or ("w" in attrs.lower() and "FLASH" not in upper)
+        self.used = 0
+
+    def contains(self, address):
+        return self.origin <= address < self.origin + self.length
+
+
+def object_stem(name):
+    for suffix in (".c.obj", ".cpp.obj", ".S.obj", ".obj", ".o"):
+        if name.endswith(suffix):
+            return name[:-len(suffix)]
+    return name
+
+
+def module_of(obj, per_object):
+    """(application?, module name) of an input file of the map."""
+    if obj is None:
+        # alignment fill, or data created by the linker script
+        return False, "(linker)"
+    m = MEMBER.match(obj)
+    if not m:
+        return False, object_stem(os.path.basename(obj))
+    library = os.path.basename(m.group(1))
+    member = object_stem(m.group(2))
+    if library == APP_LIBRARY:
+        return True, member
+    if library.startswith("lib"):
+        library = library[3:]
+    if library.endswith(".a"):
+        library = library[:-2]
+    return False, "%s/%s" % (library, member) if per_object else library
+
+
+def parse_map(path, per_object):
+    with open(path, errors="replace") as f:
+        lines = f.read().splitlines()
+
+    regions = []
+    start = 0
+    for i, line in enumerate(lines):
+        if line.startswith("Memory Configuration"):
+            for entry in lines[i + 1:]:
+                if entry.startswith("Linker script and memory map"):
+                    break
+                m = REGION.match(entry)
+                if m and m.group(1) not in SKIP_REGIONS and m.group(1) != "Name":
+                    regions.append(Region(m.group(1), int(m.group(2), 16),
+                                          int(m.group(3), 16), m.group(4) or ""))
+        if line.startswith("Linker script and memory map"):
+            start = i + 1
+            break
+
+    def region_of(address):
+        for region in regions:
+            if region.contains(address):
+                return region
+        return None
+
+    modules = {}
+    out_name = None
+    out_vma = out_lma = 0
+    pending = None              # input section name waiting for its addresses
+    pending_out = None          # output section name waiting for its addresses
+
+    def placement(section, vma, lma):
+        """(region of the address, region of the load image or None)."""
+        ram_only = section.startswith(RAM_ONLY) or out_name.startswith(RAM_ONLY)
+        vma_region = region_of(vma)
+        lma_region = None if ram_only or lma == vma else region_of(lma)
+        return vma_region, lma_region
+
+    def output_section(name, vma, size, lma):
+        nonlocal out_name, out_vma, out_lma
+        out_name, out_vma, out_lma = name, vma, lma
+        if size == 0 or name.startswith(SKIP_PREFIXES):
+            return
+        vma_region, lma_region = placement(name, vma, lma)
+        if vma_region is not None:
+            vma_region.used += size
+            if lma_region is not None and lma_region is not vma_region:
+                lma_region.used += size
+
+    def account(section, vma, size, obj):
+        if size == 0 or out_name is None or out_name.startswith(SKIP_PREFIXES):
+            return
+        if regions:
+            vma_region, lma_region = placement(section, vma, vma + (out_lma - out_vma))
+            if vma_region is None:
+                return
+            in_ram = vma_region.ram
+            in_rom = (not vma_region.ram) or (lma_region is not None and not lma_region.ram)
+        else:
+            # no MEMORY in the linker script (native_sim): by section name
+            ram_only = section.startswith(RAM_ONLY) or out_name.startswith(RAM_ONLY)
+            if vma == 0:
+                return
+            data = section.startswith((".data", ".sdata", ".tdata")) or \
+                out_name.startswith((".data", ".tdata"))
+            in_ram = ram_only or data
+            in_rom = not ram_only
+        app, name = module_of(obj, per_object)
+        entry = modules.setdefault(name, [app, 0, 0])
+        if in_rom:
+            entry[1] += size
+        if in_ram:
+            entry[2] += size
+
+    for line in lines[start:]:
+        if not line.strip():
+            continue
+        if pending_out is not None:
+            m = OUT_ADDRESSES.match(line)
+            if m:
+                vma = int(m.group(1), 16)
+                output_section(pending_out, vma, int(m.group(2), 16),
+                               int(m.group(3), 16) if m.group(3) else vma)
+                pending_out = None
+                continue
+            pending_out = None
+        if pending is not None:
+            m = IN_ADDRESSES.match(line)
+            pending_name, pending = pending, None
+            if m:
+                account(pending_name, int(m.group(1), 16), int(m.group(2), 16), m.group(3))
+                continue
+        if not line[0].isspace():
+            m = OUT_SECTION.match(line)
+            if not m or line.startswith(("LOAD ", "OUTPUT(", "START GROUP", "END GROUP")):
+                continue
+            if m.group(2) is None:
+                pending_out = m.group(1)
+            else:
+                vma = int(m.group(2), 16)
+                output_section(m.group(1), vma, int(m.group(3), 16),
+                               int(m.group(4), 16) if m.group(4) else vma)
+            continue
+        m = IN_SECTION.match(line)
+        if not m or m.group(1).startswith("*("):
+            continue
+        if m.group(2) is None:
+            pending = m.group(1)
+        else:
+            account(m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4))
+
+    return modules, regions
+
+
+def report(modules, regions, sort_key):
+    key = {"ram": lambda kv: (-kv[1][2], -kv[1][1], kv[0]),
+           "rom": lambda kv: (-kv[1][1], -kv[1][2], kv[0]),
+           "name": lambda kv: kv[0]}[sort_key]
+    out = []
+    width = max([len(name) for name in modules] + [24])
+    row = "%-" + str(width) + "s %9s %9s"
+
+    for app, title in ((True, "application"), (False, "zephyr and libraries")):
+        items = sorted([kv for kv in modules.items() if kv[1][0] == app], key=key)
+        if not items:
+            continue
+        out.append(row % (title, "ROM", "RAM"))
+        for name, (_, rom, ram) in items:
+            if rom or ram:
+                out.append(row % ("  " + name, rom, ram))
+        out.append(row % ("  total", sum(v[1] for _, v in items), sum(v[2] for _, v in items)))
+        out.append("")
+
+    out.append(row % ("image", sum(v[1] for v in modules.values()),
+                      sum(v[2] for v in modules.values())))
+    for region in regions:
+        if region.used == 0:
+            continue
+        out.append("%s: %d of %d bytes used (%.1f %%), %d free"
+                   % (region.name, region.used, region.length,
+                      100.0 * region.used / region.length, region.length - region.used))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("map", help="linker map, build/zephyr/zephyr.map")
+    parser.add_argument("-o", "--output", help="write the report there, print the totals only")
+    parser.add_argument("--objects", action="store_true",
+                        help="one line per object of the libraries too")
+    parser.add_argument("-s", "--sort", choices=("ram", "rom", "name"), default="ram")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.map):
+        # a build without a map (linker option disabled) is not an error
+        print("footprint: no linker map at %s" % args.map)
+        return 0
+
+    modules, regions = parse_map(args.map, args.objects)
+    lines = report(modules, regions, args.sort)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write("\n".join(lines) + "\n")
+        totals = [line for line in lines if line.startswith("image")]
+        totals += [line for line in lines if ": " in line and "bytes used" in line]
+        print("footprint (%s): %s" % (args.output, "; ".join(" ".join(t.split()) for t in totals)))
+    else:
+        print("\n".join(lines))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
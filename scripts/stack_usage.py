@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2025
+# Regis Rousseau
+# Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+# SPDX-License-Identifier: Apache-2.0
+
+"""Worst-case stack depth of each application thread, from the GCC call graphs.
+
+The application sources are built with -fcallgraph-info=su, which writes next to
+each object a .ci file holding the frame size of every function and its calls.
+The deepest path from the entry functions of a thread gives the stack the
+application code can take on it. Calls into Zephyr, the drivers and the C library
+are not in the graphs: they are listed per thread, their frames and the exception
+frame come on top. The build runs it after each link and writes
+build/stack_usage.txt:
+
+    scripts/stack_usage.py build/CMakeFiles/app.dir
+    scripts/stack_usage.py build/CMakeFiles/app.dir --paths
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# the stack of each option and the functions that run on it
+THREADS = (
+    ("CONFIG_APP_ACQ_STACK_SIZE", ("geo_acq_thread", "adc_stream_thread")),
+    ("CONFIG_APP_STORAGE_STACK_SIZE", ("storage_thread",)),
+    ("CONFIG_APP_HOUSEKEEPING_STACK_SIZE", ("hk_sync_handler", "ds3231_xfer_work",
+                                            "flash_log_erase_handler",
+                                            "flash_wbuf_flush_work", "uplink_handler")),
+    ("CONFIG_APP_EXPORT_STACK_SIZE", ("export_thread", "export_tx_thread")),
+)
+# calls through function pointers, caller and the functions main() installs there
+INDIRECT = {
+    "trigger_flush": ("event_sink",),
+    "app_spectrum_process": ("spectrum_sink",),
+    "flash_log_erase_handler": ("storage_busy",),
+    "app_uplink_flush": ("mock_send", "mock_max_payload"),
+}
+
+NODE = re.compile(r'^node: \{ title: "([^"]+)" label: "([^"\\]+)(?:\\n[^"]*?)?'
+                  r'(?:\\n(\d+) bytes \(([^)]*)\))?"')
+EDGE = re.compile(r'^edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+
+
+class Function:
+    def __init__(self, name, size, qualifier):
+        self.name = name
+        self.size = size
+        self.dynamic = "dynamic" in qualifier and "bounded" not in qualifier
+        self.calls = []
+
+
+def parse_graphs(directory):
+    functions = {}              # title -> Function, for the functions with a frame
+    by_name = {}                # plain name -> titles
+    edges = []
+
+    for root, _, files in os.walk(directory):
+        for file in sorted(files):
+            if not file.endswith(".ci"):
+                continue
+            with open(os.path.join(root, file), errors="replace") as f:
+                for line in f:
+                    m = NODE.match(line)
+                    if m and m.group(3) is not None:
+                        fn = Function(m.group(2).split(".")[0], int(m.group(3)), m.group(4))
+                        functions[m.group(1)] = fn
+                        by_name.setdefault(fn.name, []).append(m.group(1))
+                        continue
+                    m = EDGE.match(line)
+                    if m:
+                        edges.append((m.group(1), m.group(2)))
+
+    for source, target in edges:
+        if source in functions and target not in functions[source].calls:
+            functions[source].calls.append(target)
+    for title, fn in functions.items():
+        for name in INDIRECT.get(fn.name, ()):
+            fn.calls += by_name.get(name, [])
+        if fn.name in INDIRECT:
+            fn.calls = [t for t in fn.calls if t != "__indirect_call"]
+    return functions, by_name
+
+
+def deepest(functions, title, memo, stack):
+    """(bytes, path, external calls, recursive?) of the deepest path from title."""
+    if title in memo:
+        return memo[title]
+    fn = functions[title]
+    best, best_path = 0, []
+    external = set()
+    recursive = fn.dynamic
+    stack.add(title)
+    for callee in fn.calls:
+        if callee in stack:
+            recursive = True
+            continue
+        if callee not in functions:
+            external.add(callee)
+            continue
+        size, path, ext, rec = deepest(functions, callee, memo, stack)
+        external |= ext
+        recursive = recursive or rec
+        if size > best:
+            best, best_path = size, path
+    stack.discard(title)
+    memo[title] = (fn.size + best, [fn.name] + best_path, external, recursive)
+    return memo[title]
+
+
+def report(functions, by_name, paths):
+    out = []
+    memo = {}
+    for option, entries in THREADS:
+        worst = None
+        external = set()
+        for entry in entries:
+            for title in by_name.get(entry, []):
+                result = deepest(functions, title, memo, set())
+                external |= result[2]
+                if worst is None or result[0] > worst[0]:
+                    worst = result
+        if worst is None:
+            continue
+        out.append("%-36s %6d bytes%s" % (option, worst[0],
+                                          ", recursion or unbounded frame" if worst[3] else ""))
+        if paths:
+            out.append("    " + " > ".join(worst[1]))
+            out.append("    external: " + ", ".join(sorted(external)))
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("dir", help="directory holding the .ci files, build/CMakeFiles/app.dir")
+    parser.add_argument("-o", "--output", help="write the report there, print one line")
+    parser.add_argument("--paths", action="store_true",
+                        help="deepest call path and external calls of each thread")
+    args = parser.parse_args()
+
+    functions, by_name = parse_graphs(args.dir)
+    if not functions:
+        # a compiler without -fcallgraph-info is not an error
+        print("stack usage: no call graph under %s" % args.dir)
+        return 0
+
+    lines = report(functions, by_name, args.paths or bool(args.output))
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write("\n".join(lines) + "\n")
+        print("stack usage (%s): %s" % (args.output, "; ".join(
+            " ".join(line.split()[:3]) for line in lines if line.startswith("CONFIG_"))))
+    else:
+        print("\n".join(lines))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -7,13 +7,27 @@
 
 //  ========== includes ====================================================================
 #include "app_adc.h"
+#include "app_probe.h"
+
+#if defined(CONFIG_ADC_EMUL)
+#include <zephyr/drivers/adc/adc_emul.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_adc, CONFIG_APP_ADC_LOG_LEVEL);
 
 //  ========== globals =====================================================================
 // ADC buffer to store raw ADC readings
 int16_t buf;
 
-// ADC channel configuration obtained from the device tree
-static const struct adc_dt_spec adc_channel = ADC_DT_SPEC_GET(DT_PATH(zephyr_user));
+// ADC channel configurations obtained from the device tree, in io-channels order. the
+// first one is the vertical geophone, also used for one-shot reads
+#define ADC_DT_SPEC_AND_COMMA(node_id, prop, idx)   ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
+
+static const struct adc_dt_spec adc_channels[] = {
+    DT_FOREACH_PROP_ELEM(DT_PATH(zephyr_user), io_channels, ADC_DT_SPEC_AND_COMMA)
+};
+BUILD_ASSERT(ARRAY_SIZE(adc_channels) == ADC_CHANNELS_NB);
 
 // ADC sequence configuration to specify the ADC operation
 static struct adc_sequence sequence = {
@@ -22,30 +36,201 @@ static struct adc_sequence sequence = {
 	.buffer_size = sizeof(buf),
 };
 
+#if defined(CONFIG_APP_ADC_STREAM)
+// the nRF driver only accepts hardware oversampling on a single-channel sequence
+BUILD_ASSERT(!IS_ENABLED(CONFIG_ADC_NRFX_SAADC) || (ADC_CHANNELS_NB == 1) ||
+             (ADC_OVERSAMPLING == 0), "SAADC oversampling needs a single channel");
+
+// position of each channel within a scan: the converter walks the channel mask upwards,
+// which is not necessarily the io-channels order
+static uint8_t stream_slot[ADC_CHANNELS_NB];
+
+// conversion start of each channel relative to the first one of the scan
+static uint32_t stream_skew_ns[ADC_CHANNELS_NB];
+
+// block ring: the samples of all blocks are contiguous, so that one ADC read converts
+// around the ring without stopping and the sequence callback hands each block out as
+// soon as its last scan completes. no sample is copied on the way to the storage stage
+static int16_t stream_ring[ADC_STREAM_POOL_BLOCKS][ADC_STREAM_BLOCK_SAMPLES * ADC_CHANNELS_NB];
+static struct app_adc_block stream_blocks[ADC_STREAM_POOL_BLOCKS];
+
+// blocks held by the consumer, the ADC stops short of them
+static ATOMIC_DEFINE(stream_held, ADC_STREAM_POOL_BLOCKS);
+K_SEM_DEFINE(stream_free_sem, 0, 1);
+
+// full blocks waiting for the consumer, in acquisition order
+K_FIFO_DEFINE(stream_fifo);
+K_SEM_DEFINE(stream_start_sem, 0, 1);
+
+static atomic_t stream_running;
+static uint32_t stream_seq;
+static uint32_t stream_queued;          // blocks in the fifo, under stream_lock
+static uint16_t stream_read_first;      // first block of the read in progress
+static uint16_t stream_read_blocks;     // blocks of the read, completed so far
+static int64_t stream_start_ms;
+static struct app_adc_stream_stats stream_stats;
+static struct k_spinlock stream_lock;
+
+static enum adc_action stream_callback(const struct device *dev,
+                                       const struct adc_sequence *sequence,
+                                       uint16_t sampling_index);
+
+// hardware-timed streaming sequence, one scan per interval_us. a read runs from a block
+// of the ring to its end, the number of samplings is set at each read
+static struct adc_sequence_options stream_options = {
+    .interval_us = ADC_STREAM_INTERVAL_US,
+    .callback = stream_callback,
+};
+
+static struct adc_sequence stream_sequence = {
+    .options = &stream_options,
+};
+#endif /* CONFIG_APP_ADC_STREAM */
+
+#if defined(CONFIG_ADC_EMUL)
+//  ========== adc_emul_geophone ===========================================================
+// state of the synthetic trace of one emulated channel
+struct adc_emul_trace {
+    uint32_t phase;
+    uint32_t noise;
+};
+static struct adc_emul_trace adc_emul_traces[ADC_CHANNELS_NB];
+
+// synthetic geophone trace for native_sim: mid-scale offset, slow triangle and noise (mV),
+// the horizontal components get half the amplitude of the vertical one
+static int adc_emul_geophone(const struct device *dev, unsigned int chan, void *data,
+                             uint32_t *result)
+{
+    struct adc_emul_trace *trace = data;
+    int32_t triangle;
+    int32_t amplitude = (trace == &adc_emul_traces[0]) ? 4 : 2;
+
+    trace->noise = (trace->noise * 1103515245u) + 12345u;
+    trace->phase = (trace->phase + 1) % 200;
+    triangle = (trace->phase < 100) ? (int32_t)trace->phase : (int32_t)(200 - trace->phase);
+
+    *result = (uint32_t)(1650 + ((triangle - 50) * amplitude) +
+                         (int32_t)((trace->noise >> 16) & 0x0F) - 8);
+    return 0;
+}
+#endif
+
+#if defined(CONFIG_APP_ADC_STREAM)
+//  ========== adc_acq_time_ns =============================================================
+// acquisition time of a channel from its devicetree encoding
+static uint32_t adc_acq_time_ns(uint16_t acq_time)
+{
+    if (acq_time == ADC_ACQ_TIME_DEFAULT) {
+        return ADC_ACQ_TIME_DEFAULT_NS;
+    }
+    switch (ADC_ACQ_TIME_UNIT(acq_time)) {
+    case ADC_ACQ_TIME_MICROSECONDS:
+        return ADC_ACQ_TIME_VALUE(acq_time) * NSEC_PER_USEC;
+    case ADC_ACQ_TIME_NANOSECONDS:
+        return ADC_ACQ_TIME_VALUE(acq_time);
+    default:
+        return ADC_ACQ_TIME_DEFAULT_NS;
+    }
+}
+
+//  ========== adc_stream_scan_init ========================================================
+// add every channel to the streaming sequence, so they are converted back to back in the
+// same scan, and derive their position and conversion start within the scan
+static int8_t adc_stream_scan_init(void)
+{
+    uint32_t offset_ns = 0;
+    int8_t ret;
+
+    // the first channel sets the resolution, the others must match it
+    ret = adc_sequence_init_dt(&adc_channels[0], &stream_sequence);
+    if (ret < 0) {
+        return ret;
+    }
+    for (uint8_t ch = 1; ch < ADC_CHANNELS_NB; ch++) {
+        if ((adc_channels[ch].dev != adc_channels[0].dev) ||
+            (adc_channels[ch].resolution != adc_channels[0].resolution) ||
+            (stream_sequence.channels & BIT(adc_channels[ch].channel_id))) {
+            return -EINVAL;
+        }
+        stream_sequence.channels |= BIT(adc_channels[ch].channel_id);
+    }
+    stream_sequence.oversampling = ADC_OVERSAMPLING;
+
+    // each conversion is averaged over 2^oversampling acquisitions
+    for (uint8_t slot = 0; slot < 32; slot++) {
+        if ((stream_sequence.channels & BIT(slot)) == 0) {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+            if (adc_channels[ch].channel_id != slot) {
+                continue;
+            }
+            stream_slot[ch] = (uint8_t)POPCOUNT(stream_sequence.channels & BIT_MASK(slot));
+            stream_skew_ns[ch] = offset_ns;
+            offset_ns += (adc_acq_time_ns(adc_channels[ch].channel_cfg.acquisition_time) +
+                          ADC_CONV_TIME_NS) << ADC_OVERSAMPLING;
+        }
+    }
+
+    // the whole scan has to complete before the next sampling is due
+    if (offset_ns >= (ADC_STREAM_INTERVAL_US * NSEC_PER_USEC)) {
+        LOG_ERR("ADC scan takes %u ns, longer than the %u us interval", offset_ns,
+                ADC_STREAM_INTERVAL_US);
+        return -EINVAL;
+    }
+    LOG_INF("ADC scan of %d channels, oversampling x%d, %u ns per scan", ADC_CHANNELS_NB,
+            1 << ADC_OVERSAMPLING, offset_ns);
+    return 0;
+}
+#endif /* CONFIG_APP_ADC_STREAM */
+
 //  ========== app_nrf52_adc_init ==========================================================
 int8_t app_nrf52_adc_init()
 {
     int8_t ret;
 
-    // verify if the ADC is ready for operation
-    if (!adc_is_ready_dt(&adc_channel)) {
-		printk("ADC is not ready. error: %d\n", ret);
-		return 0;
+    for (uint8_t ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+        // verify if the ADC is ready for operation
+        if (!adc_is_ready_dt(&adc_channels[ch])) {
+            LOG_ERR("ADC is not ready for channel %d", ch);
+            return 0;
+        }
+
+        // configure the ADC channel settings, gain and acquisition time come from the
+        // devicetree node of each channel
+        ret = adc_channel_setup_dt(&adc_channels[ch]);
+        if (ret < 0) {
+            LOG_ERR("failed to set up ADC channel %d. error: %d", ch, ret);
+            return 0;
+        }
+
+#if defined(CONFIG_ADC_EMUL)
+        // feed the emulated channel with a synthetic signal instead of a constant
+        adc_emul_traces[ch].noise = 12345u + ch;
+        ret = adc_emul_value_func_set(adc_channels[ch].dev, adc_channels[ch].channel_id,
+                                      adc_emul_geophone, &adc_emul_traces[ch]);
+        if (ret < 0) {
+            LOG_ERR("failed to set ADC emulator input. error: %d", ret);
+            return 0;
+        }
+#endif
     }
-    
-    // configure the ADC channel settings
-    ret = adc_channel_setup_dt(&adc_channel);
+
+    // Initialize the ADC sequence for single readings of the first channel
+    ret = adc_sequence_init_dt(&adc_channels[0], &sequence);
 	if (ret < 0) {
-		printk("failed to set up ADC channel. error: %d\n", ret);
+		LOG_ERR("failed to initialize ADC sequence. error: %d", ret);
 		return 0;
 	}
 
-    // Initialize the ADC sequence for continuous or single readings
-    ret = adc_sequence_init_dt(&adc_channel, &sequence);
+#if defined(CONFIG_APP_ADC_STREAM)
+    // the streaming sequence scans all channels
+    ret = adc_stream_scan_init();
 	if (ret < 0) {
-		printk("failed to initialize ADC sequence. error: %d\n", ret);
+		LOG_ERR("failed to initialize ADC stream sequence. error: %d", ret);
 		return 0;
 	}
+#endif
     return 1;
 }
 
@@ -56,16 +241,295 @@ int16_t app_nrf52_get_adc()
     int8_t ret;
     
     // trigger an ADC read and store the result in the configured buffer
-    ret = adc_read(adc_channel.dev, &sequence);
+    ret = APP_PROBE(PROBE_ADC_READ, adc_read(adc_channels[0].dev, &sequence));
     if (ret < 0) {        
-	    printk("failed to read raw ADC value. Error: %d\n", ret);
+	    LOG_ERR("failed to read raw ADC value. Error: %d", ret);
 	    return 0;
     }
 
-    printk("raw adc value: %d\n", buf);
+    LOG_DBG("raw adc value: %d", buf);
 
     // convert the raw ADC reading into a voltage value (in millivolts)
-    velocity = (buf * ADC_REFERENCE_VOLTAGE) / ADC_RESOLUTION;
-    printk("velocity: %d mV\n", velocity);
+    velocity = app_nrf52_adc_to_mv(buf);
+    LOG_DBG("velocity: %d mV", velocity);
     return (int16_t)velocity;
 }
+
+//  ========== app_nrf52_adc_to_mv =========================================================
+int16_t app_nrf52_adc_to_mv(int16_t raw)
+{
+    return (int16_t)(((int32_t)raw * ADC_REFERENCE_VOLTAGE) / ADC_RESOLUTION);
+}
+
+#if defined(CONFIG_APP_ADC_STREAM)
+//  ========== stream_free_blocks ==========================================================
+static uint32_t stream_free_blocks(void)
+{
+    uint32_t free = 0;
+
+    for (uint16_t i = 0; i < ADC_STREAM_POOL_BLOCKS; i++) {
+        free += atomic_test_bit(stream_held, i) ? 0 : 1;
+    }
+    return free;
+}
+
+//  ========== stream_callback =============================================================
+// called by the ADC driver after each scan, hands a block to the consumer once its last
+// scan is converted. the read goes on into the next block unless the consumer still holds
+// it or the stream is stopped, so conversion only pauses on an overrun
+static enum adc_action stream_callback(const struct device *dev,
+                                       const struct adc_sequence *sequence,
+                                       uint16_t sampling_index)
+{
+    uint16_t filled = sampling_index + 1;
+    uint16_t index;
+    struct app_adc_block *block;
+
+    if ((filled % ADC_STREAM_BLOCK_SAMPLES) != 0) {
+        return ADC_ACTION_CONTINUE;
+    }
+    APP_PROBE_BEGIN(probe_start);
+
+    index = stream_read_first + stream_read_blocks;
+    block = &stream_blocks[index];
+    block->uptime_ticks = k_uptime_ticks();
+    block->count = ADC_STREAM_BLOCK_SAMPLES;
+    block->channels = ADC_CHANNELS_NB;
+    block->seq = stream_seq++;
+    atomic_set_bit(stream_held, index);
+    stream_read_blocks++;
+
+    k_spinlock_key_t key = k_spin_lock(&stream_lock);
+    k_fifo_put(&stream_fifo, block);
+    stream_queued++;
+    stream_stats.queue_max = MAX(stream_stats.queue_max, stream_queued);
+    stream_stats.blocks++;
+    stream_stats.samples += ADC_STREAM_BLOCK_SAMPLES;
+    stream_stats.pool_free_min = MIN(stream_stats.pool_free_min, stream_free_blocks());
+    k_spin_unlock(&stream_lock, key);
+    APP_PROBE_END(PROBE_ADC_STREAM_PUT, probe_start);
+
+    // the end of the read is the end of the ring, the thread starts the next one
+    index++;
+    if (!atomic_get(&stream_running) ||
+        (index < ADC_STREAM_POOL_BLOCKS && atomic_test_bit(stream_held, index))) {
+        return ADC_ACTION_FINISH;
+    }
+    return ADC_ACTION_CONTINUE;
+}
+
+//  ========== adc_stream_thread ===========================================================
+// keeps the ring converting: each adc_read() runs from the next block to the end of the
+// ring. the next read starts one sample interval after the last scan, on the grid of the
+// first one, so a wrap of the ring costs no sample; a pause on a held block skips whole
+// block periods and keeps the grid
+static void adc_stream_thread(void *p1, void *p2, void *p3)
+{
+    int64_t late_ticks = k_us_to_ticks_ceil64(ADC_STREAM_INTERVAL_US);
+    int64_t start_ticks;
+    uint64_t periods;               // block periods since the start, converted or not
+    uint16_t next;
+    int ret;
+
+    while (1) {
+        k_sem_take(&stream_start_sem, K_FOREVER);
+        start_ticks = k_uptime_ticks();
+        periods = 0;
+        next = 0;
+
+        while (atomic_get(&stream_running)) {
+            if (atomic_test_bit(stream_held, next)) {
+                // overrun: the consumer still holds the block the ADC reached
+                (void)k_sem_take(&stream_free_sem, K_MSEC(ADC_STREAM_BLOCK_US / 1000 + 1));
+                continue;
+            }
+
+            int64_t due = start_ticks + k_us_to_ticks_near64(periods * ADC_STREAM_BLOCK_US);
+            int64_t now = k_uptime_ticks();
+
+            if (now - due > late_ticks) {
+                // restart on the next block period of the grid, the ones passed are lost
+                uint64_t missed = DIV_ROUND_UP(k_ticks_to_us_ceil64(now - due),
+                                               ADC_STREAM_BLOCK_US);
+                periods += missed;
+                due = start_ticks + k_us_to_ticks_near64(periods * ADC_STREAM_BLOCK_US);
+
+                k_spinlock_key_t key = k_spin_lock(&stream_lock);
+                stream_stats.overruns += (uint32_t)missed;
+                k_spin_unlock(&stream_lock, key);
+            }
+            (void)k_sleep(K_TIMEOUT_ABS_TICKS(due));
+
+            // woken more than a sample interval past the grid: the first scan of the read
+            // misses its deadline
+            if ((k_uptime_ticks() - due) > late_ticks) {
+                k_spinlock_key_t key = k_spin_lock(&stream_lock);
+                stream_stats.late++;
+                k_spin_unlock(&stream_lock, key);
+            }
+
+            uint16_t blocks = MIN(ADC_STREAM_POOL_BLOCKS - next, ADC_STREAM_READ_BLOCKS);
+
+            stream_read_first = next;
+            stream_read_blocks = 0;
+            stream_options.extra_samplings = (blocks * ADC_STREAM_BLOCK_SAMPLES) - 1;
+            stream_sequence.buffer = stream_ring[next];
+            stream_sequence.buffer_size = blocks * sizeof(stream_ring[0]);
+
+            ret = adc_read(adc_channels[0].dev, &stream_sequence);
+
+            k_spinlock_key_t key = k_spin_lock(&stream_lock);
+            stream_stats.restarts++;
+            k_spin_unlock(&stream_lock, key);
+
+            if (ret < 0) {
+                LOG_ERR("ADC stream read failed. error: %d", ret);
+                atomic_set(&stream_running, 0);
+                break;
+            }
+            periods += stream_read_blocks;
+            next = (next + stream_read_blocks) % ADC_STREAM_POOL_BLOCKS;
+        }
+    }
+}
+K_THREAD_DEFINE(adc_stream_tid, CONFIG_APP_ACQ_STACK_SIZE, adc_stream_thread,
+                NULL, NULL, NULL, CONFIG_APP_ACQ_PRIORITY, 0, 0);
+
+//  ========== app_adc_stream_start ========================================================
+int8_t app_adc_stream_start(void)
+{
+    struct app_adc_block *block;
+
+    if (atomic_cas(&stream_running, 0, 1) == false) {
+        return -EALREADY;
+    }
+
+    // blocks left over from a previous run go back to the ring
+    while ((block = k_fifo_get(&stream_fifo, K_NO_WAIT)) != NULL) {
+        app_adc_stream_release_block(block);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stream_lock);
+    stream_queued = 0;
+    memset(&stream_stats, 0, sizeof(stream_stats));
+    stream_stats.pool_free_min = stream_free_blocks();
+    k_spin_unlock(&stream_lock, key);
+
+    stream_seq = 0;
+    stream_start_ms = k_uptime_get();
+
+    for (uint16_t i = 0; i < ADC_STREAM_POOL_BLOCKS; i++) {
+        stream_blocks[i].samples = stream_ring[i];
+    }
+
+    k_sem_give(&stream_start_sem);
+    LOG_INF("ADC streaming started at %d Hz, %d samples per block, %d channels, %d blocks",
+           ADC_STREAM_RATE_HZ, ADC_STREAM_BLOCK_SAMPLES, ADC_CHANNELS_NB,
+           ADC_STREAM_POOL_BLOCKS);
+    return 0;
+}
+
+//  ========== app_adc_stream_stop =========================================================
+// the block being converted is completed and queued
+void app_adc_stream_stop(void)
+{
+    atomic_set(&stream_running, 0);
+}
+
+//  ========== app_adc_stream_get_block ====================================================
+// take the oldest full block, the caller owns it until app_adc_stream_release_block()
+struct app_adc_block *app_adc_stream_get_block(k_timeout_t timeout)
+{
+    struct app_adc_block *block = k_fifo_get(&stream_fifo, timeout);
+
+    if (block) {
+        k_spinlock_key_t key = k_spin_lock(&stream_lock);
+        stream_queued--;
+        k_spin_unlock(&stream_lock, key);
+    }
+    return block;
+}
+
+//  ========== app_adc_stream_release_block ================================================
+// hand the block back to the ring, once the storage stage is done with its samples
+void app_adc_stream_release_block(struct app_adc_block *block)
+{
+    if (block) {
+        atomic_clear_bit(stream_held, block - stream_blocks);
+        k_sem_give(&stream_free_sem);
+    }
+}
+
+//  ========== app_adc_stream_queued =======================================================
+// full blocks waiting for the storage stage, a measure of its backlog
+uint32_t app_adc_stream_queued(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stream_lock);
+    uint32_t queued = stream_queued;
+    k_spin_unlock(&stream_lock, key);
+    return queued;
+}
+
+//  ========== app_adc_stream_get_stats ====================================================
+void app_adc_stream_get_stats(struct app_adc_stream_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&stream_lock);
+    *stats = stream_stats;
+    k_spin_unlock(&stream_lock, key);
+
+    stats->elapsed_ms = k_uptime_get() - stream_start_ms;
+    stats->rate_hz = (stats->elapsed_ms > 0) ?
+                     (uint32_t)((stats->samples * MSEC_PER_SEC) / stats->elapsed_ms) : 0;
+}
+
+//  ========== app_adc_channel_skew_ns =====================================================
+// delay between the conversion start of the first channel of a scan and this channel's,
+// derived from the acquisition times and the oversampling. all channels of a block
+// share its timestamp, this is the bound on their misalignment
+uint32_t app_adc_channel_skew_ns(uint8_t channel)
+{
+    return (channel < ADC_CHANNELS_NB) ? stream_skew_ns[channel] : 0;
+}
+
+//  ========== app_adc_block_get_channel ===================================================
+// copy the samples of one channel (io-channels index) out of an interleaved block
+int app_adc_block_get_channel(const struct app_adc_block *block, uint8_t channel,
+                              int16_t *out, uint16_t size)
+{
+    if (!block || !out || (channel >= block->channels) || (size < block->count)) {
+        return -EINVAL;
+    }
+
+    const int16_t *in = &block->samples[stream_slot[channel]];
+    for (uint16_t i = 0; i < block->count; i++) {
+        out[i] = *in;
+        in += block->channels;
+    }
+    return block->count;
+}
+
+//  ========== app_adc_block_deinterleave ==================================================
+// split a block into one buffer per channel (io-channels order) in a single pass
+int app_adc_block_deinterleave(const struct app_adc_block *block, int16_t *const out[],
+                               uint16_t size)
+{
+    int16_t *dest[ADC_CHANNELS_NB];
+
+    if (!block || !out || (block->channels != ADC_CHANNELS_NB) || (size < block->count)) {
+        return -EINVAL;
+    }
+
+    // index the outputs by scan position so the samples are read in order
+    for (uint8_t ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+        dest[stream_slot[ch]] = out[ch];
+    }
+
+    const int16_t *in = block->samples;
+    for (uint16_t i = 0; i < block->count; i++) {
+        for (uint8_t slot = 0; slot < ADC_CHANNELS_NB; slot++) {
+            dest[slot][i] = *in++;
+        }
+    }
+    return block->count;
+}
+#endif /* CONFIG_APP_ADC_STREAM */
@@ -13,13 +13,79 @@
 #include <zephyr/device.h>
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/adc.h>
+#include <zephyr/sys/atomic.h>
 
 //  ========== defines =====================================================================
 #define ADC_REFERENCE_VOLTAGE       3300    // 3.3V reference voltage of the board
 #define ADC_RESOLUTION              4096    // 12-bit resolution
 
+// channels of the zephyr,user io-channels list, converted together in one scan
+#define ADC_CHANNELS_NB             DT_PROP_LEN(DT_PATH(zephyr_user), io_channels)
+
+// nRF52 SAADC conversion timing, used to bound the skew between the channels of a scan
+#define ADC_ACQ_TIME_DEFAULT_NS     10000   // ADC_ACQ_TIME_DEFAULT is 10 us on the SAADC
+#define ADC_CONV_TIME_NS            2000    // worst-case conversion time
+
+#if defined(CONFIG_APP_ADC_STREAM)
+#define ADC_STREAM_RATE_HZ          CONFIG_APP_ADC_SAMPLE_RATE_HZ
+#define ADC_STREAM_BLOCK_SAMPLES    CONFIG_APP_ADC_BLOCK_SAMPLES
+#define ADC_STREAM_INTERVAL_US      (USEC_PER_SEC / ADC_STREAM_RATE_HZ)
+#define ADC_STREAM_BLOCK_US         (ADC_STREAM_BLOCK_SAMPLES * ADC_STREAM_INTERVAL_US)
+#define ADC_STREAM_POOL_BLOCKS      CONFIG_APP_ADC_POOL_BLOCKS
+// blocks converted by one adc_read(), bounded by its 16-bit count of extra samplings
+#define ADC_STREAM_READ_BLOCKS      MIN(ADC_STREAM_POOL_BLOCKS, \
+                                        (UINT16_MAX + 1) / ADC_STREAM_BLOCK_SAMPLES)
+#define ADC_OVERSAMPLING            CONFIG_APP_ADC_OVERSAMPLING     // log2 of the averaged conversions
+#endif
+
+//  ========== types =======================================================================
+#if defined(CONFIG_APP_ADC_STREAM)
+// one block of the streaming ring, converted in place by the ADC and owned by the
+// consumer until released. the samples of one scan are stored next to each other, use
+// app_adc_block_get_channel() or app_adc_block_deinterleave() to get per-channel samples
+struct app_adc_block {
+    void *fifo_reserved;        // first word is used by k_fifo
+    uint16_t count;             // number of scans (samples per channel) in the block
+    uint8_t channels;           // number of channels in each scan
+    uint32_t seq;               // block sequence number
+    // kernel tick at which the last sample completed. on the nRF52 the kernel clock is RTC1
+    // on the 32.768 kHz crystal of the app_rtc counter, extended to 64 bits by the kernel:
+    // the resolution of app_rtc_ticks(), and the local time app_clock_at_us() is fitted on
+    int64_t uptime_ticks;
+    int16_t *samples;           // raw ADC counts, ADC_STREAM_BLOCK_SAMPLES scans
+};
+#endif
+
+// streaming counters, used to measure the sustained rate and the back-pressure
+struct app_adc_stream_stats {
+    uint32_t blocks;            // blocks handed to the consumer
+    uint32_t overruns;          // block periods not converted, the consumer held the ring
+    uint32_t restarts;          // ADC reads, one per turn of the ring and per overrun
+    uint32_t late;              // reads started more than one sample interval late
+    uint32_t pool_free_min;     // fewest blocks not held by the consumer
+    uint32_t queue_max;         // high-water mark of the blocks waiting for the consumer
+    uint64_t samples;           // total scans converted, i.e. samples per channel
+    int64_t elapsed_ms;         // time since app_adc_stream_start()
+    uint32_t rate_hz;           // measured sustained scan rate
+};
+
 //  ========== prototypes ==================================================================
 int8_t app_nrf52_adc_init();
 int16_t app_nrf52_get_adc();
+int16_t app_nrf52_adc_to_mv(int16_t raw);
+
+#if defined(CONFIG_APP_ADC_STREAM)
+int8_t app_adc_stream_start(void);
+void app_adc_stream_stop(void);
+struct app_adc_block *app_adc_stream_get_block(k_timeout_t timeout);
+void app_adc_stream_release_block(struct app_adc_block *block);
+uint32_t app_adc_stream_queued(void);
+void app_adc_stream_get_stats(struct app_adc_stream_stats *stats);
+uint32_t app_adc_channel_skew_ns(uint8_t channel);
+int app_adc_block_get_channel(const struct app_adc_block *block, uint8_t channel,
+                              int16_t *out, uint16_t size);
+int app_adc_block_deinterleave(const struct app_adc_block *block, int16_t *const out[],
+                               uint16_t size);
+#endif
 
 #endif /* APP_ADC_H */
\ No newline at end of file
@@ -0,0 +1,1466 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// end-to-end benchmark of the acquisition pipeline, runs on the board and on native_sim
+// with the emulated ADC, DS3231 and flash
+#if defined(CONFIG_APP_BENCH)
+
+#include "app_bench.h"
+#include "app_adc.h"
+#include "app_crc32.h"
+#include "app_ds3231.h"
+#include "app_eeprom.h"
+#if defined(CONFIG_APP_DSP)
+#include "app_dsp.h"
+#endif
+#include "app_flash_log.h"
+#include "app_flash_wbuf.h"
+#include "app_probe.h"
+#include "app_rtc.h"
+#if defined(CONFIG_APP_SPECTRUM)
+#include "app_spectrum.h"
+#endif
+#include "app_steim2.h"
+#include "app_trigger.h"
+#include "app_uplink.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#if defined(CONFIG_ARCH_POSIX) && defined(CONFIG_EXTERNAL_LIBC)
+#include <time.h>
+#endif
+#if defined(CONFIG_CRC)
+#include <zephyr/sys/crc.h>
+#endif
+
+// production level: the debug messages of the logging benchmark are compiled out
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_bench, LOG_LEVEL_INF);
+
+//  ========== defines =====================================================================
+#define BENCH_TRIGGER_SECONDS       120     // synthetic trace fed to the trigger
+#define BENCH_TRIGGER_BLOCK         128
+#define BENCH_TRIGGER_AMPLITUDE     8192    // injected arrival, alternating around the bias
+#define BENCH_TRIGGER_BURST_MS      1000
+#define BENCH_LOG_SAMPLES           32      // samples per logging variant
+#define BENCH_CRC_ROUNDS            256     // passes over the record buffer
+#define BENCH_RTC_CONVERSIONS       100000  // tick values spread over ten years
+#define BENCH_RTC_WRAPS             256     // simulated counter wraps, 64 per callback timing
+#define BENCH_ERASE_APPENDS         120     // records per erase-ahead pass, ~17 sectors
+#define BENCH_ERASE_RECORD          512
+#define BENCH_ERASE_PERIOD_MS       50
+#define BENCH_RECOVERY_RECORD       500     // seven records per sector
+#define BENCH_RECOVERY_WRAP         8       // sectors written past a full partition
+#define BENCH_RECOVERY_PERIOD_MS    100
+#define BENCH_SPECTRUM_WINDOWS      256     // FFT kernel runs, each on fresh input
+#define BENCH_SPECTRUM_HZ           20      // synthetic ground motion, plus 0.3 Hz
+#define BENCH_SPECTRUM_AMPLITUDE    1000    // of the sine, RMS 707
+#define BENCH_SPECTRUM_DIFF_LSB     6       // both kernels within 3 LSB of the exact DFT
+#define BENCH_SPECTRUM_BLOCK        128
+#define BENCH_I2C_SYNCS             16      // register syncs per DS3231 timing pass
+#define BENCH_CLOCK_SYNCS           32      // reference samples of the drifting clock
+#define BENCH_CLOCK_DRIFT_PPB       (-37000)    // local oscillator against the reference
+#define BENCH_SEQLOCK_MS            1000    // writers and readers running together
+#define BENCH_SEQLOCK_PERIOD_US     1000    // writer wake-up period
+#define BENCH_SEQLOCK_WRITES        ((2 * BENCH_SEQLOCK_MS * USEC_PER_MSEC) / BENCH_SEQLOCK_PERIOD_US)
+#define BENCH_SEQLOCK_READERS       2
+#define BENCH_SEQLOCK_THREADS       (BENCH_SEQLOCK_READERS + 2)
+// the writers run the sync path of the housekeeping queue
+#define BENCH_SEQLOCK_STACK_SIZE    CONFIG_APP_HOUSEKEEPING_STACK_SIZE
+#define BENCH_SEQLOCK_RTC_STEP_MS   (3600 * MSEC_PER_SEC)
+#define BENCH_SEQLOCK_CLOCK_STEP_US (2 * CLOCK_STEP_US)
+#define BENCH_STACK_MARGIN_PCT      25      // headroom of the suggested stack sizes
+#define BENCH_STACK_ALIGN           64
+
+// CPU clock, turns the Steim-2 encoding time into cycles per sample
+#if DT_NODE_HAS_PROP(DT_PATH(cpus, cpu_0), clock_frequency)
+#define BENCH_CPU_HZ                DT_PROP(DT_PATH(cpus, cpu_0), clock_frequency)
+#endif
+
+//  ========== types =======================================================================
+enum bench_stage {
+    BENCH_QUEUE,                // end of the ADC block to its pickup by the consumer
+    BENCH_TIMESTAMP,
+    BENCH_FILTER,               // de-interleaving and filtering of all channels
+    BENCH_SERIALIZE,
+    BENCH_FLASH,
+    BENCH_TOTAL,
+    BENCH_STAGES,
+};
+
+//  ========== globals =====================================================================
+static const char *const bench_stage_names[BENCH_STAGES] = {
+    "queue", "timestamp", "filter", "serialize", "flash", "total",
+};
+
+// per-stage latency of each block in ns, sorted in place for the percentiles
+static uint32_t bench_latency[BENCH_STAGES][BENCH_LATENCY_SAMPLES];
+static uint32_t bench_latency_count;
+
+static uint8_t bench_record[STEIM2_MAX_SIZE(ADC_STREAM_BLOCK_SAMPLES)];
+
+// checks of the bench that did not give the expected result
+static uint32_t bench_failures;
+
+// append latency of the erase-ahead passes, in us
+static uint32_t bench_append_us[BENCH_ERASE_APPENDS];
+
+// de-interleaved multi-channel block, one row per channel. a single channel is
+// filtered and encoded in place, straight from the ring block
+static int16_t bench_channels[ADC_CHANNELS_NB][ADC_STREAM_BLOCK_SAMPLES];
+#if defined(CONFIG_APP_DSP)
+static struct app_dsp_filter bench_filter[ADC_CHANNELS_NB];
+#endif
+
+// seqlock stress: writer threads woken by a timer preempt readers of the same state.
+// the RTC is set to base_ms and one hour later in turn, the clock stepped between two
+// offsets; any other value read is a torn snapshot
+static struct {
+    struct k_sem rtc_wake;
+    struct k_sem clock_wake;
+    atomic_t stop;
+    const struct device *rtc_dev;
+    uint64_t rtc_base_ms;
+    int64_t clock_local_us;     // local time of the first clock sample
+    int64_t clock_query_us;     // local time the readers evaluate, after every sample
+    uint32_t rtc_writes;
+    uint32_t clock_writes;
+    uint32_t reads[BENCH_SEQLOCK_READERS];
+    uint32_t errors[BENCH_SEQLOCK_READERS];
+    uint64_t rtc_worst_ns[BENCH_SEQLOCK_READERS];
+    uint64_t clock_worst_ns[BENCH_SEQLOCK_READERS];
+} bench_seqlock_state;
+
+static struct k_thread bench_seqlock_threads[BENCH_SEQLOCK_THREADS];
+K_THREAD_STACK_ARRAY_DEFINE(bench_seqlock_stacks, BENCH_SEQLOCK_THREADS, BENCH_SEQLOCK_STACK_SIZE);
+
+// a stored block decoded, and the same block after a second encode/decode
+static int16_t bench_decoded[2][ADC_STREAM_BLOCK_SAMPLES];
+
+//  ========== bench_now ===================================================================
+// cycle counter on the target; on native_sim the simulated cycles stand still while
+// the host runs the code, so the host monotonic clock is used instead. 64 bits, a run
+// of the benchmark lasts longer than a 32-bit count of ns or of 64 MHz cycles
+static inline uint64_t bench_now(void)
+{
+#if defined(CONFIG_ARCH_POSIX) && defined(CONFIG_EXTERNAL_LIBC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+#elif defined(CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER)
+    return k_cycle_get_64();
+#else
+    return k_cycle_get_32();
+#endif
+}
+
+//  ========== bench_elapsed_ns ============================================================
+static inline uint64_t bench_elapsed_ns(uint64_t start)
+{
+#if defined(CONFIG_ARCH_POSIX) && defined(CONFIG_EXTERNAL_LIBC)
+    return bench_now() - start;
+#elif defined(CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER)
+    return k_cyc_to_ns_floor64(k_cycle_get_64() - start);
+#else
+    // a 32-bit counter wraps, only the low bits of the difference are valid
+    return k_cyc_to_ns_floor64((uint32_t)(k_cycle_get_32() - (uint32_t)start));
+#endif
+}
+
+//  ========== bench_check =================================================================
+static const char *bench_check(bool ok)
+{
+    if (!ok) {
+        bench_failures++;
+    }
+    return ok ? "ok" : "FAILED";
+}
+
+//  ========== bench_compare ===============================================================
+static int bench_compare(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+//  ========== bench_percentile ============================================================
+static uint32_t bench_percentile(const uint32_t *sorted, uint32_t count, uint32_t pct)
+{
+    if (count == 0) {
+        return 0;
+    }
+    return sorted[MIN(((count * pct) + 99) / 100, count) - 1];
+}
+
+//  ========== bench_report_latency ========================================================
+static void bench_report_latency(void)
+{
+    uint32_t n = bench_latency_count;
+
+    printk("stage        p50 us   p90 us   p99 us   max us   (%u blocks)\n", n);
+    for (int s = 0; s < BENCH_STAGES; s++) {
+        qsort(bench_latency[s], n, sizeof(uint32_t), bench_compare);
+        printk("%-10s %8u %8u %8u %8u\n", bench_stage_names[s],
+               bench_percentile(bench_latency[s], n, 50) / 1000,
+               bench_percentile(bench_latency[s], n, 90) / 1000,
+               bench_percentile(bench_latency[s], n, 99) / 1000,
+               bench_percentile(bench_latency[s], n, 100) / 1000);
+    }
+}
+
+//  ========== bench_stream ================================================================
+// sample -> timestamp -> filter -> serialize -> flash, every block of every channel is
+// stored as its own record
+static int8_t bench_stream(void)
+{
+    int16_t *channels[ADC_CHANNELS_NB];
+    struct app_adc_block *block;
+    struct app_adc_stream_stats adc_stats;
+    struct app_flash_wbuf_stats wbuf_stats;
+    struct app_steim2_block_hdr hdr = { .rate_hz = ADC_STREAM_RATE_HZ };
+    uint64_t samples_stored = 0;
+    uint64_t bytes_stored = 0;
+    uint64_t busy_ns = 0;
+    uint32_t store_errors = 0;
+    int32_t previous[ADC_CHANNELS_NB] = {0};
+    int64_t end_ms;
+    int8_t ret;
+
+    for (int ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+        channels[ch] = bench_channels[ch];
+    }
+    bench_latency_count = 0;
+    (void)app_flash_log_clear();
+    app_flash_wbuf_reset_stats();
+#if defined(CONFIG_APP_DSP)
+    for (int ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+        app_dsp_filter_init(&bench_filter[ch]);
+    }
+#endif
+
+    printk("streaming %u Hz for %u s, %u samples per block, %u channels\n", ADC_STREAM_RATE_HZ,
+           BENCH_DURATION_S, ADC_STREAM_BLOCK_SAMPLES, ADC_CHANNELS_NB);
+
+    ret = app_adc_stream_start();
+    if (ret < 0) {
+        printk("failed to start ADC streaming. error: %d\n", ret);
+        return ret;
+    }
+
+    end_ms = k_uptime_get() + (BENCH_DURATION_S * MSEC_PER_SEC);
+    while (k_uptime_get() < end_ms) {
+        uint32_t lat[BENCH_STAGES];
+        uint64_t t_block, t;
+        int64_t start_us;
+        int16_t *samples[ADC_CHANNELS_NB];
+        int count;
+        int len;
+
+        block = app_adc_stream_get_block(K_SECONDS(1));
+        if (!block) {
+            printk("no ADC block received\n");
+            continue;
+        }
+        t_block = bench_now();
+        lat[BENCH_QUEUE] = (uint32_t)k_ticks_to_ns_floor64(k_uptime_ticks() - block->uptime_ticks);
+
+        // the block is stamped at its last sample, the record starts at its first
+        t = bench_now();
+        start_us = app_clock_at_us((int64_t)k_ticks_to_us_floor64(block->uptime_ticks)) -
+                   ((int64_t)(block->count - 1) * ADC_STREAM_INTERVAL_US);
+        lat[BENCH_TIMESTAMP] = bench_elapsed_ns(t);
+
+        t = bench_now();
+        if (block->channels > 1) {
+            count = app_adc_block_deinterleave(block, channels, ADC_STREAM_BLOCK_SAMPLES);
+            for (int ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+                samples[ch] = channels[ch];
+            }
+        } else {
+            count = block->count;
+            samples[0] = block->samples;
+        }
+#if defined(CONFIG_APP_DSP)
+        uint16_t first_index;
+        for (int ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+            count = app_dsp_filter_process(&bench_filter[ch], samples[ch], block->count,
+                                           samples[ch], block->count, &first_index);
+        }
+        // first output of the block, less the FIR delay
+        start_us += ((int64_t)first_index * ADC_STREAM_INTERVAL_US) - DSP_DELAY_US;
+        hdr.rate_hz = DSP_OUTPUT_RATE_HZ;
+#endif
+        hdr.start_time = (uint64_t)(start_us / 1000);
+        lat[BENCH_FILTER] = bench_elapsed_ns(t);
+
+        lat[BENCH_SERIALIZE] = 0;
+        lat[BENCH_FLASH] = 0;
+        for (int ch = 0; (ch < ADC_CHANNELS_NB) && (count > 0); ch++) {
+            t = bench_now();
+            len = app_steim2_encode(samples[ch], count, previous[ch], &hdr, bench_record,
+                                    sizeof(bench_record));
+            lat[BENCH_SERIALIZE] += bench_elapsed_ns(t);
+            previous[ch] = samples[ch][count - 1];
+
+            t = bench_now();
+            if (len > 0 && app_flash_log_append(bench_record, len, hdr.start_time, NULL) == 0) {
+                samples_stored += count;
+                bytes_stored += len;
+            } else {
+                store_errors++;
+            }
+            lat[BENCH_FLASH] += bench_elapsed_ns(t);
+        }
+
+        app_adc_stream_release_block(block);
+        lat[BENCH_TOTAL] = bench_elapsed_ns(t_block);
+        busy_ns += lat[BENCH_TOTAL];
+
+        if (bench_latency_count < BENCH_LATENCY_SAMPLES) {
+            for (int s = 0; s < BENCH_STAGES; s++) {
+                bench_latency[s][bench_latency_count] = lat[s];
+            }
+            bench_latency_count++;
+        }
+    }
+
+    app_adc_stream_stop();
+    (void)app_flash_log_sync();
+    app_adc_stream_get_stats(&adc_stats);
+    app_flash_wbuf_get_stats(&wbuf_stats);
+
+    printk("acquired %llu scans in %lld ms (%u Hz), %u blocks, %u overruns (%u scans), "
+           "%u of %u ring blocks free at worst\n",
+           adc_stats.samples, adc_stats.elapsed_ms, adc_stats.rate_hz, adc_stats.blocks,
+           adc_stats.overruns, adc_stats.overruns * ADC_STREAM_BLOCK_SAMPLES,
+           adc_stats.pool_free_min, ADC_STREAM_POOL_BLOCKS);
+    printk("queue high-water mark %u blocks, %u ADC reads (%u started late)\n",
+           adc_stats.queue_max, adc_stats.restarts, adc_stats.late);
+    printk("stored %llu samples in %llu bytes (%llu.%02llu bits/sample), %u store errors\n",
+           samples_stored, bytes_stored,
+           samples_stored ? (bytes_stored * 8) / samples_stored : 0,
+           samples_stored ? (((bytes_stored * 800) / samples_stored) % 100) : 0,
+           store_errors);
+    printk("flash: %u pages programmed (%u direct), %u bytes padded, flush %u/%u/%u us min/mean/max\n",
+           wbuf_stats.pages_programmed, wbuf_stats.direct_pages, wbuf_stats.bytes_padded,
+           wbuf_stats.flush_us_min, wbuf_stats.flush_us_mean, wbuf_stats.flush_us_max);
+    // what the consumer could sustain if it did nothing but this pipeline
+    for (int ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+        printk("channel %d sampled %u ns into the scan\n", ch, app_adc_channel_skew_ns(ch));
+    }
+    printk("pipeline capacity: %llu scans/s (busy %llu us)\n",
+           busy_ns ? (adc_stats.blocks * (uint64_t)ADC_STREAM_BLOCK_SAMPLES * NSEC_PER_SEC) / busy_ns : 0,
+           busy_ns / 1000);
+    bench_report_latency();
+    return 0;
+}
+
+//  ========== bench_query =================================================================
+// time range query over the records of the streaming run: one second from the middle of
+// the log. the search cost only depends on the number of sectors
+static void bench_query(void)
+{
+    struct app_flash_log_info info;
+    struct app_flash_log_query query;
+    struct app_flash_log_cursor cursor;
+    uint64_t first_ns = 0;
+    uint32_t records = 0;
+    uint64_t mid_ms;
+    size_t length;
+    uint64_t t;
+
+    if (app_flash_log_iter_init(&cursor) != 0 ||
+        app_flash_log_iter_next(&cursor, bench_record, sizeof(bench_record), &length) != 0) {
+        printk("query: empty log\n");
+        return;
+    }
+    app_flash_log_get_info(&info);
+    mid_ms = cursor.time_ms + ((info.last_ms - cursor.time_ms) / 2);
+
+    t = bench_now();
+    if (app_flash_log_query_init(&query, mid_ms, mid_ms + MSEC_PER_SEC) == 0) {
+        while (app_flash_log_query_next(&query, bench_record, sizeof(bench_record),
+                                        &length) == 0) {
+            if (records++ == 0) {
+                first_ns = bench_elapsed_ns(t);
+            }
+        }
+    }
+    printk("query: %u records in 1 s of %u sectors, first after %llu us, all in %llu us\n",
+           records, info.used_sectors, first_ns / 1000, bench_elapsed_ns(t) / 1000);
+}
+
+//  ========== bench_steim2 ================================================================
+// Steim-2 on the recorded waveforms: each sample record of the streaming run is decoded,
+// encoded again under the timer, decoded again and compared sample by sample. the
+// compression ratio is taken against the same samples as raw int16. records follow the
+// channels in turn, which gives the previous sample of each encode
+static void bench_steim2(void)
+{
+    struct app_flash_log_cursor cursor;
+    struct app_steim2_block_hdr hdr;
+    int32_t previous[ADC_CHANNELS_NB] = {0};
+    uint64_t samples = 0, bytes = 0;
+    uint64_t encode_ns = 0;
+    uint32_t records = 0, mismatches = 0;
+    size_t length;
+    uint64_t t;
+    int count, len;
+
+    if (app_flash_log_iter_init(&cursor) != 0) {
+        printk("steim2: empty log\n");
+        return;
+    }
+    while (app_flash_log_iter_next(&cursor, bench_record, sizeof(bench_record), &length) == 0) {
+        int32_t *prev = &previous[records++ % ADC_CHANNELS_NB];
+
+        count = app_steim2_decode(bench_record, length, &hdr, bench_decoded[0],
+                                  ADC_STREAM_BLOCK_SAMPLES);
+        if (count <= 0) {
+            mismatches++;
+            continue;
+        }
+
+        t = bench_now();
+        len = app_steim2_encode(bench_decoded[0], count, *prev, &hdr, bench_record,
+                                sizeof(bench_record));
+        encode_ns += bench_elapsed_ns(t);
+        *prev = bench_decoded[0][count - 1];
+
+        if (len <= 0 || app_steim2_decode(bench_record, len, &hdr, bench_decoded[1],
+                                          ADC_STREAM_BLOCK_SAMPLES) != count ||
+            memcmp(bench_decoded[0], bench_decoded[1], count * sizeof(int16_t)) != 0) {
+            mismatches++;
+            continue;
+        }
+        samples += count;
+        bytes += len;
+    }
+
+    printk("steim2: %u records, %llu samples, %llu ns/sample", records, samples,
+           samples ? encode_ns / samples : 0);
+#if defined(BENCH_CPU_HZ)
+    printk(" (%llu cycles)", samples ? (encode_ns * (BENCH_CPU_HZ / 1000)) /
+                                       (samples * USEC_PER_SEC) : 0);
+#endif
+    printk(", %llu.%02llu:1 against int16, %u round-trip mismatches: %s\n",
+           bytes ? (samples * 2) / bytes : 0, bytes ? ((samples * 200) / bytes) % 100 : 0,
+           mismatches, bench_check(records > 0 && mismatches == 0));
+}
+
+#if defined(CONFIG_APP_UPLINK_MOCK)
+//  ========== bench_uplink ================================================================
+// send the log of the streaming run to the mock network, then scale the frame count to
+// a day of records. the acknowledged records are trimmed, this runs last on the log
+static void bench_uplink(void)
+{
+    struct app_uplink_stats stats;
+    struct app_uplink_mock_stats mock;
+    struct app_flash_log_info info;
+    struct app_flash_log_cursor cursor;
+    uint64_t span_ms;
+    uint32_t records;
+    uint32_t last_seq;
+    size_t length;
+    uint64_t t;
+    bool ok;
+    int ret;
+
+    if (app_flash_log_iter_init(&cursor) != 0 ||
+        app_flash_log_iter_next(&cursor, bench_record, sizeof(bench_record), &length) != 0) {
+        printk("uplink: empty log\n");
+        return;
+    }
+    app_flash_log_get_info(&info);
+    span_ms = info.last_ms - cursor.time_ms;
+
+    // the records the network must end up with, each once
+    records = 1;
+    last_seq = cursor.record_seq;
+    while ((ret = app_flash_log_iter_next(&cursor, bench_record, sizeof(bench_record),
+                                          &length)) != -ENOENT) {
+        if (ret == 0) {
+            records++;
+            last_seq = cursor.record_seq;
+        }
+    }
+
+    (void)app_uplink_init(app_uplink_mock_transport());
+    t = bench_now();
+    ret = app_uplink_flush(0);
+    t = bench_elapsed_ns(t);
+    app_uplink_get_stats(&stats);
+    app_uplink_mock_get_stats(&mock);
+
+    // every record delivered once, every lost frame sent again
+    ok = ret >= 0 && mock.errors == 0 && mock.duplicates == 0 && mock.records == records &&
+         stats.records == records && mock.last_seq == last_seq && mock.frames == stats.frames &&
+         stats.failures == mock.dropped;
+    printk("uplink DR%u: %d, %u of %u records in %u frames (%u fragments), %u lost and "
+           "resent, %u duplicates, %u decode errors, %llu us: %s\n", CONFIG_APP_UPLINK_MOCK_DR,
+           ret, mock.records, records, stats.frames, stats.fragments, mock.dropped,
+           mock.duplicates, mock.errors, t / 1000, bench_check(ok));
+    printk("uplink: %llu bytes on air for %llu samples (%llu.%02llu bytes/sample), "
+           "%llu frames per day\n", stats.air_bytes, mock.samples,
+           mock.samples ? stats.air_bytes / mock.samples : 0,
+           mock.samples ? ((stats.air_bytes * 100) / mock.samples) % 100 : 0,
+           span_ms ? (stats.frames * 86400000ULL) / span_ms : 0);
+}
+#endif
+
+//  ========== bench_erase_pass ============================================================
+// appends at a steady rate into a cleared log. the latency is taken in simulated time:
+// the flash simulator busy-waits its erase and program times, the host clock does not
+// see them
+static void bench_erase_pass(uint32_t ahead)
+{
+    struct app_flash_log_info info;
+    uint64_t time_ms;
+    uint32_t errors = 0;
+    uint32_t t;
+
+    (void)app_flash_log_erase_ahead(ahead, NULL);
+    (void)app_flash_log_clear();
+    // time for the worker to get ahead before the first append
+    k_msleep(500);
+
+    app_flash_log_get_info(&info);
+    time_ms = info.last_ms;
+    memset(bench_record, 0x5A, BENCH_ERASE_RECORD);
+    for (int i = 0; i < BENCH_ERASE_APPENDS; i++) {
+        time_ms += BENCH_ERASE_PERIOD_MS;
+        t = k_cycle_get_32();
+        if (app_flash_log_append(bench_record, BENCH_ERASE_RECORD, time_ms, NULL) != 0) {
+            errors++;
+        }
+        bench_append_us[i] = k_cyc_to_us_floor32(k_cycle_get_32() - t);
+        k_msleep(BENCH_ERASE_PERIOD_MS);
+    }
+    (void)app_flash_log_sync();
+
+    app_flash_log_get_info(&info);
+    qsort(bench_append_us, BENCH_ERASE_APPENDS, sizeof(uint32_t), bench_compare);
+    printk("erase-ahead %u: append p50 %u us, p99 %u us, max %u us, %u erase stalls, "
+           "%u sectors ready, %u errors\n", ahead,
+           bench_percentile(bench_append_us, BENCH_ERASE_APPENDS, 50),
+           bench_percentile(bench_append_us, BENCH_ERASE_APPENDS, 99),
+           bench_percentile(bench_append_us, BENCH_ERASE_APPENDS, 100),
+           info.erase_stalls, info.ready_sectors, errors);
+}
+
+//  ========== bench_erase =================================================================
+// worst-case append latency with the sector erases on the append path, then erased
+// ahead in the background. clears the log
+static void bench_erase(void)
+{
+    struct app_flash_wbuf_stats wbuf_stats;
+
+    BUILD_ASSERT(BENCH_ERASE_RECORD <= sizeof(bench_record));
+
+    bench_erase_pass(0);
+    bench_erase_pass(CONFIG_APP_FLASH_LOG_ERASE_AHEAD);
+
+    app_flash_wbuf_get_stats(&wbuf_stats);
+    printk("flash: %u pages held during erases (%u at most), %u programs waited\n",
+           wbuf_stats.held_pages, wbuf_stats.held_max, wbuf_stats.erase_waits);
+}
+
+//  ========== bench_recovery_remount ======================================================
+// initializes the log again, as after a reset, and checks what the boot scan recovered:
+// the next record, the corrupt records of the head sector, the head sector left open or
+// closed, and a full log whose tail still follows the head
+static void bench_recovery_remount(const char *what, const struct device *dev,
+                                   uint32_t next_seq, uint32_t corrupt, bool closed)
+{
+    struct app_flash_log_info info;
+    uint64_t t;
+    int8_t ret;
+    bool ok;
+
+    (void)app_flash_log_sync();
+    t = bench_now();
+    ret = app_flash_log_init(dev);
+    t = bench_elapsed_ns(t);
+    app_flash_log_get_info(&info);
+    ok = (ret == 0) && info.next_record_seq == next_seq && info.corrupt == corrupt &&
+         (info.head_offset == FLASH_LOG_SECTOR_SIZE) == closed &&
+         info.used_sectors == info.sectors &&
+         info.tail_sector == (info.head_sector + 1) % info.sectors;
+    printk("recovery %s: init %d in %llu us, head %u @0x%X, tail %u, next record %u, "
+           "%u corrupt: %s\n", what, ret, t / 1000, info.head_sector, info.head_offset,
+           info.tail_sector, info.next_record_seq, info.corrupt, bench_check(ok));
+}
+
+//  ========== bench_recovery ==============================================================
+// boot-time recovery of a wrapped log: appends until the head has gone round the whole
+// partition, then remounts it clean, with the payload of the last record damaged, and
+// with a record header cut short by a power cut. clears the log
+static void bench_recovery(void)
+{
+    const struct device *dev = DEVICE_DT_GET(SPI_FLASH_DEVICE);
+    struct app_flash_log_cursor where;
+    struct app_flash_log_info info;
+    const uint8_t zero[4] = {0};
+    uint16_t torn_length = 200;
+    uint32_t first_seq;
+    uint32_t appends = 0;
+    uint64_t time_ms;
+    int8_t ret = 0;
+
+    BUILD_ASSERT(BENCH_RECOVERY_RECORD <= sizeof(bench_record));
+
+    if (!IS_ENABLED(CONFIG_APP_FLASH_LOG_OVERWRITE)) {
+        printk("recovery: the log does not wrap without CONFIG_APP_FLASH_LOG_OVERWRITE\n");
+        return;
+    }
+
+    // sectors are erased on the append path, nothing runs behind the remounts
+    (void)app_flash_log_erase_ahead(0, NULL);
+    (void)app_flash_log_clear();
+    app_flash_log_get_info(&info);
+    first_seq = info.head_seq;
+    time_ms = info.last_ms;
+    memset(bench_record, 0xA5, BENCH_RECOVERY_RECORD);
+    while (ret == 0 && info.head_seq - first_seq <= info.sectors + BENCH_RECOVERY_WRAP) {
+        time_ms += BENCH_RECOVERY_PERIOD_MS;
+        ret = app_flash_log_append(bench_record, BENCH_RECOVERY_RECORD, time_ms, &where);
+        appends++;
+        app_flash_log_get_info(&info);
+    }
+    printk("recovery: %u appends of %u bytes, head %u, tail %u of %u sectors: %s\n", appends,
+           BENCH_RECOVERY_RECORD, info.head_sector, info.tail_sector, info.sectors,
+           bench_check(ret == 0 && info.used_sectors == info.sectors));
+    if (ret != 0) {
+        return;
+    }
+    bench_recovery_remount("clean", dev, where.record_seq + 1, 0, false);
+
+    // bits of a payload cleared after its header: the record is skipped on its CRC,
+    // the next append still goes after it
+    time_ms += BENCH_RECOVERY_PERIOD_MS;
+    (void)app_flash_log_append(bench_record, BENCH_RECOVERY_RECORD, time_ms, &where);
+    (void)app_flash_log_sync();
+    (void)app_flash_wbuf_write(FLASH_LOG_OFFSET + (where.sector * FLASH_LOG_SECTOR_SIZE) +
+                               where.offset + FLASH_LOG_RECORD_HDR_SIZE +
+                               (BENCH_RECOVERY_RECORD / 2), zero, sizeof(zero));
+    bench_recovery_remount("torn payload", dev, where.record_seq + 1, 1, false);
+
+    // power cut after the length of the next header: its inverted copy is still erased,
+    // the scan closes the head sector
+    app_flash_log_get_info(&info);
+    (void)app_flash_wbuf_write(FLASH_LOG_OFFSET + (info.head_sector * FLASH_LOG_SECTOR_SIZE) +
+                               info.head_offset, &torn_length, sizeof(torn_length));
+    bench_recovery_remount("torn header", dev, where.record_seq + 1, 1, true);
+
+    // and the next record opens the following sector
+    time_ms += BENCH_RECOVERY_PERIOD_MS;
+    ret = app_flash_log_append(bench_record, BENCH_RECOVERY_RECORD, time_ms, &where);
+    printk("recovery: next append %d in sector %u @0x%X: %s\n", ret, where.sector, where.offset,
+           bench_check(ret == 0 && where.sector == (info.head_sector + 1) % info.sectors &&
+                       where.offset == FLASH_LOG_SECTOR_HDR_SIZE));
+
+    (void)app_flash_log_clear();
+    (void)app_flash_log_erase_ahead(CONFIG_APP_FLASH_LOG_ERASE_AHEAD, NULL);
+}
+
+#if defined(CONFIG_APP_DSP)
+//  ========== bench_dsp ===================================================================
+static void bench_dsp(void)
+{
+    struct app_dsp_bench_result result;
+
+    (void)app_dsp_bench(&result);
+    printk("DSP FIR %u taps, decimation %u: scalar %u cycles/output", result.taps,
+           DSP_DECIMATION, result.scalar_cycles);
+    if (result.simd) {
+        printk(", SMLALD %u cycles/output, %u mismatches\n", result.simd_cycles,
+               result.mismatches);
+    } else {
+        printk(", no dual MAC kernel on this target\n");
+    }
+    printk("DSP FIR reference vectors: %u outputs, scalar %u errors", result.golden_outputs,
+           result.scalar_errors);
+    if (result.simd) {
+        printk(", SMLALD %u errors", result.simd_errors);
+    }
+    printk(": %s\n", bench_check(result.scalar_errors == 0 && result.simd_errors == 0 &&
+                                 result.mismatches == 0));
+}
+#endif
+
+#if defined(CONFIG_APP_SPECTRUM)
+//  ========== bench_spectrum_fill =========================================================
+// white noise at the level the block floating point brings the windows to
+static void bench_spectrum_fill(int16_t *frame, uint32_t *seed)
+{
+    for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        *seed = (*seed * 1664525u) + 1013904223u;
+        frame[n] = (int16_t)((int32_t)(*seed >> 16) - 32768) / 4;
+    }
+}
+
+//  ========== bench_spectrum_sink =========================================================
+static struct app_spectrum_summary bench_summary;
+
+static int bench_spectrum_sink(const struct app_spectrum_summary *summary)
+{
+    bench_summary = *summary;
+    return 0;
+}
+
+//  ========== bench_spectrum ==============================================================
+// time per window of the FFT kernels, then of the whole analysis over two periods of a
+// synthetic sine, whose summary must find it again
+static void bench_spectrum(void)
+{
+    static int16_t frame[SPECTRUM_FFT_SIZE] __aligned(4);
+    static int16_t out[2 * SPECTRUM_FFT_SIZE] __aligned(4);
+    static int16_t block[BENCH_SPECTRUM_BLOCK];
+    struct app_spectrum_stats stats;
+    uint64_t scalar_ns = 0, analysis_ns = 0;
+    uint32_t seed = 0x2545f491;
+    uint64_t t;
+    uint32_t samples = 2 * SPECTRUM_PERIOD_SAMPLES;
+    uint8_t strongest = 0;
+
+    if (app_spectrum_init(bench_spectrum_sink) != 0) {
+        printk("spectrum: init failed: %s\n", bench_check(false));
+        return;
+    }
+
+    for (int i = 0; i < BENCH_SPECTRUM_WINDOWS; i++) {
+        bench_spectrum_fill(frame, &seed);
+        t = bench_now();
+        app_spectrum_rfft_scalar(frame, out);
+        scalar_ns += bench_elapsed_ns(t);
+    }
+    printk("spectrum %u-point FFT: scalar %llu ns/window", SPECTRUM_FFT_SIZE,
+           scalar_ns / BENCH_SPECTRUM_WINDOWS);
+#if SPECTRUM_HAS_CMSIS
+    static int16_t ref[2 * SPECTRUM_FFT_SIZE] __aligned(4);
+    uint64_t cmsis_ns = 0;
+    int32_t diff_max = 0;
+
+    seed = 0x2545f491;
+    for (int i = 0; i < BENCH_SPECTRUM_WINDOWS; i++) {
+        bench_spectrum_fill(frame, &seed);
+        t = bench_now();
+        app_spectrum_rfft_cmsis(frame, out);
+        cmsis_ns += bench_elapsed_ns(t);
+    }
+    // same input through both kernels, they differ in their rounding only
+    bench_spectrum_fill(frame, &seed);
+    memcpy(ref, frame, sizeof(frame));
+    app_spectrum_rfft_scalar(ref, out);
+    memcpy(ref, out, sizeof(out));
+    app_spectrum_rfft_cmsis(frame, out);
+    for (uint16_t k = 0; k < 2 * SPECTRUM_BINS; k++) {
+        diff_max = MAX(diff_max, abs(out[k] - ref[k]));
+    }
+    printk(", CMSIS-DSP %llu ns/window, largest difference %d LSB: %s\n",
+           cmsis_ns / BENCH_SPECTRUM_WINDOWS, diff_max,
+           bench_check(diff_max <= BENCH_SPECTRUM_DIFF_LSB));
+#else
+    printk(", no CMSIS-DSP on this build\n");
+#endif
+
+    // whole analysis: block copies, mean removal, window, FFT, power accumulation
+    for (uint32_t n = 0; n < samples; n += BENCH_SPECTRUM_BLOCK) {
+        uint16_t count = MIN(BENCH_SPECTRUM_BLOCK, samples - n);
+
+        for (uint16_t i = 0; i < count; i++) {
+            float phase = (2.0f * (float)M_PI * (BENCH_SPECTRUM_HZ + 0.3f) * (n + i)) /
+                          SPECTRUM_RATE_HZ;
+            block[i] = (int16_t)(BENCH_SPECTRUM_AMPLITUDE * sinf(phase));
+        }
+        t = bench_now();
+        app_spectrum_process(block, count, (int64_t)n * SPECTRUM_INTERVAL_US);
+        analysis_ns += bench_elapsed_ns(t);
+    }
+    app_spectrum_get_stats(&stats);
+    for (uint8_t b = 1; b < bench_summary.bands; b++) {
+        if (bench_summary.power_cb[b] > bench_summary.power_cb[strongest]) {
+            strongest = b;
+        }
+    }
+    // the peak within a bin of the sine, the RMS within 1% of amplitude / sqrt(2)
+    uint32_t sine_mhz = (BENCH_SPECTRUM_HZ * 1000) + 300;
+    uint32_t bin_mhz = (SPECTRUM_RATE_HZ * 1000) / SPECTRUM_FFT_SIZE;
+    int32_t rms = (BENCH_SPECTRUM_AMPLITUDE * 7071) / 10000;
+    bool ok = stats.summaries == 2 &&
+              abs((int32_t)bench_summary.peak_mhz - (int32_t)sine_mhz) <= (int32_t)bin_mhz &&
+              abs(bench_summary.rms - rms) <= rms / 100;
+
+    printk("spectrum analysis: %llu ns/window over %u windows, %u summaries; %u.3 Hz sine "
+           "found at %u mHz, RMS %u, strongest band %u at %d.%02d dB: %s\n",
+           analysis_ns / MAX(stats.windows, 1), stats.windows, stats.summaries,
+           BENCH_SPECTRUM_HZ, bench_summary.peak_mhz, bench_summary.rms, strongest,
+           bench_summary.power_cb[strongest] / 100, abs(bench_summary.power_cb[strongest]) % 100,
+           bench_check(ok));
+}
+#endif
+
+#if defined(CONFIG_APP_TRIGGER)
+//  ========== bench_trigger ===============================================================
+// synthetic trace: noise, then a decaying 8 Hz arrival at 60% of the run
+static int bench_trigger_sink(const int16_t *samples, uint16_t count, int64_t start_us,
+                              bool first)
+{
+    return 0;
+}
+
+static void bench_trigger(void)
+{
+    static int16_t trace[BENCH_TRIGGER_BLOCK];
+    struct app_trigger_stats stats;
+    uint32_t total = BENCH_TRIGGER_SECONDS * TRIGGER_RATE_HZ;
+    uint32_t onset = (total * 3) / 5;
+    uint32_t seed = 1;
+    uint64_t busy_ns = 0;
+
+    (void)app_trigger_init(bench_trigger_sink);
+    app_trigger_reset_stats();
+
+    for (uint32_t n = 0; n < total; n += BENCH_TRIGGER_BLOCK) {
+        uint16_t count = MIN(BENCH_TRIGGER_BLOCK, total - n);
+        uint64_t t;
+
+        for (uint16_t k = 0; k < count; k++) {
+            uint32_t i = n + k;
+            int32_t v;
+
+            seed = (seed * 1103515245u) + 12345u;
+            v = (int32_t)((seed >> 16) & 0x7) - 4;
+            if (i >= onset && i < onset + (5 * TRIGGER_RATE_HZ)) {
+                // 8 Hz sine as a triangle, amplitude halving every second
+                uint32_t dt = i - onset;
+                int32_t phase = (int32_t)((dt * 8 * 4 * 256) / TRIGGER_RATE_HZ) % 1024;
+                int32_t tri = (phase < 512) ? (phase - 256) : (768 - phase);
+                v += (tri * 2) >> (dt / TRIGGER_RATE_HZ);
+            }
+            trace[k] = (int16_t)v;
+        }
+
+        t = bench_now();
+        app_trigger_process(trace, count, (int64_t)n * TRIGGER_INTERVAL_US);
+        busy_ns += bench_elapsed_ns(t);
+    }
+
+    app_trigger_get_stats(&stats);
+    printk("trigger: %u events over %u s, detection latency %lld ms, stored %llu of %llu "
+           "samples (%llu%%), %llu ns/sample\n",
+           stats.events, BENCH_TRIGGER_SECONDS,
+           stats.events ? (stats.last_trigger_us - ((int64_t)onset * TRIGGER_INTERVAL_US)) / 1000 : -1,
+           stats.samples_out, stats.samples_in,
+           stats.samples_in ? (stats.samples_out * 100) / stats.samples_in : 0,
+           stats.samples_in ? busy_ns / stats.samples_in : 0);
+}
+
+//  ========== bench_trigger_inject ========================================================
+// known arrival: a square burst that triggers on its first sample, fed one sample at a
+// time once it starts so that the trigger-off sample is known exactly
+static struct {
+    uint32_t blocks;
+    uint32_t stored;
+    uint32_t gaps;
+    int64_t first_us;
+    int64_t next_us;
+} bench_inject;
+
+static int bench_inject_sink(const int16_t *samples, uint16_t count, int64_t start_us,
+                             bool first)
+{
+    if (first && bench_inject.blocks == 0) {
+        bench_inject.first_us = start_us;
+    } else if (first || start_us != bench_inject.next_us) {
+        bench_inject.gaps++;
+    }
+    bench_inject.blocks++;
+    bench_inject.stored += count;
+    bench_inject.next_us = start_us + ((int64_t)count * TRIGGER_INTERVAL_US);
+    return 0;
+}
+
+static int16_t bench_inject_sample(uint32_t i, uint32_t onset, uint32_t burst, uint32_t *seed)
+{
+    int32_t v;
+
+    *seed = (*seed * 1103515245u) + 12345u;
+    v = (int32_t)((*seed >> 16) & 0x7) - 4;
+    if (i >= onset && i < onset + burst) {
+        v += ((i - onset) & 1) ? -BENCH_TRIGGER_AMPLITUDE : BENCH_TRIGGER_AMPLITUDE;
+    }
+    return (int16_t)v;
+}
+
+static void bench_trigger_inject(void)
+{
+    static int16_t trace[BENCH_TRIGGER_BLOCK];
+    struct app_trigger_config config;
+    struct app_trigger_stats stats;
+    // past the LTA warm-up with a full pre-trigger ring
+    uint32_t onset = TRIGGER_MS_TO_SAMPLES(CONFIG_APP_TRIGGER_LTA_MS + CONFIG_APP_TRIGGER_PRE_MS) +
+                     TRIGGER_RATE_HZ;
+    uint32_t burst = TRIGGER_MS_TO_SAMPLES(BENCH_TRIGGER_BURST_MS);
+    uint32_t sta = TRIGGER_MS_TO_SAMPLES(CONFIG_APP_TRIGGER_STA_MS);
+    uint32_t pre, post, min_len, max_len, event_len = 0;
+    int64_t onset_us = (int64_t)onset * TRIGGER_INTERVAL_US;
+    uint32_t seed = 7;
+    uint32_t n = 0;
+    bool ok;
+
+    memset(&bench_inject, 0, sizeof(bench_inject));
+    (void)app_trigger_init(bench_inject_sink);
+    app_trigger_get_config(&config);
+    app_trigger_reset_stats();
+    pre = TRIGGER_MS_TO_SAMPLES(config.pre_ms);
+    post = TRIGGER_MS_TO_SAMPLES(config.post_ms);
+
+    // quiet input up to the arrival
+    while (n < onset) {
+        uint16_t count = MIN(BENCH_TRIGGER_BLOCK, onset - n);
+
+        for (uint16_t k = 0; k < count; k++) {
+            trace[k] = bench_inject_sample(n + k, onset, burst, &seed);
+        }
+        app_trigger_process(trace, count, (int64_t)n * TRIGGER_INTERVAL_US);
+        n += count;
+    }
+
+    // the burst, the STA decay and the post-trigger, up to the trigger-off
+    max_len = burst + post + (16 * sta) + 1;
+    while (n < onset + max_len + 1) {
+        trace[0] = bench_inject_sample(n, onset, burst, &seed);
+        app_trigger_process(trace, 1, (int64_t)n * TRIGGER_INTERVAL_US);
+        n++;
+        if (!app_trigger_active()) {
+            event_len = n - onset;
+            break;
+        }
+    }
+    app_trigger_get_stats(&stats);
+
+    // triggered on the onset sample, stored the ring, then every sample to the trigger-off
+    min_len = burst + post;
+    ok = stats.events == 1 && stats.last_trigger_us == onset_us &&
+         bench_inject.first_us == onset_us - ((int64_t)pre * TRIGGER_INTERVAL_US) &&
+         bench_inject.gaps == 0 && event_len >= min_len && event_len <= max_len &&
+         bench_inject.stored == pre + event_len && stats.samples_out == bench_inject.stored;
+    printk("trigger injection: onset %lld ms, trigger at %lld ms, first stored sample at %lld ms "
+           "(%u pre-trigger), %u samples stored in %u blocks (event %u, expected %u..%u), "
+           "%u gaps: %s\n",
+           onset_us / 1000, stats.events ? stats.last_trigger_us / 1000 : -1,
+           bench_inject.blocks ? bench_inject.first_us / 1000 : -1, pre, bench_inject.stored,
+           bench_inject.blocks, event_len, min_len, max_len, bench_inject.gaps, bench_check(ok));
+}
+#endif
+
+#if defined(CONFIG_I2C_EMUL)
+//  ========== bench_i2c_pass ==============================================================
+static void bench_i2c_pass(const struct device *i2c_dev, const char *name, uint32_t delay_us,
+                           uint32_t stall_every, uint32_t stall_ms)
+{
+    struct app_ds3231_i2c_stats before, after;
+    uint32_t sync_us, sync_max_us = 0;
+    uint32_t failed = 0;
+    int64_t t;
+
+    app_ds3231_emul_set_delay(delay_us, stall_every, stall_ms);
+    app_ds3231_get_i2c_stats(&before);
+    for (int i = 0; i < BENCH_I2C_SYNCS; i++) {
+        t = k_uptime_ticks();
+        if (app_ds3231_sync_uptime(i2c_dev) != 0) {
+            failed++;
+        }
+        sync_us = (uint32_t)k_ticks_to_us_ceil64(k_uptime_ticks() - t);
+        sync_max_us = MAX(sync_max_us, sync_us);
+    }
+    app_ds3231_get_i2c_stats(&after);
+
+    printk("DS3231 %s: %u/%u syncs, longest %u us, %u retries, %u timeouts, "
+           "transfer max %u us\n", name, BENCH_I2C_SYNCS - failed, BENCH_I2C_SYNCS,
+           sync_max_us, after.retries - before.retries, after.timeouts - before.timeouts,
+           after.latency_us_max);
+}
+
+//  ========== bench_i2c ===================================================================
+// DS3231 syncs over an emulated bus of a plausible speed, then one that stalls a transfer
+// past the timeout: the sync thread sleeps through both, the stall costs retries only
+static void bench_i2c(const struct device *i2c_dev)
+{
+    bench_i2c_pass(i2c_dev, "100 kHz", 800, 0, 0);
+    bench_i2c_pass(i2c_dev, "stalls", 800, 4, 2 * CONFIG_APP_DS3231_I2C_TIMEOUT_MS);
+    app_ds3231_emul_set_delay(CONFIG_APP_DS3231_EMUL_DELAY_US, CONFIG_APP_DS3231_EMUL_STALL_EVERY,
+                              CONFIG_APP_DS3231_EMUL_STALL_MS);
+}
+#endif
+
+//  ========== bench_rtc ===================================================================
+// cost of a microsecond timestamp from the extended RTC, and of its fixed-point tick
+// conversion against the 64-bit division it replaces, checked over ten years of ticks.
+// then the extension itself, on a simulated counter
+static void bench_rtc(void)
+{
+    const struct device *rtc_dev = app_rtc_init();
+    volatile uint64_t sink = 0;
+    struct app_rtc_wrap_result wraps;
+    uint32_t mismatches = 0;
+    uint32_t frequency;
+    uint64_t step;
+    uint64_t scale_ns, div_ns, now_ns;
+    uint64_t t;
+
+    if (!rtc_dev) {
+        printk("RTC: not ready\n");
+        return;
+    }
+    frequency = counter_get_frequency(rtc_dev);
+    step = (10ULL * 365 * 24 * 3600 * frequency) / BENCH_RTC_CONVERSIONS;
+
+    for (uint64_t i = 0, ticks = 0; i < BENCH_RTC_CONVERSIONS; i++, ticks += step + i) {
+        if (app_rtc_ticks_to_us(ticks) != (ticks * USEC_PER_SEC) / frequency) {
+            mismatches++;
+        }
+    }
+
+    t = bench_now();
+    for (uint64_t i = 0, ticks = 0; i < BENCH_RTC_CONVERSIONS; i++, ticks += step + i) {
+        sink += app_rtc_ticks_to_us(ticks);
+    }
+    scale_ns = bench_elapsed_ns(t);
+    t = bench_now();
+    for (uint64_t i = 0, ticks = 0; i < BENCH_RTC_CONVERSIONS; i++, ticks += step + i) {
+        sink += (ticks * USEC_PER_SEC) / frequency;
+    }
+    div_ns = bench_elapsed_ns(t);
+    t = bench_now();
+    for (int i = 0; i < BENCH_RTC_CONVERSIONS; i++) {
+        sink += (uint64_t)app_rtc_now_us();
+    }
+    now_ns = bench_elapsed_ns(t);
+
+    printk("RTC %u Hz: tick to us %llu ns (division %llu ns), timestamp %llu ns, %u mismatches\n",
+           frequency, scale_ns / BENCH_RTC_CONVERSIONS, div_ns / BENCH_RTC_CONVERSIONS,
+           now_ns / BENCH_RTC_CONVERSIONS, mismatches);
+
+    // 24-bit counter wraps with the callback on time, late, and inside a read
+    (void)app_rtc_bench_wraps(BENCH_RTC_WRAPS, &wraps);
+    printk("RTC extension: %u wraps of a 24-bit counter, %u reads (%u with a wrap pending), "
+           "%u wrong, %u backwards: %s\n", wraps.wraps, wraps.reads, wraps.pending_reads,
+           wraps.errors, wraps.backwards,
+           bench_check(wraps.wraps == BENCH_RTC_WRAPS && wraps.errors == 0 &&
+                       wraps.backwards == 0));
+}
+
+//  ========== bench_clock_ref_us ==========================================================
+// reference time of a local time, for a local oscillator off by BENCH_CLOCK_DRIFT_PPB
+static inline int64_t bench_clock_ref_us(int64_t local0_us, int64_t local_us)
+{
+    int64_t dt = local_us - local0_us;
+
+    return ((int64_t)CONFIG_APP_CLOCK_PROVISION_TIME * USEC_PER_SEC) + 123456 + dt +
+           ((dt * BENCH_CLOCK_DRIFT_PPB) / 1000000000);
+}
+
+//  ========== bench_clock =================================================================
+// the discipline against a drifting local clock: one-second reference reads at the sync
+// intervals it asks for, as from the DS3231 registers. the drift has to be found within
+// the DS3231 accuracy, and half way to each sync of the second half the time has to be
+// within the uncertainty reported at the sync. a gross error then steps the clock and
+// restarts the estimate. the clock is disciplined again against the DS3231 at the end
+static void bench_clock(const struct device *i2c_dev)
+{
+    struct app_clock_status status;
+    int64_t local0_us = (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    int64_t local_us = local0_us;
+    int64_t ref_us, mid_us, error_us;
+    int64_t worst_us = 0;
+    uint32_t interval_s = 0;
+    uint32_t outside = 0;
+    bool ok;
+
+    app_clock_init();
+    for (int i = 0; i < BENCH_CLOCK_SYNCS; i++) {
+        local_us += (int64_t)interval_s * USEC_PER_SEC;
+        // register read: the second is truncated, its middle is the unbiased estimate
+        ref_us = bench_clock_ref_us(local0_us, local_us);
+        ref_us = ((ref_us / USEC_PER_SEC) * USEC_PER_SEC) + (USEC_PER_SEC / 2);
+        (void)app_clock_update(local_us, ref_us, USEC_PER_SEC);
+
+        interval_s = app_clock_next_sync_s();
+        if (i >= BENCH_CLOCK_SYNCS / 2) {
+            app_clock_get_status(&status);
+            mid_us = local_us + (((int64_t)interval_s * USEC_PER_SEC) / 2);
+            error_us = app_clock_at_us(mid_us) - bench_clock_ref_us(local0_us, mid_us);
+            error_us = (error_us < 0) ? -error_us : error_us;
+            worst_us = MAX(worst_us, error_us);
+            if (error_us > status.uncertainty_us) {
+                outside++;
+            }
+        }
+    }
+    app_clock_get_status(&status);
+    ok = (status.steps == 1) && (outside == 0) &&
+         (status.drift_ppb >= BENCH_CLOCK_DRIFT_PPB - CLOCK_HOLDOVER_PPB) &&
+         (status.drift_ppb <= BENCH_CLOCK_DRIFT_PPB + CLOCK_HOLDOVER_PPB);
+    printk("clock: %d ppb drift estimated at %d ppb after %u syncs (%u s apart at the end), "
+           "worst error %lld us, %u beyond the uncertainty (%u us): %s\n",
+           BENCH_CLOCK_DRIFT_PPB, status.drift_ppb, BENCH_CLOCK_SYNCS, interval_s, worst_us,
+           outside, status.uncertainty_us, bench_check(ok));
+
+    local_us += (int64_t)interval_s * USEC_PER_SEC;
+    (void)app_clock_update(local_us, bench_clock_ref_us(local0_us, local_us) +
+                           (10 * CLOCK_STEP_US), USEC_PER_SEC);
+    app_clock_get_status(&status);
+    printk("clock: step of %lld ms, %u steps, drift %d ppb, next sync in %u s: %s\n",
+           (10 * CLOCK_STEP_US) / 1000, status.steps, status.drift_ppb,
+           status.sync_interval_s, bench_check(status.steps == 2 && status.drift_ppb == 0 &&
+                                               status.sync_interval_s == CLOCK_SYNC_MIN_S));
+
+    app_clock_init();
+    (void)app_ds3231_periodic_sync(i2c_dev);
+}
+
+//  ========== bench_seqlock_tick ===========================================================
+static void bench_seqlock_tick(struct k_timer *timer)
+{
+    k_sem_give(&bench_seqlock_state.rtc_wake);
+    k_sem_give(&bench_seqlock_state.clock_wake);
+}
+
+//  ========== bench_seqlock_rtc_writer ====================================================
+static void bench_seqlock_rtc_writer(void *p1, void *p2, void *p3)
+{
+    uint64_t target_ms;
+
+    while (!atomic_get(&bench_seqlock_state.stop)) {
+        if (k_sem_take(&bench_seqlock_state.rtc_wake, K_MSEC(100)) != 0) {
+            continue;
+        }
+        target_ms = bench_seqlock_state.rtc_base_ms +
+                    ((bench_seqlock_state.rtc_writes & 1) ? BENCH_SEQLOCK_RTC_STEP_MS : 0);
+        (void)app_rtc_set_time(bench_seqlock_state.rtc_dev, target_ms);
+        bench_seqlock_state.rtc_writes++;
+    }
+}
+
+//  ========== bench_seqlock_clock_writer ==================================================
+// every sample is a step: the local times are two offsets apart, so that the reference
+// never goes backwards
+static void bench_seqlock_clock_writer(void *p1, void *p2, void *p3)
+{
+    int64_t local_us;
+
+    while (!atomic_get(&bench_seqlock_state.stop) &&
+           bench_seqlock_state.clock_writes < BENCH_SEQLOCK_WRITES) {
+        if (k_sem_take(&bench_seqlock_state.clock_wake, K_MSEC(100)) != 0) {
+            continue;
+        }
+        local_us = bench_seqlock_state.clock_local_us +
+                   ((int64_t)bench_seqlock_state.clock_writes * 2 * BENCH_SEQLOCK_CLOCK_STEP_US);
+        (void)app_clock_update(local_us, local_us + ((bench_seqlock_state.clock_writes & 1) ?
+                                                     BENCH_SEQLOCK_CLOCK_STEP_US : 0), 0);
+        bench_seqlock_state.clock_writes++;
+    }
+}
+
+//  ========== bench_seqlock_reader ========================================================
+static void bench_seqlock_reader(void *p1, void *p2, void *p3)
+{
+    uint32_t id = POINTER_TO_UINT(p1);
+    int64_t window_us = (BENCH_SEQLOCK_MS + MSEC_PER_SEC) * USEC_PER_MSEC;
+    int64_t rtc_us, rtc_ms, clock_us;
+    uint64_t t;
+
+    while (!atomic_get(&bench_seqlock_state.stop)) {
+        t = bench_now();
+        rtc_us = app_rtc_now_us() - (int64_t)(bench_seqlock_state.rtc_base_ms * USEC_PER_MSEC);
+        bench_seqlock_state.rtc_worst_ns[id] = MAX(bench_seqlock_state.rtc_worst_ns[id],
+                                                   bench_elapsed_ns(t));
+        rtc_ms = (int64_t)app_rtc_get_time() - (int64_t)bench_seqlock_state.rtc_base_ms;
+
+        t = bench_now();
+        clock_us = app_clock_at_us(bench_seqlock_state.clock_query_us) -
+                   bench_seqlock_state.clock_query_us;
+        bench_seqlock_state.clock_worst_ns[id] = MAX(bench_seqlock_state.clock_worst_ns[id],
+                                                     bench_elapsed_ns(t));
+
+        // a set RTC runs on from either time; the clock, without drift, is either offset
+        if (rtc_us >= BENCH_SEQLOCK_RTC_STEP_MS * USEC_PER_MSEC) {
+            rtc_us -= BENCH_SEQLOCK_RTC_STEP_MS * USEC_PER_MSEC;
+        }
+        if (rtc_ms >= BENCH_SEQLOCK_RTC_STEP_MS) {
+            rtc_ms -= BENCH_SEQLOCK_RTC_STEP_MS;
+        }
+        if (rtc_us < 0 || rtc_us > window_us || rtc_ms < 0 || rtc_ms > window_us / 1000 ||
+            (clock_us != 0 && clock_us != BENCH_SEQLOCK_CLOCK_STEP_US)) {
+            bench_seqlock_state.errors[id]++;
+        }
+        bench_seqlock_state.reads[id]++;
+#if defined(CONFIG_ARCH_POSIX)
+        // native_sim only moves its clock, and so fires the timer, in busy waits
+        k_busy_wait(10);
+#endif
+        k_yield();
+    }
+}
+
+//  ========== bench_seqlock ===============================================================
+// concurrent readers and writers of the seqlock-protected RTC offsets and clock model.
+// the writers preempt the readers at the timer period, inside a read on the board. the
+// clock is disciplined again against the DS3231 at the end, the RTC set back on time
+static void bench_seqlock(const struct device *i2c_dev)
+{
+    struct k_timer timer;
+    uint32_t reads = 0, errors = 0;
+    uint64_t rtc_worst_ns = 0, clock_worst_ns = 0;
+    uint64_t start;
+
+    memset(&bench_seqlock_state, 0, sizeof(bench_seqlock_state));
+    bench_seqlock_state.rtc_dev = app_rtc_init();
+    if (!bench_seqlock_state.rtc_dev) {
+        printk("seqlock: no RTC\n");
+        return;
+    }
+    k_sem_init(&bench_seqlock_state.rtc_wake, 0, 1);
+    k_sem_init(&bench_seqlock_state.clock_wake, 0, 1);
+    bench_seqlock_state.rtc_base_ms = app_rtc_get_time();
+
+    // a clock without drift or checkpoint, already stepped once when the readers start
+    app_clock_init();
+    bench_seqlock_state.clock_local_us = (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    bench_seqlock_state.clock_query_us = bench_seqlock_state.clock_local_us +
+        ((int64_t)(BENCH_SEQLOCK_WRITES + 1) * 2 * BENCH_SEQLOCK_CLOCK_STEP_US);
+    (void)app_clock_update(bench_seqlock_state.clock_local_us,
+                           bench_seqlock_state.clock_local_us, 0);
+    bench_seqlock_state.clock_writes = 1;
+
+    start = bench_now();
+    for (int i = 0; i < BENCH_SEQLOCK_THREADS; i++) {
+        k_thread_entry_t entry = (i == 0) ? bench_seqlock_rtc_writer :
+                                 (i == 1) ? bench_seqlock_clock_writer : bench_seqlock_reader;
+
+        k_thread_create(&bench_seqlock_threads[i], bench_seqlock_stacks[i],
+                        K_THREAD_STACK_SIZEOF(bench_seqlock_stacks[i]), entry,
+                        UINT_TO_POINTER(i - 2), NULL, NULL,
+                        (i < 2) ? CONFIG_APP_ACQ_PRIORITY : CONFIG_APP_STORAGE_PRIORITY, 0,
+                        K_NO_WAIT);
+        k_thread_name_set(&bench_seqlock_threads[i], (i < 2) ? "bench_writer" : "bench_reader");
+    }
+    k_timer_init(&timer, bench_seqlock_tick, NULL);
+    k_timer_start(&timer, K_USEC(BENCH_SEQLOCK_PERIOD_US), K_USEC(BENCH_SEQLOCK_PERIOD_US));
+    k_msleep(BENCH_SEQLOCK_MS);
+    k_timer_stop(&timer);
+    atomic_set(&bench_seqlock_state.stop, 1);
+    for (int i = 0; i < BENCH_SEQLOCK_THREADS; i++) {
+        (void)k_thread_join(&bench_seqlock_threads[i], K_FOREVER);
+    }
+
+    for (int i = 0; i < BENCH_SEQLOCK_READERS; i++) {
+        reads += bench_seqlock_state.reads[i];
+        errors += bench_seqlock_state.errors[i];
+        rtc_worst_ns = MAX(rtc_worst_ns, bench_seqlock_state.rtc_worst_ns[i]);
+        clock_worst_ns = MAX(clock_worst_ns, bench_seqlock_state.clock_worst_ns[i]);
+    }
+    printk("seqlock: %u RTC and %u clock writes, %u reads by %u threads, worst read RTC "
+           "%llu ns, clock %llu ns, %u inconsistent: %s\n", bench_seqlock_state.rtc_writes,
+           bench_seqlock_state.clock_writes, reads, BENCH_SEQLOCK_READERS, rtc_worst_ns,
+           clock_worst_ns, errors, bench_check(reads > 0 && errors == 0));
+
+    (void)app_rtc_set_time(bench_seqlock_state.rtc_dev, bench_seqlock_state.rtc_base_ms +
+                           (bench_elapsed_ns(start) / NSEC_PER_MSEC));
+    app_clock_init();
+    (void)app_ds3231_periodic_sync(i2c_dev);
+}
+
+//  ========== bench_logging ===============================================================
+// per-sample cost of the two messages the one-shot ADC read used to print: printk as
+// before, a deferred LOG_INF that only packages its arguments, and LOG_DBG below the
+// module level which compiles to nothing. then the one-shot read itself
+static void bench_logging(void)
+{
+    uint64_t printk_ns = 0, log_ns = 0, dbg_ns = 0, read_ns = 0;
+    uint64_t t;
+
+    for (int16_t i = 0; i < BENCH_LOG_SAMPLES; i++) {
+        t = bench_now();
+        printk("raw adc value: %d\n", 2048 + i);
+        printk("velocity: %d mV\n", app_nrf52_adc_to_mv(2048 + i));
+        printk_ns += bench_elapsed_ns(t);
+
+        t = bench_now();
+        LOG_INF("raw adc value: %d", 2048 + i);
+        LOG_INF("velocity: %d mV", app_nrf52_adc_to_mv(2048 + i));
+        log_ns += bench_elapsed_ns(t);
+
+        t = bench_now();
+        LOG_DBG("raw adc value: %d", 2048 + i);
+        LOG_DBG("velocity: %d mV", app_nrf52_adc_to_mv(2048 + i));
+        dbg_ns += bench_elapsed_ns(t);
+
+        t = bench_now();
+        (void)app_nrf52_get_adc();
+        read_ns += bench_elapsed_ns(t);
+    }
+
+    printk("logging per sample: printk %llu ns, deferred LOG_INF %llu ns, LOG_DBG off %llu ns; "
+           "one-shot ADC read %llu ns\n", printk_ns / BENCH_LOG_SAMPLES, log_ns / BENCH_LOG_SAMPLES,
+           dbg_ns / BENCH_LOG_SAMPLES, read_ns / BENCH_LOG_SAMPLES);
+}
+
+//  ========== bench_crc_run ===============================================================
+// ns spent on BENCH_CRC_ROUNDS passes of one CRC implementation over bench_record
+static uint64_t bench_crc_run(uint32_t (*crc_fn)(uint32_t, const uint8_t *, size_t),
+                              uint32_t *crc)
+{
+    uint64_t ns = 0;
+    uint64_t t;
+
+    for (int i = 0; i < BENCH_CRC_ROUNDS; i++) {
+        t = bench_now();
+        *crc = crc_fn(0, bench_record, sizeof(bench_record));
+        ns += bench_elapsed_ns(t);
+    }
+    return ns;
+}
+
+//  ========== bench_crc_table =============================================================
+static uint32_t bench_crc_table(uint32_t crc, const uint8_t *data, size_t length)
+{
+    return app_crc32_update(crc, data, length);
+}
+
+//  ========== bench_crc ===================================================================
+// throughput of the record CRC, against the nibble-table crc32_ieee_update() when the
+// Zephyr CRC library is built in
+static void bench_crc(void)
+{
+    uint64_t bytes = (uint64_t)BENCH_CRC_ROUNDS * sizeof(bench_record);
+    uint64_t table_ns;
+    uint32_t table_crc;
+
+    for (size_t i = 0; i < sizeof(bench_record); i++) {
+        bench_record[i] = (uint8_t)((i * 31u) ^ (i >> 3));
+    }
+
+    table_ns = bench_crc_run(bench_crc_table, &table_crc);
+    printk("CRC-32 table: %llu bytes in %llu us, %llu kB/s", bytes, table_ns / 1000,
+           table_ns ? (bytes * 1000000ULL) / table_ns : 0);
+#if !defined(CONFIG_ARCH_POSIX)
+    // bytes per 1000 CPU cycles, the cost per record is length / this
+    printk(", %llu bytes/kcycle", table_ns ?
+           (bytes * NSEC_PER_SEC) / ((table_ns * sys_clock_hw_cycles_per_sec()) / 1000) : 0);
+#endif
+    printk("\n");
+
+#if defined(CONFIG_CRC)
+    uint32_t ieee_crc;
+    uint64_t ieee_ns = bench_crc_run(crc32_ieee_update, &ieee_crc);
+
+    printk("CRC-32 crc32_ieee_update: %llu us, %llu kB/s, CRC %08x against %08x: %s\n",
+           ieee_ns / 1000, ieee_ns ? (bytes * 1000000ULL) / ieee_ns : 0, ieee_crc, table_crc,
+           bench_check(ieee_crc == table_crc));
+#endif
+}
+
+//  ========== bench_stack_thread ==========================================================
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO) && \
+    defined(CONFIG_THREAD_MONITOR)
+static void bench_stack_thread(const struct k_thread *thread, void *user_data)
+{
+    const char *name = k_thread_name_get((k_tid_t)thread);
+    size_t size = thread->stack_info.size;
+    size_t unused;
+    size_t used;
+
+    ARG_UNUSED(user_data);
+
+    if (k_thread_stack_space_get(thread, &unused) != 0) {
+        return;
+    }
+    used = size - unused;
+    printk("stack %-16s %5u of %5u bytes, suggested %5u\n", (name && name[0]) ? name : "?",
+           (unsigned int)used, (unsigned int)size,
+           (unsigned int)ROUND_UP(used + ((used * BENCH_STACK_MARGIN_PCT) / 100),
+                                  BENCH_STACK_ALIGN));
+}
+#endif
+
+//  ========== bench_stacks ================================================================
+// peak stack use of every thread at the end of the run, the figures the *_STACK_SIZE
+// options are set from. needs CONFIG_INIT_STACKS, THREAD_STACK_INFO and THREAD_MONITOR
+// (bench.conf)
+static void bench_stacks(void)
+{
+#if defined(CONFIG_ARCH_POSIX)
+    // the threads run on host stacks, their Zephyr stacks stay untouched
+    printk("stack use: measured on the board only, build/stack_usage.txt has the static "
+           "estimate\n");
+#elif defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO) && \
+    defined(CONFIG_THREAD_MONITOR)
+    k_thread_foreach_unlocked(bench_stack_thread, NULL);
+#endif
+}
+
+//  ========== app_bench_run ===============================================================
+int8_t app_bench_run(const struct device *i2c_dev)
+{
+    uint64_t t;
+    int8_t ret;
+
+    printk("pipeline benchmark\n");
+    bench_failures = 0;
+
+    // one reference sync through the (emulated) DS3231
+    t = bench_now();
+    ret = app_ds3231_periodic_sync(i2c_dev);
+    printk("DS3231 sync: %d, %llu us\n", ret, bench_elapsed_ns(t) / 1000);
+#if defined(CONFIG_I2C_EMUL)
+    bench_i2c(i2c_dev);
+#endif
+
+#if defined(CONFIG_APP_PROBE)
+    app_probe_reset();
+#endif
+    ret = bench_stream();
+#if defined(CONFIG_APP_PROBE)
+    app_probe_dump();
+#endif
+    bench_query();
+    bench_steim2();
+#if defined(CONFIG_APP_UPLINK_MOCK)
+    bench_uplink();
+#endif
+    bench_erase();
+    bench_recovery();
+#if defined(CONFIG_APP_DSP)
+    bench_dsp();
+#endif
+#if defined(CONFIG_APP_SPECTRUM)
+    bench_spectrum();
+#endif
+#if defined(CONFIG_APP_TRIGGER)
+    bench_trigger();
+    bench_trigger_inject();
+#endif
+    bench_crc();
+    bench_rtc();
+    bench_clock(i2c_dev);
+    bench_seqlock(i2c_dev);
+    bench_logging();
+    bench_stacks();
+
+    printk("pipeline benchmark done, %u checks failed\n", bench_failures);
+    return (ret == 0 && bench_failures > 0) ? -EIO : ret;
+}
+
+#endif /* CONFIG_APP_BENCH */
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_BENCH_H
+#define APP_BENCH_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+//  ========== defines =====================================================================
+#define BENCH_DURATION_S            CONFIG_APP_BENCH_DURATION_S
+#define BENCH_LATENCY_SAMPLES       CONFIG_APP_BENCH_LATENCY_SAMPLES
+
+//  ========== prototypes ==================================================================
+int8_t app_bench_run(const struct device *i2c_dev);
+
+#endif /* APP_BENCH_H */
@@ -0,0 +1,450 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_clock.h"
+
+#if defined(CONFIG_APP_CLOCK_PERSIST)
+#include <zephyr/settings/settings.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_clock, CONFIG_APP_TIME_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define CLOCK_SETTINGS_ROOT         "clock"
+#define CLOCK_SETTINGS_STATE        "state"
+#define CLOCK_CHECKPOINT_VERSION    1
+
+//  ========== types =======================================================================
+// piecewise-linear model of the reference time as a function of the local uptime:
+// ref(t) = base_ref + dt + dt * drift + clamp(slew, +/- dt * slew_max), dt = t - base_local
+struct clock_model {
+    bool valid;
+    int64_t base_local_us;
+    int64_t base_ref_us;
+    int32_t drift_ppb;
+    int64_t slew_us;
+    uint32_t uncertainty_us;    // at base_local_us
+};
+
+// discipline state kept across resets, saved after every sync. the uptime restarts at 0
+// on a reset, so the offset only relates to the previous boot: the drift of the local
+// oscillator and the sync interval are what carries over
+struct clock_checkpoint {
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t resolution_us;     // quality of the last reference: 1 s register read or SQW edge
+    int64_t ref_us;             // reference time of the last sync
+    int64_t offset_us;          // reference minus local uptime at the last sync
+    int32_t drift_ppb;
+    uint32_t interval_s;
+};
+
+//  ========== globals =====================================================================
+// published model, read lock-free on every timestamp
+static struct {
+    struct app_seqlock lock;
+    struct clock_model model;
+} clock_pub;
+
+// estimator state, only touched by the sync path
+static struct {
+    int64_t local_us[CLOCK_WINDOW];
+    int64_t offset_us[CLOCK_WINDOW];    // reference minus local uptime
+    uint8_t count;
+    uint8_t next;
+    uint32_t interval_s;
+    uint32_t samples;
+    uint32_t steps;
+    bool restored;              // drift and interval restored from a checkpoint
+    bool restore_pending;       // the first sample keeps them
+    bool persist;               // settings loaded, checkpoints are saved
+    int64_t checkpoint_us;      // the reference never goes back before the last checkpoint
+} clock_est = { .interval_s = CLOCK_SYNC_MIN_S };
+
+#if defined(CONFIG_APP_CLOCK_PERSIST)
+static struct clock_checkpoint clock_saved;
+static bool clock_saved_valid;
+#endif
+
+// statically defined, the sync thread may poll the interval before app_clock_init()
+K_MUTEX_DEFINE(clock_mutex);
+
+//  ========== clock_model_eval ============================================================
+static int64_t clock_model_eval(const struct clock_model *m, int64_t local_us)
+{
+    int64_t dt = MAX(local_us - m->base_local_us, 0);
+    int64_t slew_max = (dt * CLOCK_SLEW_MAX_PPM) / 1000000;
+
+    return m->base_ref_us + dt + ((dt * m->drift_ppb) / 1000000000) +
+           CLAMP(m->slew_us, -slew_max, slew_max);
+}
+
+//  ========== clock_model_read ============================================================
+static void clock_model_read(struct clock_model *m)
+{
+    uint32_t seq;
+
+    do {
+        seq = app_seqlock_read_begin(&clock_pub.lock);
+        *m = clock_pub.model;
+    } while (app_seqlock_read_retry(&clock_pub.lock, seq));
+}
+
+//  ========== clock_model_publish =========================================================
+static void clock_model_publish(const struct clock_model *m)
+{
+    k_spinlock_key_t key = app_seqlock_write_begin(&clock_pub.lock);
+    clock_pub.model = *m;
+    app_seqlock_write_end(&clock_pub.lock, key);
+}
+
+//  ========== clock_local_now_us ==========================================================
+static inline int64_t clock_local_now_us(void)
+{
+    return (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+//  ========== clock_isqrt =================================================================
+static uint32_t clock_isqrt(uint64_t value)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > value) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (value >= root + bit) {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)MIN(root, UINT32_MAX);
+}
+
+//  ========== clock_window_add ============================================================
+static void clock_window_add(int64_t local_us, int64_t offset_us)
+{
+    clock_est.local_us[clock_est.next] = local_us;
+    clock_est.offset_us[clock_est.next] = offset_us;
+    clock_est.next = (clock_est.next + 1) % CLOCK_WINDOW;
+    clock_est.count = MIN(clock_est.count + 1, CLOCK_WINDOW);
+}
+
+//  ========== clock_fit ===================================================================
+// least-squares line through the offset samples, relative to the newest one. x in
+// seconds and y bounded by the step threshold keep every sum well inside 64 bits for a
+// window spanning days. returns the fitted offset at the newest sample, the slope in
+// ppb and the RMS residual in us
+static int64_t clock_fit(int32_t *drift_ppb, uint32_t *rms_us)
+{
+    uint8_t n = clock_est.count;
+    uint8_t newest = (clock_est.next + CLOCK_WINDOW - 1) % CLOCK_WINDOW;
+    int64_t x0 = clock_est.local_us[newest];
+    int64_t y0 = clock_est.offset_us[newest];
+    int64_t sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int64_t x, y, r, den, intercept;
+    uint64_t sq = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+        x = (clock_est.local_us[i] - x0) / 1000000;
+        y = clock_est.offset_us[i] - y0;
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+
+    den = (n * sxx) - (sx * sx);
+    if (n < 2 || den == 0) {
+        *rms_us = 0;
+        return y0;
+    }
+
+    // us per second is ppm, scaled to ppb
+    *drift_ppb = (int32_t)((((n * sxy) - (sx * sy)) * 1000) / den);
+    intercept = (sy - ((sx * *drift_ppb) / 1000)) / n;
+
+    for (uint8_t i = 0; i < n; i++) {
+        x = (clock_est.local_us[i] - x0) / 1000000;
+        y = clock_est.offset_us[i] - y0;
+        r = y - (intercept + ((x * *drift_ppb) / 1000));
+        sq += (uint64_t)(r * r);
+    }
+    *rms_us = clock_isqrt(sq / n);
+
+    return y0 + intercept;
+}
+
+#if defined(CONFIG_APP_CLOCK_PERSIST)
+//  ========== clock_settings_set ==========================================================
+// called by settings_load_subtree() for the entries under "clock/"
+static int clock_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                              void *cb_arg)
+{
+    const char *next;
+    ssize_t ret;
+
+    if (!settings_name_steq(name, CLOCK_SETTINGS_STATE, &next) || next) {
+        return -ENOENT;
+    }
+    if (len != sizeof(clock_saved)) {
+        return -EINVAL;
+    }
+    ret = read_cb(cb_arg, &clock_saved, sizeof(clock_saved));
+    if (ret < 0) {
+        return (int)ret;
+    }
+    clock_saved_valid = (clock_saved.version == CLOCK_CHECKPOINT_VERSION);
+    return 0;
+}
+SETTINGS_STATIC_HANDLER_DEFINE(app_clock, CLOCK_SETTINGS_ROOT, NULL, clock_settings_set, NULL,
+                               NULL);
+
+//  ========== clock_checkpoint ============================================================
+// called with clock_mutex held, from the sync path
+static void clock_checkpoint(const struct clock_model *m, int64_t local_us, int64_t ref_us,
+                             uint32_t resolution_us)
+{
+    struct clock_checkpoint cp = {
+        .version = CLOCK_CHECKPOINT_VERSION,
+        .resolution_us = resolution_us,
+        .ref_us = ref_us,
+        .offset_us = ref_us - local_us,
+        .drift_ppb = m->drift_ppb,
+        .interval_s = clock_est.interval_s,
+    };
+    int ret;
+
+    if (!clock_est.persist) {
+        return;
+    }
+    ret = settings_save_one(CLOCK_SETTINGS_ROOT "/" CLOCK_SETTINGS_STATE, &cp, sizeof(cp));
+    if (ret < 0) {
+        LOG_WRN("failed to save the clock checkpoint. error: %d", ret);
+        return;
+    }
+    clock_est.checkpoint_us = ref_us;
+}
+#endif
+
+//  ========== app_clock_init ==============================================================
+void app_clock_init(void)
+{
+    struct clock_model m = {0};
+
+    k_mutex_lock(&clock_mutex, K_FOREVER);
+    memset(&clock_est, 0, sizeof(clock_est));
+    clock_est.interval_s = CLOCK_SYNC_MIN_S;
+    clock_model_publish(&m);
+    k_mutex_unlock(&clock_mutex);
+}
+
+//  ========== app_clock_load ==============================================================
+// restore the drift estimate and the sync interval of the last checkpoint, after
+// app_clock_init(). returns -ENOENT without a checkpoint, i.e. on the first boot of a unit
+// or without CONFIG_APP_CLOCK_PERSIST: the reference then has to be provisioned
+int8_t app_clock_load(void)
+{
+#if defined(CONFIG_APP_CLOCK_PERSIST)
+    struct clock_model m;
+    int ret;
+
+    ret = settings_subsys_init();
+    if (ret < 0) {
+        LOG_ERR("failed to initialize the settings storage. error: %d", ret);
+        return ret;
+    }
+    clock_saved_valid = false;
+    ret = settings_load_subtree(CLOCK_SETTINGS_ROOT);
+    if (ret < 0) {
+        LOG_ERR("failed to load the clock checkpoint. error: %d", ret);
+        return ret;
+    }
+
+    k_mutex_lock(&clock_mutex, K_FOREVER);
+    clock_est.persist = true;
+    if (!clock_saved_valid) {
+        k_mutex_unlock(&clock_mutex);
+        LOG_INF("no clock checkpoint");
+        return -ENOENT;
+    }
+
+    // the model stays invalid until the first reference sample of this boot, which
+    // steps the phase but keeps the drift
+    clock_model_read(&m);
+    m.drift_ppb = clock_saved.drift_ppb;
+    clock_model_publish(&m);
+    clock_est.interval_s = CLAMP(clock_saved.interval_s, CLOCK_SYNC_MIN_S, CLOCK_SYNC_MAX_S);
+    clock_est.restored = true;
+    clock_est.restore_pending = true;
+    clock_est.checkpoint_us = clock_saved.ref_us;
+    k_mutex_unlock(&clock_mutex);
+
+    LOG_INF("clock checkpoint restored: last sync at %lld s (resolution %u us), "
+            "drift %d ppb, sync interval %u s", clock_saved.ref_us / USEC_PER_SEC,
+            clock_saved.resolution_us, clock_saved.drift_ppb, clock_saved.interval_s);
+    return 0;
+#else
+    return -ENOENT;
+#endif
+}
+
+//  ========== app_clock_update ============================================================
+// feed one reference sample: ref_us is the reference time observed at local uptime
+// local_us, resolution_us the quantization of the reference (1 s for a plain DS3231 read).
+// returns -ERANGE for a reference behind the last checkpoint, which has lost its time
+int8_t app_clock_update(int64_t local_us, int64_t ref_us, uint32_t resolution_us)
+{
+    struct clock_model m;
+    int64_t predicted;
+    int64_t error;
+    int64_t tolerance = MAX(CLOCK_TOLERANCE_US, (int64_t)resolution_us);
+
+    k_mutex_lock(&clock_mutex, K_FOREVER);
+    if (ref_us < clock_est.checkpoint_us) {
+        k_mutex_unlock(&clock_mutex);
+        LOG_ERR("reference %lld s behind the last checkpoint",
+                (clock_est.checkpoint_us - ref_us) / USEC_PER_SEC);
+        return -ERANGE;
+    }
+    clock_model_read(&m);
+
+    predicted = clock_model_eval(&m, local_us);
+    error = ref_us - predicted;
+
+    if (!m.valid || error > CLOCK_STEP_US || error < -CLOCK_STEP_US) {
+        // first sample or gross error: step and restart the drift estimate
+        m.valid = true;
+        m.base_local_us = local_us;
+        m.base_ref_us = ref_us;
+        m.slew_us = 0;
+        m.uncertainty_us = resolution_us;
+        clock_est.count = 0;
+        clock_est.next = 0;
+        if (clock_est.restore_pending) {
+            // first sample after a reset: the restored drift still holds, only the
+            // phase is new
+            clock_est.restore_pending = false;
+        } else {
+            m.drift_ppb = 0;
+            clock_est.interval_s = CLOCK_SYNC_MIN_S;
+        }
+        clock_est.steps++;
+        clock_window_add(local_us, ref_us - local_us);
+        LOG_WRN("clock stepped by %lld us", error);
+    } else {
+        int32_t drift_ppb = m.drift_ppb;
+        uint32_t rms_us = 0;
+        int64_t target;
+
+        clock_window_add(local_us, ref_us - local_us);
+        target = local_us + clock_fit(&drift_ppb, &rms_us);
+
+        // rebase at the predicted time so the timeline stays continuous, then slew
+        // the remaining phase error in at a bounded rate
+        m.base_local_us = local_us;
+        m.base_ref_us = predicted;
+        m.drift_ppb = drift_ppb;
+        m.slew_us = target - predicted;
+        m.uncertainty_us = rms_us + (resolution_us / 2);
+
+        // poll less often while the prediction holds, more often when it does not
+        if (error <= tolerance && error >= -tolerance) {
+            clock_est.interval_s = MIN(clock_est.interval_s * 2, CLOCK_SYNC_MAX_S);
+        } else {
+            clock_est.interval_s = MAX(clock_est.interval_s / 2, CLOCK_SYNC_MIN_S);
+        }
+    }
+    clock_est.samples++;
+
+    clock_model_publish(&m);
+#if defined(CONFIG_APP_CLOCK_PERSIST)
+    clock_checkpoint(&m, local_us, ref_us, resolution_us);
+#endif
+    k_mutex_unlock(&clock_mutex);
+
+    LOG_INF("clock sync: error %lld us, drift %d ppb, next sync in %u s",
+           error, m.drift_ppb, clock_est.interval_s);
+    return 0;
+}
+
+//  ========== app_clock_now_us ============================================================
+// lock-free, callable from interrupt context; 0 until the first sync
+int64_t app_clock_now_us(void)
+{
+    struct clock_model m;
+
+    clock_model_read(&m);
+    if (!m.valid) {
+        return 0;
+    }
+    return clock_model_eval(&m, clock_local_now_us());
+}
+
+//  ========== app_clock_at_us =============================================================
+// disciplined time of a past or present local uptime, e.g. the end of an ADC block;
+// lock-free, 0 until the first sync
+int64_t app_clock_at_us(int64_t local_us)
+{
+    struct clock_model m;
+
+    clock_model_read(&m);
+    if (!m.valid) {
+        return 0;
+    }
+    return clock_model_eval(&m, local_us);
+}
+
+//  ========== app_clock_now_ms ============================================================
+uint64_t app_clock_now_ms(void)
+{
+    int64_t now_us = app_clock_now_us();
+    return (now_us > 0) ? (uint64_t)(now_us / 1000) : 0;
+}
+
+//  ========== app_clock_next_sync_s =======================================================
+uint32_t app_clock_next_sync_s(void)
+{
+    k_mutex_lock(&clock_mutex, K_FOREVER);
+    uint32_t interval = clock_est.interval_s;
+    k_mutex_unlock(&clock_mutex);
+    return interval;
+}
+
+//  ========== app_clock_get_status ========================================================
+void app_clock_get_status(struct app_clock_status *status)
+{
+    struct clock_model m;
+    int64_t local_us = clock_local_now_us();
+    int64_t dt;
+
+    clock_model_read(&m);
+    dt = MAX(local_us - m.base_local_us, 0);
+
+    status->synced = m.valid;
+    status->offset_us = m.valid ? (clock_model_eval(&m, local_us) - local_us) : 0;
+    status->drift_ppb = m.drift_ppb;
+    status->slew_us = m.slew_us - CLAMP(m.slew_us, -(dt * CLOCK_SLEW_MAX_PPM) / 1000000,
+                                        (dt * CLOCK_SLEW_MAX_PPM) / 1000000);
+    // the error bound grows with the holdover time since the last sync
+    status->uncertainty_us = m.uncertainty_us + (uint32_t)((dt * CLOCK_HOLDOVER_PPB) / 1000000000);
+    status->last_sync_us = m.base_local_us;
+
+    k_mutex_lock(&clock_mutex, K_FOREVER);
+    status->sync_interval_s = clock_est.interval_s;
+    status->samples = clock_est.samples;
+    status->steps = clock_est.steps;
+    status->restored = clock_est.restored;
+    status->checkpoint_us = clock_est.checkpoint_us;
+    k_mutex_unlock(&clock_mutex);
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CLOCK_H
+#define APP_CLOCK_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+#include "app_seqlock.h"
+
+//  ========== defines =====================================================================
+// disciplined clock: the local uptime is steered towards the DS3231 reference by a
+// frequency (drift) estimate and a bounded slew, instead of stepping at every sync
+#define CLOCK_STEP_US               ((int64_t)CONFIG_APP_CLOCK_STEP_MS * 1000)
+#define CLOCK_SLEW_MAX_PPM          CONFIG_APP_CLOCK_SLEW_MAX_PPM
+#define CLOCK_WINDOW                CONFIG_APP_CLOCK_WINDOW
+#define CLOCK_SYNC_MIN_S            CONFIG_APP_CLOCK_SYNC_MIN_S
+#define CLOCK_SYNC_MAX_S            CONFIG_APP_CLOCK_SYNC_MAX_S
+#define CLOCK_TOLERANCE_US          ((int64_t)CONFIG_APP_CLOCK_TOLERANCE_MS * 1000)
+#define CLOCK_HOLDOVER_PPB          2000    // DS3231 accuracy, bounds the uncertainty growth
+
+//  ========== types =======================================================================
+struct app_clock_status {
+    bool synced;                // at least one reference sample received
+    int64_t offset_us;          // disciplined time minus local uptime, now
+    int32_t drift_ppb;          // estimated frequency error of the local timebase
+    int64_t slew_us;            // phase error still being absorbed
+    uint32_t uncertainty_us;    // estimated error bound of the disciplined time, now
+    uint32_t sync_interval_s;   // recommended delay until the next sync
+    int64_t last_sync_us;       // local uptime of the last reference sample
+    uint32_t samples;           // reference samples accepted
+    uint32_t steps;             // phase steps (first sync or error above threshold)
+    bool restored;              // drift and interval restored from a checkpoint at boot
+    int64_t checkpoint_us;      // reference time of the last checkpoint, 0 if none
+};
+
+//  ========== prototypes ==================================================================
+void app_clock_init(void);
+int8_t app_clock_load(void);
+int8_t app_clock_update(int64_t local_us, int64_t ref_us, uint32_t resolution_us);
+int64_t app_clock_now_us(void);
+int64_t app_clock_at_us(int64_t local_us);
+uint64_t app_clock_now_ms(void);
+uint32_t app_clock_next_sync_s(void);
+void app_clock_get_status(struct app_clock_status *status);
+
+#endif /* APP_CLOCK_H */
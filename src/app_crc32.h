@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_CRC32_H
+#define APP_CRC32_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+//  ========== defines =====================================================================
+// CRC-32/ISO-HDLC (IEEE 802.3, zlib), same convention as crc32_ieee_update(): start
+// from 0 and feed the data in as many pieces as needed
+#define CRC32_CHECK                 0xCBF43926      // CRC of "123456789"
+
+//  ========== prototypes ==================================================================
+uint32_t app_crc32_update(uint32_t crc, const void *data, size_t length);
+
+#endif /* APP_CRC32_H */
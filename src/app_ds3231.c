@@ -7,10 +7,48 @@
 
 //  ========== includes ==================================================================
 #include "app_ds3231.h"
+#include "app_housekeeping.h"
+#include "app_probe.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_ds3231, CONFIG_APP_TIME_LOG_LEVEL);
+
+//  ========== defines ===================================================================
+#define DS3231_XFER_MAX             8       // register address and the 7 time registers
 
 //  ========== globals ===================================================================
-static int64_t system_rtc_offset_ms = 0;
-static struct k_mutex offset_mutex;
+// one register transfer in flight at a time. the messages and buffers are not on the
+// caller's stack: a transfer given up on a timeout still completes into them later
+static struct {
+    const struct device *dev;
+    struct i2c_msg msgs[2];
+    uint8_t num_msgs;
+    uint8_t reg;
+    uint8_t buf[DS3231_XFER_MAX];
+    volatile bool busy;         // submitted, completion not seen yet
+    int result;
+    int64_t done_us;            // uptime at completion
+    uint32_t start;             // cycles at submission
+    uint32_t cycles;            // submission to completion
+    struct app_ds3231_i2c_stats stats;
+} ds3231_xfer;
+
+K_MUTEX_DEFINE(ds3231_xfer_lock);
+K_SEM_DEFINE(ds3231_xfer_done, 0, 1);
+static struct k_spinlock ds3231_xfer_spin;     // busy and the semaphore change together
+
+#if defined(CONFIG_APP_DS3231_SQW_SYNC)
+// INT/SQW output of the DS3231 (open drain, active low), optional in the devicetree
+static const struct gpio_dt_spec sqw_gpio =
+    GPIO_DT_SPEC_GET_OR(DT_PATH(zephyr_user), ds3231_sqw_gpios, {0});
+static struct gpio_callback sqw_cb;
+static bool sqw_ready;
+
+// uptime of the last falling edge, written by the ISR once per second and read right
+// after the semaphore, long before the next edge can overwrite it
+static int64_t sqw_edge_us;
+K_SEM_DEFINE(sqw_sem, 0, 1);
+#endif
 
 //  ========== bcd_to_bin ================================================================ 
 static uint8_t bcd_to_bin(uint8_t val)
@@ -24,47 +62,216 @@ static uint8_t bin_to_bcd(uint8_t val)
     return ((val / 10) << 4) | (val % 10);
 }
 
-// ========== app_i2c_write_time ============================================================
-int8_t app_i2c_write_time(const struct device *i2c_dev, const struct tm *tm)
+//  ========== ds3231_xfer_complete =======================================================
+// the local timestamp of a sync is taken here, as close to the end of the transfer as
+// the bus driver reports it
+static void ds3231_xfer_complete(int result)
 {
-    uint8_t time_buf[7];
-    int8_t ret;
+    k_spinlock_key_t key = k_spin_lock(&ds3231_xfer_spin);
 
-    if (!i2c_dev || !tm) {
-        return -EINVAL;
+    ds3231_xfer.done_us = (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    ds3231_xfer.cycles = k_cycle_get_32() - ds3231_xfer.start;
+    ds3231_xfer.result = result;
+    ds3231_xfer.busy = false;
+    k_sem_give(&ds3231_xfer_done);
+    k_spin_unlock(&ds3231_xfer_spin, key);
+}
+
+#if defined(CONFIG_I2C_CALLBACK)
+//  ========== ds3231_xfer_callback =======================================================
+// bus driver interrupt
+static void ds3231_xfer_callback(const struct device *dev, int result, void *data)
+{
+    ds3231_xfer_complete(result);
+}
+#endif
+
+//  ========== ds3231_xfer_work ===========================================================
+// bus drivers without the callback API (the I2C emulator): the blocking transfer runs
+// on the housekeeping queue, the caller still only waits for its completion
+static void ds3231_xfer_work(struct k_work *work)
+{
+    ds3231_xfer_complete(i2c_transfer(ds3231_xfer.dev, ds3231_xfer.msgs, ds3231_xfer.num_msgs,
+                                      DS3231_I2C_ADDR));
+}
+K_WORK_DEFINE(ds3231_xfer_fallback, ds3231_xfer_work);
+
+//  ========== ds3231_xfer_wait_idle ======================================================
+// the messages and buffers of a transfer given up on still belong to the bus driver
+// until it completes: wait for that, then drop its completion. the caller holds
+// ds3231_xfer_lock and only touches the transfer state once this returned 0
+static int ds3231_xfer_wait_idle(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ds3231_xfer_spin);
+    bool busy = ds3231_xfer.busy;
+
+    if (!busy) {
+        k_sem_reset(&ds3231_xfer_done);
     }
+    k_spin_unlock(&ds3231_xfer_spin, key);
 
-    time_buf[0] = bin_to_bcd(tm->tm_sec);
-    time_buf[1] = bin_to_bcd(tm->tm_min);
-    time_buf[2] = bin_to_bcd(tm->tm_hour);
-    time_buf[3] = bin_to_bcd(tm->tm_wday + 1);         // struct tm: 0=Sun → DS3231: 1=Sun
-    time_buf[4] = bin_to_bcd(tm->tm_mday);
-    time_buf[5] = bin_to_bcd(tm->tm_mon + 1);          // struct tm: 0=Jan → DS3231: 1=Jan
-    time_buf[6] = bin_to_bcd(tm->tm_year - 100);       // struct tm: years since 1900 → DS3231: years since 2000
+    // the late completion is consumed here, the semaphore is left at zero
+    if (busy && k_sem_take(&ds3231_xfer_done, K_MSEC(DS3231_I2C_TIMEOUT_MS)) != 0) {
+        return -EBUSY;
+    }
+    return 0;
+}
 
-    ret = i2c_burst_write(i2c_dev, DS3231_I2C_ADDR, DS3231_REG_TIME, time_buf, sizeof(time_buf));
-    if (ret < 0) {
-        printk("failed to write time to DS3231: %d\n", ret);
+//  ========== ds3231_xfer_submit =========================================================
+static int ds3231_xfer_submit(void)
+{
+    ds3231_xfer.busy = true;
+    ds3231_xfer.start = k_cycle_get_32();
+#if defined(CONFIG_I2C_CALLBACK)
+    int ret = i2c_transfer_cb(ds3231_xfer.dev, ds3231_xfer.msgs, ds3231_xfer.num_msgs,
+                              DS3231_I2C_ADDR, ds3231_xfer_callback, NULL);
+    if (ret != -ENOSYS) {
+        if (ret < 0) {
+            ds3231_xfer.busy = false;
+        }
         return ret;
     }
+#endif
+    struct k_work_q *queue = app_housekeeping_queue();
 
-    printk("DS3231 time set successfully\n");
+    if (k_current_get() == k_work_queue_thread_get(queue)) {
+        // the periodic sync itself runs on the housekeeping queue, which cannot wait on
+        // its own work item: the transfer completes before returning
+        ds3231_xfer_work(&ds3231_xfer_fallback);
+        return 0;
+    }
+    (void)k_work_submit_to_queue(queue, &ds3231_xfer_fallback);
     return 0;
 }
 
-//  ========== app_i2c_read_time ========================================================= 
-int8_t app_i2c_read_time(const struct device *i2c_dev, struct tm *tm)
+//  ========== ds3231_xfer_run ============================================================
+// caller holds ds3231_xfer_lock and has set up the messages after ds3231_xfer_wait_idle().
+// a transfer not completed within DS3231_I2C_TIMEOUT_MS, or failed, is submitted again
+// after DS3231_I2C_RETRY_MS, up to DS3231_I2C_RETRIES times. the thread sleeps meanwhile
+static int ds3231_xfer_run(enum app_probe_id probe)
+{
+    int ret = -EIO;
+
+    for (uint8_t attempt = 0; attempt <= DS3231_I2C_RETRIES; attempt++) {
+        if (attempt > 0) {
+            ds3231_xfer.stats.retries++;
+            k_msleep(DS3231_I2C_RETRY_MS);
+            // the same messages go out again, once the driver gave them back
+            if (ds3231_xfer_wait_idle() != 0) {
+                ret = -EBUSY;
+                continue;
+            }
+        }
+
+        ret = ds3231_xfer_submit();
+        if (ret < 0) {
+            ds3231_xfer.stats.errors++;
+            continue;
+        }
+        if (k_sem_take(&ds3231_xfer_done, K_MSEC(DS3231_I2C_TIMEOUT_MS)) != 0) {
+            LOG_WRN("DS3231 transfer timed out, attempt %u", attempt + 1);
+            ds3231_xfer.stats.timeouts++;
+            ret = -ETIMEDOUT;
+            continue;
+        }
+        ret = ds3231_xfer.result;
+        if (ret < 0) {
+            ds3231_xfer.stats.errors++;
+            continue;
+        }
+
+#if defined(CONFIG_APP_PROBE)
+        app_probe_record(probe, ds3231_xfer.cycles);
+#endif
+        ds3231_xfer.stats.transfers++;
+        ds3231_xfer.stats.latency_us_max = MAX(ds3231_xfer.stats.latency_us_max,
+                                               k_cyc_to_us_ceil32(ds3231_xfer.cycles));
+        return 0;
+    }
+    return ret;
+}
+
+//  ========== ds3231_read_regs ===========================================================
+// register pointer write, then a repeated start and the read. done_us, if not NULL,
+// receives the uptime at completion
+static int ds3231_read_regs(const struct device *i2c_dev, uint8_t reg, uint8_t *data,
+                            uint8_t length, int64_t *done_us)
+{
+    int ret;
+
+    if (length > DS3231_XFER_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&ds3231_xfer_lock, K_FOREVER);
+    if (ds3231_xfer_wait_idle() != 0) {
+        ds3231_xfer.stats.errors++;
+        k_mutex_unlock(&ds3231_xfer_lock);
+        return -EBUSY;
+    }
+    ds3231_xfer.dev = i2c_dev;
+    ds3231_xfer.reg = reg;
+    ds3231_xfer.msgs[0].buf = &ds3231_xfer.reg;
+    ds3231_xfer.msgs[0].len = 1;
+    ds3231_xfer.msgs[0].flags = I2C_MSG_WRITE;
+    ds3231_xfer.msgs[1].buf = ds3231_xfer.buf;
+    ds3231_xfer.msgs[1].len = length;
+    ds3231_xfer.msgs[1].flags = I2C_MSG_RESTART | I2C_MSG_READ | I2C_MSG_STOP;
+    ds3231_xfer.num_msgs = 2;
+
+    ret = ds3231_xfer_run(PROBE_I2C_READ);
+    if (ret == 0) {
+        memcpy(data, ds3231_xfer.buf, length);
+        if (done_us) {
+            *done_us = ds3231_xfer.done_us;
+        }
+    }
+    k_mutex_unlock(&ds3231_xfer_lock);
+    return ret;
+}
+
+//  ========== ds3231_write_regs ==========================================================
+static int ds3231_write_regs(const struct device *i2c_dev, uint8_t reg, const uint8_t *data,
+                             uint8_t length)
+{
+    int ret;
+
+    if (length + 1 > DS3231_XFER_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&ds3231_xfer_lock, K_FOREVER);
+    if (ds3231_xfer_wait_idle() != 0) {
+        ds3231_xfer.stats.errors++;
+        k_mutex_unlock(&ds3231_xfer_lock);
+        return -EBUSY;
+    }
+    ds3231_xfer.dev = i2c_dev;
+    ds3231_xfer.buf[0] = reg;
+    memcpy(&ds3231_xfer.buf[1], data, length);
+    ds3231_xfer.msgs[0].buf = ds3231_xfer.buf;
+    ds3231_xfer.msgs[0].len = length + 1;
+    ds3231_xfer.msgs[0].flags = I2C_MSG_WRITE | I2C_MSG_STOP;
+    ds3231_xfer.num_msgs = 1;
+
+    ret = ds3231_xfer_run(PROBE_I2C_WRITE);
+    k_mutex_unlock(&ds3231_xfer_lock);
+    return ret;
+}
+
+//  ========== ds3231_read_time ==========================================================
+static int ds3231_read_time(const struct device *i2c_dev, struct tm *tm, int64_t *done_us)
 {
     uint8_t time_buf[7];
-    int8_t ret;
+    int ret;
 
     if (!i2c_dev || !tm) {
         return -EINVAL;
     }
 
-    ret = i2c_burst_read(i2c_dev, DS3231_I2C_ADDR, DS3231_REG_TIME, time_buf, sizeof(time_buf));
+    ret = ds3231_read_regs(i2c_dev, DS3231_REG_TIME, time_buf, sizeof(time_buf), done_us);
     if (ret < 0) {
-        printk("failed to read DS3231 registers. error: %d", ret);
+        LOG_ERR("failed to read DS3231 registers. error: %d", ret);
         return ret;
     }
 
@@ -79,19 +286,55 @@ int8_t app_i2c_read_time(const struct device *i2c_dev, struct tm *tm)
     return 0;
 }
 
+// ========== app_i2c_write_time ============================================================
+int8_t app_i2c_write_time(const struct device *i2c_dev, const struct tm *tm)
+{
+    uint8_t time_buf[7];
+    int8_t ret;
+
+    if (!i2c_dev || !tm) {
+        return -EINVAL;
+    }
+
+    time_buf[0] = bin_to_bcd(tm->tm_sec);
+    time_buf[1] = bin_to_bcd(tm->tm_min);
+    time_buf[2] = bin_to_bcd(tm->tm_hour);
+    time_buf[3] = bin_to_bcd(tm->tm_wday + 1);         // struct tm: 0=Sun → DS3231: 1=Sun
+    time_buf[4] = bin_to_bcd(tm->tm_mday);
+    time_buf[5] = bin_to_bcd(tm->tm_mon + 1);          // struct tm: 0=Jan → DS3231: 1=Jan
+    time_buf[6] = bin_to_bcd(tm->tm_year - 100);       // struct tm: years since 1900 → DS3231: years since 2000
+
+    ret = ds3231_write_regs(i2c_dev, DS3231_REG_TIME, time_buf, sizeof(time_buf));
+    if (ret < 0) {
+        LOG_ERR("failed to write time to DS3231: %d", ret);
+        return ret;
+    }
+
+    LOG_INF("DS3231 time set successfully");
+    return 0;
+}
+
+//  ========== app_i2c_read_time ========================================================= 
+int8_t app_i2c_read_time(const struct device *i2c_dev, struct tm *tm)
+{
+    return ds3231_read_time(i2c_dev, tm, NULL);
+}
+
 //  ========== app_rtc_init ==============================================================
 const struct device *app_ds3231_init(void)
 {
-    const struct device *i2c_dev = DEVICE_DT_GET_ONE(maxim_ds3231);
-    if (!i2c_dev) {
-        printk("no DS3231 device found\n");
+    // registers are accessed directly, through the bus the DS3231 sits on
+    const struct device *i2c_dev =
+        DEVICE_DT_GET(DT_BUS(DT_COMPAT_GET_ANY_STATUS_OKAY(maxim_ds3231)));
+    if (!device_is_ready(i2c_dev)) {
+        LOG_ERR("no DS3231 device found");
         return NULL;
     }
 
-    // initialize mutex
-    k_mutex_init(&offset_mutex);
+    // the DS3231 is the reference of the disciplined clock
+    app_clock_init();
 
-    printk("DS3231 initialized and started successfully (device: %s)\n", i2c_dev->name);
+    LOG_INF("DS3231 initialized and started successfully (device: %s)", i2c_dev->name);
     return i2c_dev;
 }
 
@@ -110,73 +353,193 @@ void app_ds3231_set_time(const struct device *i2c_dev, int64_t unix_time)
 int8_t app_ds3231_sync_uptime(const struct device *i2c_dev)
 {
     if (!i2c_dev) {
-        printk("DS3231 device is NULL\n");
+        LOG_ERR("DS3231 device is NULL");
         return -EINVAL;
     }
 
     struct tm rtc_tm;
     int64_t rtc_epoch_s;
     int64_t rtc_epoch_ms;
-    int64_t current_uptime_ms;
-    int64_t new_offset_ms;
+    int64_t current_uptime_us;
 
-    // get time from external RTC
-    if (app_i2c_read_time(i2c_dev, &rtc_tm) != 0) {
-        printk("failed to read time from DS3231\n");
+    // get time from external RTC, paired with the local uptime at the end of the
+    // transfer rather than whenever this thread runs again
+    if (ds3231_read_time(i2c_dev, &rtc_tm, &current_uptime_us) != 0) {
+        LOG_ERR("failed to read time from DS3231");
         return -EIO;
     }
 
-    // calculate the offset between RTC time and system uptime
     rtc_epoch_s = timeutil_timegm64(&rtc_tm);
     rtc_epoch_ms = rtc_epoch_s * 1000;
-    current_uptime_ms = k_uptime_get();
-    new_offset_ms = rtc_epoch_ms - current_uptime_ms;
 
-    // safely update the global offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    system_rtc_offset_ms = new_offset_ms;
-    k_mutex_unlock(&offset_mutex);
+    // the register only holds whole seconds: the true time lies anywhere in the next
+    // second, so the midpoint is handed to the clock discipline as an unbiased estimate
+    int8_t ret = app_clock_update(current_uptime_us,
+                                  (rtc_epoch_s * USEC_PER_SEC) + (USEC_PER_SEC / 2),
+                                  USEC_PER_SEC);
+    if (ret < 0) {
+        return ret;
+    }
 
     // debugging output
-    printk("synced: DS3231 epoch_ms = %lld, uptime = %lld, offset = %lld\n",
-           rtc_epoch_ms, current_uptime_ms, new_offset_ms);
+    LOG_DBG("synced: DS3231 epoch_ms = %lld, uptime_us = %lld",
+           rtc_epoch_ms, current_uptime_us);
 
     return 0;
 }
 
 //  ========== app_rtc_get_time ==========================================================
+// disciplined DS3231 time, lock-free and callable from interrupt context
 uint64_t app_ds3231_get_time()
 {
-    int64_t now_ms = k_uptime_get();
-    int64_t offset;
-
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    offset = system_rtc_offset_ms;
-    k_mutex_unlock(&offset_mutex);
-
-    // protect against overflow
-    if (offset > 0 && now_ms > UINT64_MAX - offset) {
-        return UINT64_MAX;
-    }
-    if (offset < 0 && now_ms < (uint64_t)(-offset)) {
-        return 0;
-    }
-    uint64_t timestamp_ms = now_ms + offset;
-    return timestamp_ms;
+    return app_clock_now_ms();
 }
 
 //  ========== app_ds3231_periodic_sync ====================================================
 int8_t app_ds3231_periodic_sync(const struct device *i2c_dev)
 {
     if (!i2c_dev) {
-        printk("RTC device is NULL\n");
+        LOG_ERR("RTC device is NULL");
         return -EINVAL;
     }
     
-    // call this periodically from a thread or workqueue
-    int ret = app_ds3231_sync_uptime(i2c_dev);
+    // call this periodically from a thread or workqueue, the square wave edge gives
+    // sub-millisecond alignment and the plain register read is the fallback
+    int ret = app_ds3231_sync_sqw(i2c_dev);
+    if (ret < 0 && ret != -ERANGE) {
+        ret = app_ds3231_sync_uptime(i2c_dev);
+    }
+    if (ret == -ERANGE) {
+        // behind the last clock checkpoint: the DS3231 lost its time with its backup
+        // supply. restart it from the checkpoint, the latest time known to have passed
+        struct app_clock_status status;
+
+        app_clock_get_status(&status);
+        LOG_WRN("DS3231 time lost, restarted from the last clock checkpoint");
+        app_ds3231_set_time(i2c_dev, DIV_ROUND_UP(status.checkpoint_us, USEC_PER_SEC));
+        ret = app_ds3231_sync_uptime(i2c_dev);
+    }
+    if (ret < 0) {
+        LOG_ERR("periodic sync failed, error: %d", ret);
+    }
+    return 0;
+}
+
+//  ========== app_ds3231_get_i2c_stats =====================================================
+void app_ds3231_get_i2c_stats(struct app_ds3231_i2c_stats *stats)
+{
+    k_mutex_lock(&ds3231_xfer_lock, K_FOREVER);
+    *stats = ds3231_xfer.stats;
+    k_mutex_unlock(&ds3231_xfer_lock);
+}
+
+#if defined(CONFIG_APP_DS3231_SQW_SYNC)
+//  ========== ds3231_sqw_isr ==============================================================
+static void ds3231_sqw_isr(const struct device *port, struct gpio_callback *cb,
+                           gpio_port_pins_t pins)
+{
+    sqw_edge_us = (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+    k_sem_give(&sqw_sem);
+}
+#endif
+
+//  ========== app_ds3231_sqw_init =========================================================
+// route the 1 Hz square wave to the INT/SQW pin and capture its falling edges
+int8_t app_ds3231_sqw_init(const struct device *i2c_dev)
+{
+#if defined(CONFIG_APP_DS3231_SQW_SYNC)
+    int8_t ret;
+
+    if (!i2c_dev || !sqw_gpio.port) {
+        return -ENODEV;
+    }
+    if (!gpio_is_ready_dt(&sqw_gpio)) {
+        LOG_ERR("DS3231 SQW GPIO is not ready");
+        return -ENODEV;
+    }
+
+    uint8_t control;
+
+    ret = ds3231_read_regs(i2c_dev, DS3231_REG_CONTROL, &control, 1, NULL);
+    if (ret == 0) {
+        control &= ~(DS3231_CTRL_INTCN | DS3231_CTRL_RS_MASK);
+        ret = ds3231_write_regs(i2c_dev, DS3231_REG_CONTROL, &control, 1);
+    }
+    if (ret < 0) {
+        LOG_ERR("failed to enable DS3231 square wave. error: %d", ret);
+        return ret;
+    }
+
+    ret = gpio_pin_configure_dt(&sqw_gpio, GPIO_INPUT);
+    if (ret < 0) {
+        LOG_ERR("failed to configure SQW pin. error: %d", ret);
+        return ret;
+    }
+    gpio_init_callback(&sqw_cb, ds3231_sqw_isr, BIT(sqw_gpio.pin));
+    ret = gpio_add_callback_dt(&sqw_gpio, &sqw_cb);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = gpio_pin_interrupt_configure_dt(&sqw_gpio, GPIO_INT_EDGE_TO_ACTIVE);
     if (ret < 0) {
-        printk("periodic sync failed, error: %d", ret);
+        LOG_ERR("failed to enable SQW interrupt. error: %d", ret);
+        return ret;
     }
+
+    sqw_ready = true;
+    LOG_INF("DS3231 1 Hz square wave sync enabled");
     return 0;
+#else
+    return -ENOTSUP;
+#endif
+}
+
+//  ========== app_ds3231_sync_sqw =========================================================
+// align on a square wave edge, then label it with one register read: the seconds read
+// just after a falling edge are exactly the second that edge started
+int8_t app_ds3231_sync_sqw(const struct device *i2c_dev)
+{
+#if defined(CONFIG_APP_DS3231_SQW_SYNC)
+    struct tm rtc_tm;
+    int64_t edge_us;
+    int64_t done_us;
+
+    if (!i2c_dev) {
+        return -EINVAL;
+    }
+    if (!sqw_ready) {
+        return -ENOTSUP;
+    }
+
+    for (uint8_t attempt = 0; attempt < DS3231_SQW_ATTEMPTS; attempt++) {
+        // only an edge seen from now on may be paired with the next read
+        k_sem_reset(&sqw_sem);
+        if (k_sem_take(&sqw_sem, K_MSEC(DS3231_SQW_TIMEOUT_MS)) != 0) {
+            LOG_WRN("no DS3231 square wave edge");
+            return -ETIMEDOUT;
+        }
+        edge_us = sqw_edge_us;
+
+        if (ds3231_read_time(i2c_dev, &rtc_tm, &done_us) != 0) {
+            return -EIO;
+        }
+
+        // a read delayed towards the next edge could already see the next second
+        if (done_us - edge_us > DS3231_SQW_READ_WINDOW_US) {
+            continue;
+        }
+
+        int8_t ret = app_clock_update(edge_us, timeutil_timegm64(&rtc_tm) * USEC_PER_SEC,
+                                      DS3231_SQW_RESOLUTION_US);
+        if (ret < 0) {
+            return ret;
+        }
+        LOG_DBG("synced on SQW edge: uptime_us = %lld, read latency = %lld us",
+               edge_us, done_us - edge_us);
+        return 0;
+    }
+    return -EAGAIN;
+#else
+    return -ENOTSUP;
+#endif
 }
\ No newline at end of file
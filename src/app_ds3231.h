@@ -15,13 +15,45 @@
 #include <zephyr/drivers/rtc.h>
 #include <zephyr/drivers/counter.h>
 #include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/gpio.h>
 #include <zephyr/sys_clock.h>
+#include <zephyr/sys/timeutil.h>
 #include <time.h>
 
+#include "app_clock.h"
+
 //  ========== defines =====================================================================
 #define ONE_YEAR_MS         31536000000LL
 #define DS3231_I2C_ADDR     0x68
 #define DS3231_REG_TIME     0x00
+#define DS3231_REG_CONTROL  0x0E
+
+// control register: INTCN selects the alarm interrupt over the square wave, RS2/RS1
+// select its frequency (00 = 1 Hz)
+#define DS3231_CTRL_INTCN   BIT(2)
+#define DS3231_CTRL_RS_MASK (BIT(4) | BIT(3))
+
+// the seconds register increments on the falling edge of the 1 Hz square wave; the edge
+// is timestamped in the GPIO ISR, so its resolution is one kernel tick
+#define DS3231_SQW_TIMEOUT_MS       1500
+#define DS3231_SQW_READ_WINDOW_US   500000      // time read must end inside this window
+#define DS3231_SQW_RESOLUTION_US    (USEC_PER_SEC / CONFIG_SYS_CLOCK_TICKS_PER_SEC)
+#define DS3231_SQW_ATTEMPTS         3
+
+// register transfers go through the asynchronous I2C API: the caller sleeps until the
+// completion, bounded by a timeout, and retries
+#define DS3231_I2C_TIMEOUT_MS       CONFIG_APP_DS3231_I2C_TIMEOUT_MS
+#define DS3231_I2C_RETRIES          CONFIG_APP_DS3231_I2C_RETRIES
+#define DS3231_I2C_RETRY_MS         CONFIG_APP_DS3231_I2C_RETRY_MS
+
+//  ========== types =======================================================================
+struct app_ds3231_i2c_stats {
+    uint32_t transfers;         // transfers completed
+    uint32_t retries;
+    uint32_t timeouts;          // transfers not completed in time
+    uint32_t errors;            // transfers completed with an error, or not submitted
+    uint32_t latency_us_max;    // submission to completion
+};
 
 //  ========== prototypes ===================================================================
 int8_t app_i2c_read_time(const struct device *i2c_dev, struct tm *tm);
@@ -31,5 +63,12 @@ void app_ds3231_set_time(const struct device *i2c_dev, int64_t unix_time);
 int8_t  app_ds3231_sync_uptime(const struct device *i2c_dev);
 uint64_t app_ds3231_get_time();
 int8_t app_ds3231_periodic_sync(const struct device *i2c_dev);
+int8_t app_ds3231_sqw_init(const struct device *i2c_dev);
+int8_t app_ds3231_sync_sqw(const struct device *i2c_dev);
+void app_ds3231_get_i2c_stats(struct app_ds3231_i2c_stats *stats);
+
+#if defined(CONFIG_I2C_EMUL)
+void app_ds3231_emul_set_delay(uint32_t delay_us, uint32_t stall_every, uint32_t stall_ms);
+#endif
 
 #endif /* APP_DS3231_H */
\ No newline at end of file
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// DS3231 register-level emulator for native_sim: serves the time registers from the
+// kernel uptime and drives the 1 Hz square wave on an emulated GPIO pin
+#if defined(CONFIG_I2C_EMUL)
+
+#define DT_DRV_COMPAT maxim_ds3231
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/devicetree.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/sys/timeutil.h>
+
+#if defined(CONFIG_GPIO_EMUL)
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#endif
+
+#include "app_ds3231.h"
+
+//  ========== defines =====================================================================
+#define DS3231_EMUL_REGS        0x13
+#define DS3231_EMUL_EPOCH       1721390400      // "2024-07-19 12:00:00" UTC at boot
+
+//  ========== types =======================================================================
+struct ds3231_emul_data {
+    uint8_t regs[DS3231_EMUL_REGS];
+    uint8_t pointer;
+    int64_t base_epoch_s;       // time held by the registers at base_uptime_us
+    int64_t base_uptime_us;     // start of the current second chain
+    struct k_timer sqw_timer;
+    bool sqw_level;
+};
+
+//  ========== globals =====================================================================
+// bus timing injected into the transfers, to exercise the timeout and retry path
+static struct {
+    uint32_t delay_us;          // duration of every transfer
+    uint32_t stall_every;       // one transfer in stall_every stalls, 0 never
+    uint32_t stall_ms;          // duration of a stalled transfer
+    uint32_t transfers;
+} ds3231_emul_timing = {
+    .delay_us = CONFIG_APP_DS3231_EMUL_DELAY_US,
+    .stall_every = CONFIG_APP_DS3231_EMUL_STALL_EVERY,
+    .stall_ms = CONFIG_APP_DS3231_EMUL_STALL_MS,
+};
+
+#if defined(CONFIG_GPIO_EMUL)
+static const struct gpio_dt_spec emul_sqw_gpio =
+    GPIO_DT_SPEC_GET_OR(DT_PATH(zephyr_user), ds3231_sqw_gpios, {0});
+#endif
+
+//  ========== ds3231_emul_bcd =============================================================
+static uint8_t ds3231_emul_bcd(uint8_t val)
+{
+    return ((val / 10) << 4) | (val % 10);
+}
+
+//  ========== ds3231_emul_bin =============================================================
+static uint8_t ds3231_emul_bin(uint8_t val)
+{
+    return ((val >> 4) * 10) + (val & 0x0F);
+}
+
+//  ========== ds3231_emul_uptime_us =======================================================
+static inline int64_t ds3231_emul_uptime_us(void)
+{
+    return (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+//  ========== ds3231_emul_refresh =========================================================
+// load the time registers with the current emulated time
+static void ds3231_emul_refresh(struct ds3231_emul_data *data)
+{
+    time_t now = (time_t)(data->base_epoch_s +
+                          ((ds3231_emul_uptime_us() - data->base_uptime_us) / USEC_PER_SEC));
+    struct tm tm;
+
+    gmtime_r(&now, &tm);
+    data->regs[0] = ds3231_emul_bcd(tm.tm_sec);
+    data->regs[1] = ds3231_emul_bcd(tm.tm_min);
+    data->regs[2] = ds3231_emul_bcd(tm.tm_hour);
+    data->regs[3] = ds3231_emul_bcd(tm.tm_wday + 1);
+    data->regs[4] = ds3231_emul_bcd(tm.tm_mday);
+    data->regs[5] = ds3231_emul_bcd(tm.tm_mon + 1);
+    data->regs[6] = ds3231_emul_bcd(tm.tm_year - 100);
+}
+
+//  ========== ds3231_emul_restart =========================================================
+// writing the time resets the countdown chain: the next second starts 1 s later
+static void ds3231_emul_restart(struct ds3231_emul_data *data)
+{
+    data->base_uptime_us = ds3231_emul_uptime_us();
+    data->sqw_level = true;
+    k_timer_start(&data->sqw_timer, K_SECONDS(1), K_MSEC(500));
+}
+
+//  ========== ds3231_emul_latch ===========================================================
+// a burst write to the time registers sets a new base time
+static void ds3231_emul_latch(struct ds3231_emul_data *data)
+{
+    struct tm tm = {
+        .tm_sec = ds3231_emul_bin(data->regs[0] & 0x7F),
+        .tm_min = ds3231_emul_bin(data->regs[1] & 0x7F),
+        .tm_hour = ds3231_emul_bin(data->regs[2] & 0x3F),
+        .tm_mday = ds3231_emul_bin(data->regs[4] & 0x3F),
+        .tm_mon = ds3231_emul_bin(data->regs[5] & 0x1F) - 1,
+        .tm_year = ds3231_emul_bin(data->regs[6]) + 100,
+    };
+
+    data->base_epoch_s = timeutil_timegm64(&tm);
+    ds3231_emul_restart(data);
+}
+
+//  ========== ds3231_emul_sqw =============================================================
+// square wave: falling edge on each new second, rising edge 500 ms later
+static void ds3231_emul_sqw(struct k_timer *timer)
+{
+    struct ds3231_emul_data *data = CONTAINER_OF(timer, struct ds3231_emul_data, sqw_timer);
+    bool enabled = (data->regs[DS3231_REG_CONTROL] &
+                    (DS3231_CTRL_INTCN | DS3231_CTRL_RS_MASK)) == 0;
+
+    data->sqw_level = !data->sqw_level;
+#if defined(CONFIG_GPIO_EMUL)
+    if (emul_sqw_gpio.port) {
+        // open drain output, released (high) while the square wave is disabled
+        gpio_emul_input_set(emul_sqw_gpio.port, emul_sqw_gpio.pin,
+                            enabled ? data->sqw_level : 1);
+    }
+#endif
+}
+
+//  ========== ds3231_emul_transfer ========================================================
+// the first byte written in a transfer sets the register pointer, which then
+// auto-increments over reads and writes like on the real part
+static int ds3231_emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+                                int addr)
+{
+    struct ds3231_emul_data *data = target->data;
+    bool pointer_set = false;
+    bool time_written = false;
+
+    for (int i = 0; i < num_msgs; i++) {
+        struct i2c_msg *msg = &msgs[i];
+        uint32_t j = 0;
+
+        if (msg->flags & I2C_MSG_READ) {
+            ds3231_emul_refresh(data);
+            for (; j < msg->len; j++) {
+                msg->buf[j] = data->regs[data->pointer];
+                data->pointer = (data->pointer + 1) % DS3231_EMUL_REGS;
+            }
+            continue;
+        }
+
+        if (!pointer_set && msg->len > 0) {
+            data->pointer = msg->buf[0] % DS3231_EMUL_REGS;
+            pointer_set = true;
+            j = 1;
+        }
+        for (; j < msg->len; j++) {
+            time_written |= (data->pointer <= 6);
+            data->regs[data->pointer] = msg->buf[j];
+            data->pointer = (data->pointer + 1) % DS3231_EMUL_REGS;
+        }
+    }
+
+    if (time_written) {
+        ds3231_emul_latch(data);
+    }
+
+    // the registers are latched at the start of the read, the bus is released later
+    if (!k_is_in_isr() && !k_is_pre_kernel()) {
+        ds3231_emul_timing.transfers++;
+        if (ds3231_emul_timing.stall_every > 0 &&
+            (ds3231_emul_timing.transfers % ds3231_emul_timing.stall_every) == 0) {
+            k_msleep(ds3231_emul_timing.stall_ms);
+        } else if (ds3231_emul_timing.delay_us > 0) {
+            k_usleep(ds3231_emul_timing.delay_us);
+        }
+    }
+    return 0;
+}
+
+//  ========== app_ds3231_emul_set_delay ===================================================
+void app_ds3231_emul_set_delay(uint32_t delay_us, uint32_t stall_every, uint32_t stall_ms)
+{
+    ds3231_emul_timing.delay_us = delay_us;
+    ds3231_emul_timing.stall_every = stall_every;
+    ds3231_emul_timing.stall_ms = stall_ms;
+    ds3231_emul_timing.transfers = 0;
+}
+
+static const struct i2c_emul_api ds3231_emul_api = {
+    .transfer = ds3231_emul_transfer,
+};
+
+//  ========== ds3231_emul_init ============================================================
+static int ds3231_emul_init(const struct emul *target, const struct device *parent)
+{
+    struct ds3231_emul_data *data = target->data;
+
+    memset(data->regs, 0, sizeof(data->regs));
+    data->regs[DS3231_REG_CONTROL] = DS3231_CTRL_INTCN | DS3231_CTRL_RS_MASK;
+    data->base_epoch_s = DS3231_EMUL_EPOCH;
+    k_timer_init(&data->sqw_timer, ds3231_emul_sqw, NULL);
+    ds3231_emul_restart(data);
+    return 0;
+}
+
+#define DS3231_EMUL(n)                                                                  \
+    static struct ds3231_emul_data ds3231_emul_data_##n;                                \
+    EMUL_DT_INST_DEFINE(n, ds3231_emul_init, &ds3231_emul_data_##n, NULL,               \
+                        &ds3231_emul_api, NULL);
+
+DT_INST_FOREACH_STATUS_OKAY(DS3231_EMUL)
+
+#endif /* CONFIG_I2C_EMUL */
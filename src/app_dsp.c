@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#if defined(CONFIG_APP_DSP)
+
+#include "app_dsp.h"
+
+#include <math.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_dsp, CONFIG_APP_ADC_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define DSP_Q                   15
+#define DSP_HP_Q                30      // high-pass pole
+#define DSP_HP_STATE_Q          8       // fractional bits kept in the high-pass state
+#define DSP_BENCH_OUTPUTS       256
+
+// pole of y[n] = x[n] - x[n-1] + a * y[n-1], a = 1 - 2 pi fc / fs
+#define DSP_HP_POLE             ((int32_t)((1LL << DSP_HP_Q) -                              \
+                                 ((6746518852LL * CONFIG_APP_DSP_HPF_CUTOFF_MHZ) /          \
+                                  (1000LL * ADC_STREAM_RATE_HZ))))
+
+BUILD_ASSERT((ADC_STREAM_RATE_HZ % DSP_DECIMATION) == 0,
+             "the sample rate must be a multiple of the decimation factor");
+
+//  ========== globals =====================================================================
+// symmetric low-pass taps in Q15, word aligned for the dual MAC loads
+static int16_t dsp_coef[DSP_FIR_TAPS] __aligned(4);
+
+//  ========== dsp_sat16 ===================================================================
+static inline int16_t dsp_sat16(int64_t acc, uint16_t *clipped)
+{
+    int64_t y = (acc + (1 << (DSP_Q - 1))) >> DSP_Q;
+
+    if (y > INT16_MAX || y < INT16_MIN) {
+        (*clipped)++;
+        return (y > 0) ? INT16_MAX : INT16_MIN;
+    }
+    return (int16_t)y;
+}
+
+//  ========== dsp_design ==================================================================
+// windowed-sinc low-pass with the cutoff at 0.45 of the output rate, Hamming window.
+// runs once at init, the rounding residue goes to the centre taps so that the DC gain
+// is exactly one
+static void dsp_design(void)
+{
+    float fc = 0.45f / DSP_DECIMATION;
+    float centre = (DSP_FIR_TAPS - 1) / 2.0f;
+    float h[DSP_FIR_TAPS];
+    float sum = 0.0f;
+    int32_t total = 0;
+
+    for (int k = 0; k < DSP_FIR_TAPS; k++) {
+        float t = k - centre;
+        float w = 0.54f - (0.46f * cosf((2.0f * (float)M_PI * k) / (DSP_FIR_TAPS - 1)));
+        h[k] = w * ((t == 0.0f) ? (2.0f * fc) : (sinf(2.0f * (float)M_PI * fc * t) /
+                                                 ((float)M_PI * t)));
+        sum += h[k];
+    }
+    for (int k = 0; k < DSP_FIR_TAPS; k++) {
+        dsp_coef[k] = (int16_t)lroundf((h[k] / sum) * (1 << DSP_Q));
+        total += dsp_coef[k];
+    }
+
+    // split the residue over the two centre taps to keep the filter symmetric
+    total = (1 << DSP_Q) - total;
+    dsp_coef[(DSP_FIR_TAPS / 2) - 1] += (int16_t)(total / 2);
+    dsp_coef[DSP_FIR_TAPS / 2] += (int16_t)(total - (total / 2));
+}
+
+//  ========== app_dsp_fir_scalar ==========================================================
+// portable kernel: outputs consecutive decimated samples, the j-th one filtering
+// window[j * DSP_DECIMATION ... + DSP_FIR_TAPS - 1]. the taps are symmetric, so the
+// window is walked oldest first without reversing them. returns the clipped count
+uint16_t app_dsp_fir_scalar(const int16_t *window, uint16_t outputs, int16_t *out)
+{
+    uint16_t clipped = 0;
+
+    for (uint16_t j = 0; j < outputs; j++) {
+        const int16_t *x = window + (j * DSP_DECIMATION);
+        int64_t acc = 0;
+
+        for (uint16_t k = 0; k < DSP_FIR_TAPS; k++) {
+            acc += (int32_t)x[k] * dsp_coef[k];
+        }
+        out[j] = dsp_sat16(acc, &clipped);
+    }
+    return clipped;
+}
+
+#if DSP_HAS_SIMD
+//  ========== dsp_smlald ==================================================================
+// acc += x.lo * y.lo + x.hi * y.hi, 64-bit accumulation so it matches the scalar sum
+static inline int64_t dsp_smlald(uint32_t x, uint32_t y, int64_t acc)
+{
+    union {
+        int64_t s64;
+        struct {
+            uint32_t lo;
+            uint32_t hi;
+        } w;
+    } r = { .s64 = acc };
+
+    __asm__ ("smlald %0, %1, %2, %3" : "+r" (r.w.lo), "+r" (r.w.hi) : "r" (x), "r" (y));
+    return r.s64;
+}
+
+//  ========== app_dsp_fir_simd ============================================================
+// same arithmetic as the scalar kernel, two taps per instruction. the window may be
+// half-word aligned, the M4 handles unaligned word loads
+uint16_t app_dsp_fir_simd(const int16_t *window, uint16_t outputs, int16_t *out)
+{
+    const uint32_t *coef = (const uint32_t *)dsp_coef;
+    uint16_t clipped = 0;
+
+    for (uint16_t j = 0; j < outputs; j++) {
+        const int16_t *x = window + (j * DSP_DECIMATION);
+        int64_t acc = 0;
+        uint16_t k = 0;
+
+        for (; k + 4 <= DSP_FIR_TAPS; k += 4) {
+            uint32_t x0, x1;
+
+            memcpy(&x0, &x[k], sizeof(x0));
+            memcpy(&x1, &x[k + 2], sizeof(x1));
+            acc = dsp_smlald(x0, coef[k / 2], acc);
+            acc = dsp_smlald(x1, coef[(k / 2) + 1], acc);
+        }
+        for (; k < DSP_FIR_TAPS; k += 2) {
+            uint32_t x0;
+
+            memcpy(&x0, &x[k], sizeof(x0));
+            acc = dsp_smlald(x0, coef[k / 2], acc);
+        }
+        out[j] = dsp_sat16(acc, &clipped);
+    }
+    return clipped;
+}
+#endif /* DSP_HAS_SIMD */
+
+//  ========== dsp_highpass ================================================================
+// DC blocker from in[] to dst[], state kept in Q8 to avoid a limit cycle at low levels
+static void dsp_highpass(struct app_dsp_filter *filter, const int16_t *in, uint16_t count,
+                         int16_t *dst)
+{
+    uint16_t clipped = 0;
+
+    if (CONFIG_APP_DSP_HPF_CUTOFF_MHZ == 0) {
+        memcpy(dst, in, count * sizeof(int16_t));
+        return;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        int64_t acc = ((int64_t)(in[i] - filter->hp_x1) << DSP_HP_STATE_Q) +
+                      (((int64_t)filter->hp_y1 * DSP_HP_POLE) >> DSP_HP_Q);
+
+        filter->hp_x1 = in[i];
+        filter->hp_y1 = (int32_t)acc;
+        dst[i] = dsp_sat16(acc << (DSP_Q - DSP_HP_STATE_Q), &clipped);
+    }
+    filter->stats.clipped += clipped;
+}
+
+//  ========== app_dsp_init ================================================================
+int8_t app_dsp_init(void)
+{
+    dsp_design();
+    LOG_INF("DSP front-end: %u Hz -> %u Hz, %u taps, %s kernel", ADC_STREAM_RATE_HZ,
+           DSP_OUTPUT_RATE_HZ, DSP_FIR_TAPS, DSP_HAS_SIMD ? "SMLALD" : "scalar");
+    return 0;
+}
+
+//  ========== app_dsp_filter_init =========================================================
+void app_dsp_filter_init(struct app_dsp_filter *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+}
+
+//  ========== app_dsp_filter_process ======================================================
+// filter a block of consecutive input samples into out[], returns the number of output
+// samples and in *first_index the input index the first of them was computed at (its
+// timestamp is that of in[*first_index] minus DSP_DELAY_US). out may be in itself, an
+// output never overtakes the input it is computed from
+int app_dsp_filter_process(struct app_dsp_filter *filter, const int16_t *in, uint16_t count,
+                           int16_t *out, uint16_t size, uint16_t *first_index)
+{
+    uint32_t start_cycles = k_cycle_get_32();
+    uint16_t produced = 0;
+    bool first = true;
+    int16_t *chunk;
+
+    if (!filter || !in || !out || !first_index) {
+        return -EINVAL;
+    }
+    chunk = &filter->work[DSP_FIR_TAPS - 1];
+    if (((count + DSP_DECIMATION - 1) / DSP_DECIMATION) > size) {
+        return -ENOMEM;
+    }
+
+    if (!filter->primed && count > 0) {
+        // start from the first sample, not from a step out of zero
+        filter->hp_x1 = in[0];
+        filter->primed = true;
+    }
+    *first_index = 0;
+
+    for (uint16_t done = 0; done < count;) {
+        uint16_t n = MIN(count - done, DSP_CHUNK_SAMPLES);
+        uint16_t outputs = 0;
+        uint16_t clipped;
+
+        dsp_highpass(filter, &in[done], n, chunk);
+
+        if (DSP_DECIMATION == 1) {
+            memcpy(&out[produced], chunk, n * sizeof(int16_t));
+            produced += n;
+            done += n;
+            continue;
+        }
+
+        // output j of this chunk is due at input filter->phase + j * DSP_DECIMATION,
+        // its window ends on that sample
+        if (filter->phase < n) {
+            outputs = ((n - filter->phase) + DSP_DECIMATION - 1) / DSP_DECIMATION;
+            if (first) {
+                *first_index = done + filter->phase;
+                first = false;
+            }
+#if DSP_HAS_SIMD
+            clipped = app_dsp_fir_simd(&filter->work[filter->phase], outputs, &out[produced]);
+#else
+            clipped = app_dsp_fir_scalar(&filter->work[filter->phase], outputs, &out[produced]);
+#endif
+            filter->stats.clipped += clipped;
+            produced += outputs;
+        }
+        filter->phase = (filter->phase + (outputs * DSP_DECIMATION)) - n;
+
+        // keep the newest DSP_FIR_TAPS - 1 samples as history for the next chunk
+        memmove(filter->work, &filter->work[n], (DSP_FIR_TAPS - 1) * sizeof(int16_t));
+        done += n;
+    }
+
+    filter->stats.blocks++;
+    filter->stats.samples_in += count;
+    filter->stats.samples_out += produced;
+    filter->stats.cycles += k_cycle_get_32() - start_cycles;
+    return produced;
+}
+
+//  ========== dsp_golden ==================================================================
+// reference vectors whose outputs follow from the design alone: a constant comes out
+// unchanged (unity DC gain), an impulse of -32768 gives back the negated taps and one of
+// 16384 the halved taps, and full scale inputs matched to the tap signs saturate as soon
+// as one tap is negative. returns the wrong outputs and clip counts, *checked the
+// outputs compared
+typedef uint16_t (*dsp_fir_t)(const int16_t *window, uint16_t outputs, int16_t *out);
+
+static uint32_t dsp_golden(dsp_fir_t fir, int16_t *input, size_t size, int16_t *out,
+                           uint32_t *checked)
+{
+    static const int16_t levels[] = { 0, 12345, -1, INT16_MAX, INT16_MIN };
+    uint32_t errors = 0;
+    uint16_t negative = 0;
+    size_t impulse = (DSP_BENCH_OUTPUTS / 2) * DSP_DECIMATION;
+    uint16_t clipped;
+
+    *checked = 0;
+    for (size_t l = 0; l < ARRAY_SIZE(levels); l++) {
+        for (size_t i = 0; i < size; i++) {
+            input[i] = levels[l];
+        }
+        clipped = fir(input, DSP_BENCH_OUTPUTS, out);
+        for (uint32_t j = 0; j < DSP_BENCH_OUTPUTS; j++) {
+            errors += (out[j] != levels[l]);
+        }
+        errors += (clipped != 0);
+        *checked += DSP_BENCH_OUTPUTS;
+    }
+
+    // output j sees the impulse on tap impulse - j * DSP_DECIMATION. a half scale
+    // impulse halves the taps, rounding half up
+    for (int half = 0; half <= 1; half++) {
+        memset(input, 0, size * sizeof(int16_t));
+        input[impulse] = half ? (1 << (DSP_Q - 1)) : INT16_MIN;
+        clipped = fir(input, DSP_BENCH_OUTPUTS, out);
+        for (uint32_t j = 0; j < DSP_BENCH_OUTPUTS; j++) {
+            int32_t k = (int32_t)impulse - (int32_t)(j * DSP_DECIMATION);
+            int16_t expected = 0;
+
+            if (k >= 0 && k < DSP_FIR_TAPS) {
+                expected = half ? (int16_t)((dsp_coef[k] + 1) >> 1) : -dsp_coef[k];
+            }
+            errors += (out[j] != expected);
+        }
+        errors += (clipped != 0);
+        *checked += DSP_BENCH_OUTPUTS;
+    }
+
+    for (uint16_t k = 0; k < DSP_FIR_TAPS; k++) {
+        negative += (dsp_coef[k] < 0);
+    }
+    for (int sign = 1; sign >= -1; sign -= 2) {
+        for (uint16_t k = 0; k < DSP_FIR_TAPS; k++) {
+            input[k] = ((dsp_coef[k] >= 0) == (sign > 0)) ? INT16_MAX : INT16_MIN;
+        }
+        clipped = fir(input, 1, out);
+        errors += (out[0] != ((sign > 0) ? INT16_MAX : INT16_MIN));
+        errors += (clipped != ((negative > 0) ? 1 : 0));
+        *checked += 1;
+    }
+    return errors;
+}
+
+//  ========== app_dsp_bench ===============================================================
+// cycles per output sample of both kernels, bit-exact comparison of their outputs, and
+// both checked against the reference vectors
+int8_t app_dsp_bench(struct app_dsp_bench_result *result)
+{
+    static int16_t input[(DSP_BENCH_OUTPUTS * DSP_DECIMATION) + DSP_FIR_TAPS];
+    static int16_t out_scalar[DSP_BENCH_OUTPUTS];
+    static int16_t out_simd[DSP_BENCH_OUTPUTS];
+    uint32_t seed = 0x6d2b79f5;
+    uint32_t start;
+
+    if (!result) {
+        return -EINVAL;
+    }
+    memset(result, 0, sizeof(*result));
+
+    // full-scale noise so that the saturation paths are exercised as well
+    for (size_t i = 0; i < ARRAY_SIZE(input); i++) {
+        seed = (seed * 1664525u) + 1013904223u;
+        input[i] = (int16_t)(seed >> 16);
+    }
+
+    result->outputs = DSP_BENCH_OUTPUTS;
+    result->taps = DSP_FIR_TAPS;
+
+    start = k_cycle_get_32();
+    (void)app_dsp_fir_scalar(input, DSP_BENCH_OUTPUTS, out_scalar);
+    result->scalar_cycles = (k_cycle_get_32() - start) / DSP_BENCH_OUTPUTS;
+
+#if DSP_HAS_SIMD
+    result->simd = true;
+    start = k_cycle_get_32();
+    (void)app_dsp_fir_simd(input, DSP_BENCH_OUTPUTS, out_simd);
+    result->simd_cycles = (k_cycle_get_32() - start) / DSP_BENCH_OUTPUTS;
+
+    for (uint32_t i = 0; i < DSP_BENCH_OUTPUTS; i++) {
+        if (out_simd[i] != out_scalar[i]) {
+            result->mismatches++;
+        }
+    }
+    result->simd_errors = dsp_golden(app_dsp_fir_simd, input, ARRAY_SIZE(input), out_simd,
+                                     &result->golden_outputs);
+#else
+    ARG_UNUSED(out_simd);
+#endif
+    result->scalar_errors = dsp_golden(app_dsp_fir_scalar, input, ARRAY_SIZE(input), out_scalar,
+                                       &result->golden_outputs);
+    return 0;
+}
+
+#endif /* CONFIG_APP_DSP */
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_DSP_H
+#define APP_DSP_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+#include "app_adc.h"
+
+//  ========== defines =====================================================================
+// filter stage between the ADC stream and the detector: DC removal, then anti-alias
+// FIR and decimation by DSP_DECIMATION, all in Q15
+#define DSP_DECIMATION          CONFIG_APP_DSP_DECIMATION
+#define DSP_FIR_TAPS            ROUND_UP(CONFIG_APP_DSP_FIR_TAPS, 2)
+#define DSP_CHUNK_SAMPLES       ADC_STREAM_BLOCK_SAMPLES
+#define DSP_OUTPUT_RATE_HZ      (ADC_STREAM_RATE_HZ / DSP_DECIMATION)
+#define DSP_OUTPUT_INTERVAL_US  (ADC_STREAM_INTERVAL_US * DSP_DECIMATION)
+
+// linear-phase FIR: outputs lag the newest input by half the filter length
+#define DSP_DELAY_US            ((DSP_DECIMATION > 1) ? \
+                                 (((DSP_FIR_TAPS - 1) * ADC_STREAM_INTERVAL_US) / 2) : 0)
+
+// dual 16-bit MAC (SMLALD) kernel on cores with the DSP extension
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#define DSP_HAS_SIMD            1
+#else
+#define DSP_HAS_SIMD            0
+#endif
+
+//  ========== types =======================================================================
+struct app_dsp_stats {
+    uint32_t blocks;
+    uint64_t samples_in;
+    uint64_t samples_out;
+    uint32_t clipped;           // outputs saturated to 16 bits
+    uint64_t cycles;            // time spent in app_dsp_filter_process()
+};
+
+// per-channel filter state, the coefficients are shared
+struct app_dsp_filter {
+    bool primed;
+    int32_t hp_x1;              // previous input
+    int32_t hp_y1;              // previous high-pass output, Q8
+    uint16_t phase;             // inputs left before the next decimated output
+    // FIR history (DSP_FIR_TAPS - 1 samples) followed by the chunk being filtered
+    int16_t work[DSP_FIR_TAPS - 1 + DSP_CHUNK_SAMPLES];
+    struct app_dsp_stats stats;
+};
+
+// scalar against dual MAC kernel, on the same pseudo-random input
+struct app_dsp_bench_result {
+    bool simd;                  // dual MAC kernel available on this target
+    uint32_t outputs;
+    uint32_t taps;
+    uint32_t scalar_cycles;     // per output sample
+    uint32_t simd_cycles;
+    uint32_t mismatches;        // outputs that differ between the two kernels
+    uint32_t golden_outputs;    // outputs checked against the reference vectors, per kernel
+    uint32_t scalar_errors;     // of them, wrong outputs or clip counts of each kernel
+    uint32_t simd_errors;
+};
+
+//  ========== prototypes ==================================================================
+int8_t app_dsp_init(void);
+void app_dsp_filter_init(struct app_dsp_filter *filter);
+int app_dsp_filter_process(struct app_dsp_filter *filter, const int16_t *in, uint16_t count,
+                           int16_t *out, uint16_t size, uint16_t *first_index);
+uint16_t app_dsp_fir_scalar(const int16_t *window, uint16_t outputs, int16_t *out);
+#if DSP_HAS_SIMD
+uint16_t app_dsp_fir_simd(const int16_t *window, uint16_t outputs, int16_t *out);
+#endif
+int8_t app_dsp_bench(struct app_dsp_bench_result *result);
+
+#endif /* APP_DSP_H */
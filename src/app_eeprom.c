@@ -8,122 +8,150 @@
 //  ========== includes ====================================================================
 #include "app_eeprom.h"
 #include "app_rtc.h"
+#include "app_adc.h"
 
-//  ========== serialize_uint64_to_bytes ===================================================
-// serialize a uint64_t to bytes
-static void serialize_uint64_to_bytes(uint64_t value, uint8_t *buffer) {
-    for (int i = 0; i < 8; i++) {
-        buffer[i] = (value >> (56 - 8 * i)) & 0xFF;
-    }
-}
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_eeprom, CONFIG_APP_STORAGE_LOG_LEVEL);
 
-//  ========== deserialize_bytes_to_uint64 ================================================
-// deserialize bytes to uint64_t
-static uint64_t deserialize_bytes_to_uint64(const uint8_t *buffer) {
-    uint64_t value = 0;
-    for (int i = 0; i < 8; i++) {
-        value |= ((uint64_t)buffer[i] << (56 - 8 * i));
-    }
-    return value;
-}
+//  ========== globals =====================================================================
+// position of the last record written, used by the read-back path
+static struct app_flash_log_cursor last_record;
+
+// last sample of the previous block, the first Steim-2 difference is taken against it
+static int32_t last_sample;
+
+// compressed block, too large for the thread stacks
+static uint8_t block_buffer[STEIM2_MAX_SIZE(STEIM2_MAX_BLOCK_SAMPLES)];
 
 //  ========== app_eeprom_init =============================================================
 int8_t app_eeprom_init(const struct device *dev)
 {
 	// check if the EEPROM device is ready
 	if (!device_is_ready(dev)) {
-		printk("%s: device is not ready\n", dev->name);
+		LOG_ERR("%s: device is not ready", dev->name);
 		return -1;
 	}
 
-	// erase the data storage partition
-	int8_t ret = flash_erase(dev, SPI_FLASH_OFFSET, SPI_FLASH_SECTOR_SIZE*SPI_FLASH_SECTOR_NB);
+	// recover the record log instead of erasing it, records survive until trimmed
+	int8_t ret = app_flash_log_init(dev);
 	if (ret != 0){
-		printf("MX25R64 flash erase failed. error: %d\n", ret);
+		LOG_ERR("MX25R64 record log recovery failed. error: %d", ret);
 		return -1;
 	} else {
-		printk("MX25R64 flash erase succeeded\n");
+		LOG_INF("MX25R64 record log recovered");
 	}	
 	return 1;
 }
 
 //  ========== app_eeprom_write ============================================================
-// write data to EEPROM
-int8_t app_eeprom_write(const struct device *dev, const uint8_t *data, size_t length)
+// append a record to the log in EEPROM, time_ms (time of its first sample) is the key of
+// the range queries
+int8_t app_eeprom_write(const struct device *dev, const uint8_t *data, size_t length,
+                        uint64_t time_ms)
 {
-    int8_t ret = flash_write(dev, SPI_FLASH_OFFSET, data, length);
+    int8_t ret = app_flash_log_append(data, length, time_ms, &last_record);
     if (ret != 0) {
-        printk("Eerror writing data. Error: %d\n", ret);
+        LOG_ERR("Eerror writing data. Error: %d", ret);
         return -1;
     }
-    printk("successfully wrote %zu bytes to address 0x%X\n", length, SPI_FLASH_OFFSET);
+    LOG_DBG("successfully wrote %zu bytes to sector %u offset 0x%X", length,
+           last_record.sector, last_record.offset);
     return 0;
 }
 
 //  ========== app_rom_read ================================================================
-// Read data from EEPROM
+// Read the last written record back from EEPROM, -EBADMSG from the log means a CRC error
 int8_t app_eeprom_read(const struct device *dev, uint8_t *data, size_t length)
 {
-    int ret = flash_read(dev, SPI_FLASH_OFFSET, data, length);
+    size_t record_length;
+    int ret = app_flash_log_read(&last_record, data, length, &record_length);
     if (ret != 0) {
-        printk("error reading data. Error: %d\n", ret);
+        LOG_ERR("error reading data. Error: %d", ret);
         return -1;
     }
-    printk("successfully read %zu bytes from address 0x%X\n", length, SPI_FLASH_OFFSET);
+    LOG_DBG("successfully read %zu bytes from sector %u offset 0x%X", record_length,
+           last_record.sector, last_record.offset);
     return 0;
 }
 
+//  ========== app_eeprom_store_block ======================================================
+// compress a block of consecutive samples as Steim-2 frames behind a timestamped header
+// and append it to the log. first breaks the difference chain, e.g. at the start of an
+// event window which does not follow the previous block
+int8_t app_eeprom_store_block(const struct device *dev, const int16_t *samples, uint16_t count,
+                              uint64_t start_time, uint16_t rate_hz, bool first)
+{
+    struct app_steim2_block_hdr hdr = {
+        .start_time = start_time,
+        .rate_hz = rate_hz,
+    };
+    int len;
+
+    if (!samples || count == 0 || count > STEIM2_MAX_BLOCK_SAMPLES) {
+        return -EINVAL;
+    }
+
+    len = app_steim2_encode(samples, count, first ? samples[0] : last_sample, &hdr,
+                            block_buffer, sizeof(block_buffer));
+    if (len < 0) {
+        LOG_ERR("failed to compress ADC block. error: %d", len);
+        return -1;
+    }
+    last_sample = samples[count - 1];
+    LOG_DBG("compressed %u samples into %d bytes", count, len);
+
+    return app_eeprom_write(dev, block_buffer, len, start_time);
+}
+
+#if defined(CONFIG_APP_SPECTRUM)
+//  ========== app_eeprom_store_spectrum ===================================================
+// append a spectral summary to the log, keyed by the start of its period like a block.
+// it is logged at the end of the period, after the blocks of the period: time queries
+// allow for it (CONFIG_APP_FLASH_LOG_KEY_SKEW_S). readers tell the records apart by their
+// first byte
+int8_t app_eeprom_store_spectrum(const struct device *dev,
+                                 const struct app_spectrum_summary *summary)
+{
+    uint8_t record[SPECTRUM_MAX_SIZE];
+    int len = app_spectrum_encode(summary, record, sizeof(record));
+
+    if (len < 0) {
+        LOG_ERR("failed to encode spectral summary. error: %d", len);
+        return -1;
+    }
+    return app_eeprom_write(dev, record, len, summary->start_time);
+}
+#endif
+
 //  ======== app_rom_handler ===============================================================
+// the samples stay off the caller's stack, see CONFIG_APP_ADC_ONESHOT_SAMPLES
 int8_t app_eeprom_handler(const struct device *dev)
 {
-    uint8_t buffer[256] = {0}; // Enough space for timestamp and ADC data
-    int16_t adc_data[MAX_RECORDS] = {0};
-    uint64_t timestamp = 0;
+    static int16_t adc_data[MAX_RECORDS];
+    uint64_t start_time;
 
     if (!device_is_ready(dev)) {
-        printk("%s: device is not ready\n", dev->name);
+        LOG_ERR("%s: device is not ready", dev->name);
         return -1;
     }
 
-    // initialize RTC and get the current timestamp
+    // initialize RTC and get the timestamp of the first sample
     const struct device *rtc_dev = app_rtc_init();
     if (!rtc_dev) {
-        printk("failed to initialize RTC device.\n");
+        LOG_ERR("failed to initialize RTC device.");
         return -1;
     }
-    timestamp = app_rtc_get_time(rtc_dev);
-
-    // serialize timestamp into the buffer
-    serialize_uint64_to_bytes(timestamp, buffer);
+    start_time = app_rtc_get_time(rtc_dev);
 
-    // get ADC data and serialize it into the buffer
+    // get ADC data, one-shot sampling has no fixed rate
     for (int i = 0; i < MAX_RECORDS; i++) {
         adc_data[i] = app_nrf52_get_adc();
-        buffer[8 + i * 2] = (adc_data[i] >> 8) & 0xFF; // high byte
-        buffer[9 + i * 2] = adc_data[i] & 0xFF;        // low byte
     }
 
-    // write buffer to EEPROM
-    if (app_eeprom_write(dev, buffer, sizeof(buffer)) != 0) {
+    // compress and write block to EEPROM. no read-back: the record carries a CRC which
+    // is checked at boot (head sector) and whenever the record is read for export
+    if (app_eeprom_store_block(dev, adc_data, MAX_RECORDS, start_time, 0, false) != 0) {
         return -1;
     }
-
-    // read back and verify
-    uint8_t read_buffer[256] = {0};
-    if (app_eeprom_read(dev, read_buffer, sizeof(read_buffer)) != 0) {
-        return -1;
-    }
-
-    // deserialize timestamp
-    uint64_t read_timestamp = deserialize_bytes_to_uint64(read_buffer);
-    printk("Read timestamp: %llu\n", read_timestamp);
-
-    // deserialize and print ADC data
-    for (int i = 0; i < MAX_RECORDS; i++) {
-        int16_t read_adc = (read_buffer[8 + i * 2] << 8) | read_buffer[9 + i * 2];
-        printk("Read ADC value [%d]: %d\n", i, read_adc);
-    }
     return 0;
 }
-
-
@@ -14,19 +14,40 @@
 #include <zephyr/devicetree.h>
 #include <zephyr/drivers/flash.h>
 
+#include "app_flash_log.h"
+#include "app_steim2.h"
+#if defined(CONFIG_APP_SPECTRUM)
+#include "app_spectrum.h"
+#endif
+
 //  ========== defines =====================================================================
+#if DT_HAS_COMPAT_STATUS_OKAY(nordic_qspi_nor)
 #define SPI_FLASH_DEVICE        DT_COMPAT_GET_ANY_STATUS_OKAY(nordic_qspi_nor)
-#define SPI_FLASH_OFFSET		0x00000
+#else
+// host builds: the flash simulator stands in for the MX25R64
+#define SPI_FLASH_DEVICE        DT_COMPAT_GET_ANY_STATUS_OKAY(zephyr_sim_flash)
+#endif
 #define SPI_FLASH_SECTOR_SIZE	4096   // in bytes
-#define SPI_FLASH_SECTOR_NB     1
-#define MAX_RECORDS             128    // max number of ADC records                     
+#define MAX_RECORDS             CONFIG_APP_ADC_ONESHOT_SAMPLES    // samples per one-shot record
+
+// largest block handed to app_eeprom_store_block()
+#if defined(CONFIG_APP_TRIGGER)
+#define STEIM2_MAX_BLOCK_SAMPLES    MAX(MAX_RECORDS, CONFIG_APP_TRIGGER_OUT_SAMPLES)
+#else
+#define STEIM2_MAX_BLOCK_SAMPLES    MAX_RECORDS
+#endif
 
 //  ========== prototypes ==================================================================
 int8_t app_eeprom_init(const struct device *dev);
-int8_t app_eeprom_write(const struct device *dev, const uint8_t *data, size_t length);
+int8_t app_eeprom_write(const struct device *dev, const uint8_t *data, size_t length,
+                        uint64_t time_ms);
 int8_t app_eeprom_read(const struct device *dev, uint8_t *data, size_t length);
+int8_t app_eeprom_store_block(const struct device *dev, const int16_t *samples, uint16_t count,
+                              uint64_t start_time, uint16_t rate_hz, bool first);
+#if defined(CONFIG_APP_SPECTRUM)
+int8_t app_eeprom_store_spectrum(const struct device *dev,
+                                 const struct app_spectrum_summary *summary);
+#endif
 int8_t app_eeprom_handler(const struct device *dev);
-static void serialize_uint64_to_bytes(uint64_t value, uint8_t *buffer);
-static uint64_t deserialize_bytes_to_uint64(const uint8_t *buffer);
 
 #endif /* APP_EEPROM_H */
\ No newline at end of file
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// bulk export of the record log on a dedicated UART (a pty on native_sim). the reader
+// fills one buffer with frames straight from the flash while the transmitter drains the
+// other one
+#if defined(CONFIG_APP_EXPORT)
+
+#include "app_export.h"
+#include "app_flash_log.h"
+#include "app_crc32.h"
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_export, CONFIG_APP_STORAGE_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define EXPORT_UART_NODE            DT_CHOSEN(app_export_uart)
+#define EXPORT_BUFFER_SIZE          CONFIG_APP_EXPORT_BUFFER_SIZE
+#define EXPORT_FRAME_OVERHEAD       (EXPORT_FRAME_HDR_SIZE + EXPORT_FRAME_CRC_SIZE)
+#define EXPORT_POLL_MS              20      // request polling while idle
+#define EXPORT_STACK_SIZE           CONFIG_APP_EXPORT_STACK_SIZE
+
+BUILD_ASSERT(CONFIG_APP_EXPORT_PRIORITY > CONFIG_APP_HOUSEKEEPING_PRIORITY,
+             "the export must not preempt housekeeping");
+
+//  ========== types =======================================================================
+// a filled buffer handed to the transmitter
+struct export_chunk {
+    uint8_t index;
+    uint16_t length;
+};
+
+//  ========== globals =====================================================================
+static const struct device *const export_uart = DEVICE_DT_GET(EXPORT_UART_NODE);
+
+static uint8_t export_buffer[2][EXPORT_BUFFER_SIZE];
+K_SEM_DEFINE(export_free, 2, 2);
+K_MSGQ_DEFINE(export_filled, sizeof(struct export_chunk), 2, 4);
+
+static struct app_export_stats export_stats;
+static struct k_spinlock export_lock;
+
+//  ========== export_put_frame ============================================================
+// frame the payload already at out + EXPORT_FRAME_HDR_SIZE, returns the frame size
+static size_t export_put_frame(uint8_t *out, uint8_t type, uint8_t flags, uint32_t seq,
+                               uint64_t time_ms, uint16_t length)
+{
+    sys_put_le32(EXPORT_FRAME_MAGIC, &out[0]);
+    out[4] = type;
+    out[5] = flags;
+    sys_put_le16(length, &out[6]);
+    sys_put_le32(seq, &out[8]);
+    sys_put_le64(time_ms, &out[12]);
+    sys_put_le32(app_crc32_update(0, out, EXPORT_FRAME_HDR_SIZE + length),
+                 &out[EXPORT_FRAME_HDR_SIZE + length]);
+    return EXPORT_FRAME_OVERHEAD + length;
+}
+
+//  ========== export_fill =================================================================
+// read records into the buffer as whole frames, the payload lands in place. returns the
+// bytes filled; *end is set once the log is exhausted
+static size_t export_fill(uint8_t *buf, struct app_flash_log_cursor *cursor, uint32_t *next_seq,
+                          uint32_t *records, bool *end)
+{
+    struct app_flash_log_cursor before;
+    size_t pos = 0;
+    size_t length;
+    int ret;
+
+    while (EXPORT_BUFFER_SIZE - pos > EXPORT_FRAME_OVERHEAD) {
+        before = *cursor;
+        ret = app_flash_log_iter_next(cursor, &buf[pos + EXPORT_FRAME_HDR_SIZE],
+                                      EXPORT_BUFFER_SIZE - pos - EXPORT_FRAME_OVERHEAD, &length);
+        if (ret == -ENOMEM) {
+            if (pos > 0) {
+                // opens the next buffer
+                *cursor = before;
+                break;
+            }
+            LOG_WRN("record %u larger than the export buffer, skipped", cursor->record_seq);
+            k_spinlock_key_t key = k_spin_lock(&export_lock);
+            export_stats.skipped++;
+            k_spin_unlock(&export_lock, key);
+            continue;
+        }
+        if (ret != 0) {
+            if (ret != -ENOENT) {
+                LOG_ERR("export stopped on a log read error: %d", ret);
+            }
+            *end = true;
+            break;
+        }
+
+        // records skipped here or gone from the log, not a frame lost on the line
+        pos += export_put_frame(&buf[pos], EXPORT_FRAME_RECORD,
+                                (cursor->record_seq != *next_seq) ? EXPORT_FLAG_GAP : 0,
+                                cursor->record_seq, cursor->time_ms, (uint16_t)length);
+        *next_seq = cursor->record_seq + 1;
+        (*records)++;
+    }
+    return pos;
+}
+
+//  ========== export_run ==================================================================
+// stream the log from record_seq on, then the end frame
+static void export_run(uint32_t record_seq)
+{
+    struct app_flash_log_cursor cursor;
+    struct export_chunk chunk;
+    uint32_t next_seq = record_seq;
+    uint32_t records = 0;
+    uint64_t bytes = 0;
+    uint8_t index = 0;
+    bool end = false;
+    bool done = false;
+    int64_t start = k_uptime_get();
+
+    if (app_flash_log_seek(&cursor, record_seq) != 0) {
+        // empty log, only the end frame
+        end = true;
+    }
+
+    while (!done) {
+        // blocks while both buffers are queued for transmission
+        k_sem_take(&export_free, K_FOREVER);
+        chunk.index = index;
+        chunk.length = end ? 0 : export_fill(export_buffer[index], &cursor, &next_seq,
+                                             &records, &end);
+        if (end && EXPORT_BUFFER_SIZE - chunk.length >= EXPORT_FRAME_OVERHEAD) {
+            chunk.length += export_put_frame(&export_buffer[index][chunk.length],
+                                             EXPORT_FRAME_END, 0, next_seq, 0, 0);
+            done = true;
+        }
+        bytes += chunk.length;
+        (void)k_msgq_put(&export_filled, &chunk, K_FOREVER);
+        index ^= 1;
+    }
+
+    // both buffers back once the last one is out
+    k_sem_take(&export_free, K_FOREVER);
+    k_sem_take(&export_free, K_FOREVER);
+    k_sem_give(&export_free);
+    k_sem_give(&export_free);
+
+    uint32_t elapsed_ms = (uint32_t)MAX(k_uptime_get() - start, 1);
+    k_spinlock_key_t key = k_spin_lock(&export_lock);
+    export_stats.exports++;
+    export_stats.records += records;
+    export_stats.bytes += bytes;
+    export_stats.last_ms = elapsed_ms;
+    export_stats.last_bytes_per_s = (uint32_t)((bytes * MSEC_PER_SEC) / elapsed_ms);
+    k_spin_unlock(&export_lock, key);
+
+    LOG_INF("export from record %u: %u records, %llu bytes in %u ms (%u B/s), resume at %u",
+            record_seq, records, bytes, elapsed_ms, export_stats.last_bytes_per_s, next_seq);
+}
+
+//  ========== export_thread ===============================================================
+// waits for a request on the export UART; a sliding window over the received bytes
+// resynchronizes on the magic after line noise or a truncated request
+static void export_thread(void *p1, void *p2, void *p3)
+{
+    uint8_t request[EXPORT_REQUEST_SIZE];
+    size_t have = 0;
+    unsigned char c;
+
+    if (!device_is_ready(export_uart)) {
+        LOG_ERR("%s: export UART is not ready", export_uart->name);
+        return;
+    }
+
+    while (1) {
+        if (uart_poll_in(export_uart, &c) != 0) {
+            k_sleep(K_MSEC(EXPORT_POLL_MS));
+            continue;
+        }
+        if (have == sizeof(request)) {
+            memmove(request, &request[1], sizeof(request) - 1);
+            have--;
+        }
+        request[have++] = c;
+
+        if (have == sizeof(request) && sys_get_le32(&request[0]) == EXPORT_REQUEST_MAGIC &&
+            sys_get_le32(&request[8]) == app_crc32_update(0, request, 8)) {
+            export_run(sys_get_le32(&request[4]));
+            have = 0;
+        }
+    }
+}
+K_THREAD_DEFINE(export_tid, EXPORT_STACK_SIZE, export_thread, NULL, NULL, NULL,
+                CONFIG_APP_EXPORT_PRIORITY, 0, SYS_FOREVER_MS);
+
+//  ========== export_tx_thread ============================================================
+// one priority below the reader: a freed buffer is refilled before transmission goes on
+static void export_tx_thread(void *p1, void *p2, void *p3)
+{
+    struct export_chunk chunk;
+
+    while (1) {
+        k_msgq_get(&export_filled, &chunk, K_FOREVER);
+        for (uint16_t i = 0; i < chunk.length; i++) {
+            uart_poll_out(export_uart, export_buffer[chunk.index][i]);
+        }
+        k_sem_give(&export_free);
+    }
+}
+K_THREAD_DEFINE(export_tx_tid, EXPORT_STACK_SIZE, export_tx_thread, NULL, NULL, NULL,
+                CONFIG_APP_EXPORT_PRIORITY + 1, 0, SYS_FOREVER_MS);
+
+//  ========== app_export_start ============================================================
+// the threads wait for the record log to be recovered
+void app_export_start(void)
+{
+    k_thread_start(export_tx_tid);
+    k_thread_start(export_tid);
+}
+
+//  ========== app_export_get_stats ========================================================
+void app_export_get_stats(struct app_export_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&export_lock);
+    *stats = export_stats;
+    k_spin_unlock(&export_lock, key);
+}
+
+#endif /* CONFIG_APP_EXPORT */
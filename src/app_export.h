@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_EXPORT_H
+#define APP_EXPORT_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+//  ========== defines =====================================================================
+// all fields little-endian. the host asks for the records from a sequence number on:
+//   request: magic, u32 first record, CRC-32 of the 8 bytes before
+// and receives one frame per record, then an end frame giving the sequence number to
+// resume from:
+//   frame:   magic, u8 type, u8 flags, u16 length, u32 seq, u64 time_ms, payload,
+//            CRC-32 of header and payload
+// a record frame whose seq does not follow the previous one (or the requested one) without
+// EXPORT_FLAG_GAP was lost on the line
+#define EXPORT_REQUEST_MAGIC        0x52585336      // "6SXR"
+#define EXPORT_REQUEST_SIZE         12
+#define EXPORT_FRAME_MAGIC          0x46585336      // "6SXF"
+#define EXPORT_FRAME_HDR_SIZE       20
+#define EXPORT_FRAME_CRC_SIZE       4
+
+#define EXPORT_FRAME_RECORD         1               // one record of the log
+#define EXPORT_FRAME_END            2               // end of the log, seq to resume from
+
+// record frame flags
+#define EXPORT_FLAG_GAP             0x01            // records before this one left the log
+
+//  ========== types =======================================================================
+struct app_export_stats {
+    uint32_t exports;           // requests served
+    uint32_t records;           // records sent, all requests
+    uint32_t skipped;           // records larger than an export buffer
+    uint64_t bytes;             // bytes sent, framing included
+    uint32_t last_ms;           // duration of the last export
+    uint32_t last_bytes_per_s;  // throughput of the last export
+};
+
+//  ========== prototypes ==================================================================
+void app_export_start(void);
+void app_export_get_stats(struct app_export_stats *stats);
+
+#endif /* APP_EXPORT_H */
@@ -0,0 +1,949 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_flash_log.h"
+#include "app_flash_wbuf.h"
+#include "app_crc32.h"
+#include "app_housekeeping.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_flash_log, CONFIG_APP_STORAGE_LOG_LEVEL);
+
+//  ========== types =======================================================================
+struct flash_log_sector_hdr {
+    uint32_t magic;
+    uint32_t seq;
+    uint32_t record_seq;        // sequence number of the first record of the sector
+    uint64_t time_ms;           // timestamp of that record, never below the previous sector's
+} __packed;
+
+struct flash_log_record_hdr {
+    uint16_t length;
+    uint16_t length_inv;        // ~length, detects a header torn by a power cut
+    uint32_t seq;               // record sequence number, +1 per append
+    uint64_t time_ms;           // timestamp given to app_flash_log_append()
+    uint32_t crc;               // CRC-32 of the fields above and of the payload
+} __packed;
+
+BUILD_ASSERT(sizeof(struct flash_log_sector_hdr) == FLASH_LOG_SECTOR_HDR_SIZE);
+BUILD_ASSERT(sizeof(struct flash_log_record_hdr) == FLASH_LOG_RECORD_HDR_SIZE);
+BUILD_ASSERT((FLASH_LOG_OFFSET % FLASH_LOG_SECTOR_SIZE) == 0);
+BUILD_ASSERT((FLASH_LOG_SIZE % FLASH_LOG_SECTOR_SIZE) == 0 && FLASH_LOG_SECTOR_NB >= 2);
+
+//  ========== defines =====================================================================
+#define FLASH_LOG_BLANK_CHUNK       64      // bytes per read of the blank check
+#define FLASH_LOG_KEY_SKEW_S        CONFIG_APP_FLASH_LOG_KEY_SKEW_S
+
+//  ========== globals =====================================================================
+static struct {
+    uint32_t head_sector;
+    uint32_t head_offset;
+    uint32_t head_seq;
+    uint32_t tail_sector;
+    uint32_t tail_seq;
+    uint32_t used_sectors;
+    uint32_t records;
+    uint32_t record_seq;        // sequence number of the next record
+    uint32_t corrupt;
+    uint32_t scan_us;
+    uint32_t ready;             // erased sectors following the head
+    uint32_t erase_stalls;
+    uint32_t erase_deferred;
+    uint64_t last_ms;           // latest record timestamp
+} flog;
+
+// erase-ahead worker, on the housekeeping queue
+static struct {
+    struct k_work_delayable work;
+    app_flash_log_busy_t busy;
+    uint32_t target;            // erased sectors to keep ahead of the head
+    uint32_t sector;            // sector being erased, valid while running
+    bool running;
+    bool mounted;               // set by the first init
+} flog_erase;
+
+// sparse time index: first record time of each sector, in seconds, by physical sector.
+// sorted from the tail to the head, the records of a sector are no later than the first
+// record of the next one. 4 bytes per sector, 8 KB for the whole MX25R64
+static uint32_t flog_index[FLASH_LOG_SECTOR_NB];
+
+static struct k_mutex flog_mutex;
+K_CONDVAR_DEFINE(flog_erase_done);
+
+//  ========== flash_log_addr ==============================================================
+static inline off_t flash_log_addr(uint32_t sector, uint32_t offset)
+{
+    return FLASH_LOG_OFFSET + ((off_t)sector * FLASH_LOG_SECTOR_SIZE) + offset;
+}
+
+//  ========== flash_log_record_span =======================================================
+// records are padded to 4 bytes so headers stay word aligned for the QSPI peripheral
+static inline uint32_t flash_log_record_span(uint32_t length)
+{
+    return ROUND_UP(FLASH_LOG_RECORD_HDR_SIZE + length, 4);
+}
+
+//  ========== flash_log_seq_before ========================================================
+static inline bool flash_log_seq_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+//  ========== flash_log_index_key =========================================================
+static inline uint32_t flash_log_index_key(uint64_t time_ms)
+{
+    return (uint32_t)MIN(time_ms / MSEC_PER_SEC, UINT32_MAX);
+}
+
+//  ========== flash_log_read_sector_hdr ===================================================
+// returns true if the sector carries a valid log header; sectors of an older format
+// have another magic and count as stale
+static bool flash_log_read_sector_hdr(uint32_t sector, struct flash_log_sector_hdr *hdr)
+{
+    if (app_flash_wbuf_read(flash_log_addr(sector, 0), hdr, sizeof(*hdr)) != 0) {
+        return false;
+    }
+    return hdr->magic == FLASH_LOG_SECTOR_MAGIC;
+}
+
+//  ========== flash_log_read_record_hdr ===================================================
+// returns 1 for a valid record, 0 for erased space, -EBADMSG for a torn header
+static int flash_log_read_record_hdr(uint32_t sector, uint32_t offset,
+                                     struct flash_log_record_hdr *hdr)
+{
+    if (offset + FLASH_LOG_RECORD_HDR_SIZE > FLASH_LOG_SECTOR_SIZE) {
+        return 0;
+    }
+    if (app_flash_wbuf_read(flash_log_addr(sector, offset), hdr, sizeof(*hdr)) != 0) {
+        return -EIO;
+    }
+    if (hdr->length == 0xFFFF && hdr->length_inv == 0xFFFF) {
+        return 0;
+    }
+    if ((uint16_t)~hdr->length != hdr->length_inv || hdr->length == 0 ||
+        offset + flash_log_record_span(hdr->length) > FLASH_LOG_SECTOR_SIZE) {
+        return -EBADMSG;
+    }
+    return 1;
+}
+
+//  ========== flash_log_record_crc ========================================================
+// CRC of the header fields, to be continued over the payload
+static inline uint32_t flash_log_record_crc(const struct flash_log_record_hdr *hdr)
+{
+    return app_crc32_update(0, hdr, offsetof(struct flash_log_record_hdr, crc));
+}
+
+//  ========== flash_log_check_record ======================================================
+// verify the payload of a record straight from the flash, in small chunks so the whole
+// record never needs a buffer. 0 when it matches, -EBADMSG otherwise
+static int flash_log_check_record(uint32_t sector, uint32_t offset,
+                                  const struct flash_log_record_hdr *hdr)
+{
+    uint8_t chunk[64];
+    off_t addr = flash_log_addr(sector, offset) + FLASH_LOG_RECORD_HDR_SIZE;
+    uint32_t crc = flash_log_record_crc(hdr);
+
+    for (uint16_t done = 0; done < hdr->length;) {
+        uint16_t n = MIN(hdr->length - done, sizeof(chunk));
+        if (app_flash_wbuf_read(addr + done, chunk, n) != 0) {
+            return -EIO;
+        }
+        crc = app_crc32_update(crc, chunk, n);
+        done += n;
+    }
+    return (crc == hdr->crc) ? 0 : -EBADMSG;
+}
+
+//  ========== flash_log_erase_sector ======================================================
+static int flash_log_erase_sector(uint32_t sector)
+{
+    int ret = app_flash_wbuf_erase(flash_log_addr(sector, 0), FLASH_LOG_SECTOR_SIZE);
+    if (ret != 0) {
+        LOG_ERR("failed to erase log sector %u. error: %d", sector, ret);
+    }
+    return ret;
+}
+
+//  ========== flash_log_forget_tail =======================================================
+static void flash_log_forget_tail(void)
+{
+    flog.tail_sector = (flog.tail_sector + 1) % FLASH_LOG_SECTOR_NB;
+    flog.tail_seq++;
+    flog.used_sectors--;
+}
+
+//  ========== flash_log_drop_tail =========================================================
+// a page program clearing the magic releases the sector for the boot scan; the erase is
+// left to the worker, or to the append path once the head gets there
+static int flash_log_drop_tail(void)
+{
+    const uint32_t stale = 0;
+
+    int ret = app_flash_wbuf_write(flash_log_addr(flog.tail_sector, 0), &stale, sizeof(stale));
+    if (ret != 0) {
+        LOG_ERR("failed to release log sector %u. error: %d", flog.tail_sector, ret);
+        return ret;
+    }
+    flash_log_forget_tail();
+    return 0;
+}
+
+//  ========== flash_log_is_blank ==========================================================
+// a sector the previous boot already erased ahead is not erased a second time
+static bool flash_log_is_blank(uint32_t sector)
+{
+    uint32_t chunk[FLASH_LOG_BLANK_CHUNK / sizeof(uint32_t)];
+
+    for (uint32_t offset = 0; offset < FLASH_LOG_SECTOR_SIZE; offset += sizeof(chunk)) {
+        if (app_flash_wbuf_read(flash_log_addr(sector, offset), chunk, sizeof(chunk)) != 0) {
+            return false;
+        }
+        for (size_t i = 0; i < ARRAY_SIZE(chunk); i++) {
+            if (chunk[i] != 0xFFFFFFFF) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//  ========== flash_log_kick_erase ========================================================
+// caller holds the mutex
+static void flash_log_kick_erase(void)
+{
+    if (flog_erase.target > flog.ready && !flog_erase.running) {
+        (void)k_work_schedule_for_queue(app_housekeeping_queue(), &flog_erase.work, K_NO_WAIT);
+    }
+}
+
+//  ========== flash_log_erase_next ========================================================
+// caller holds the mutex. picks the sector following the ready ones; in overwrite mode
+// the oldest sector is released early to make room for it
+static bool flash_log_erase_next(uint32_t *sector)
+{
+    if (flog.ready >= flog_erase.target) {
+        return false;
+    }
+    if (flog.used_sectors + flog.ready >= FLASH_LOG_SECTOR_NB) {
+        if (!IS_ENABLED(CONFIG_APP_FLASH_LOG_OVERWRITE) || flog.used_sectors <= 1) {
+            return false;
+        }
+        // erased right after, not worth invalidating first
+        flash_log_forget_tail();
+    }
+    *sector = (flog.head_sector + 1 + flog.ready) % FLASH_LOG_SECTOR_NB;
+    return true;
+}
+
+//  ========== flash_log_erase_handler =====================================================
+// one sector per pass, without the mutex during the erase: appends go on meanwhile, the
+// page buffer holds what they write until the flash is available again
+static void flash_log_erase_handler(struct k_work *work)
+{
+    uint32_t sector;
+    int ret = 0;
+
+    if (flog_erase.busy && flog_erase.busy()) {
+        k_mutex_lock(&flog_mutex, K_FOREVER);
+        flog.erase_deferred++;
+        k_mutex_unlock(&flog_mutex);
+        (void)k_work_reschedule_for_queue(app_housekeeping_queue(), &flog_erase.work,
+                                          K_MSEC(CONFIG_APP_FLASH_LOG_ERASE_DEFER_MS));
+        return;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    if (!flash_log_erase_next(&sector)) {
+        k_mutex_unlock(&flog_mutex);
+        return;
+    }
+    flog_erase.sector = sector;
+    flog_erase.running = true;
+    k_mutex_unlock(&flog_mutex);
+
+    if (!flash_log_is_blank(sector)) {
+        ret = flash_log_erase_sector(sector);
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    flog_erase.running = false;
+    // the head may have reached the sector meanwhile, or the log been cleared
+    if (ret == 0 && sector == (flog.head_sector + 1 + flog.ready) % FLASH_LOG_SECTOR_NB &&
+        flog.used_sectors + flog.ready < FLASH_LOG_SECTOR_NB) {
+        flog.ready++;
+    }
+    k_condvar_broadcast(&flog_erase_done);
+    if (ret == 0) {
+        flash_log_kick_erase();
+    }
+    k_mutex_unlock(&flog_mutex);
+}
+
+//  ========== flash_log_open_next =========================================================
+// stamp the sector after the head with the next sequence number and the time of its
+// first record, erasing it first unless the worker already did. a clock stepped
+// backwards cannot unsort the index, the sector then keeps the latest time already logged
+static int flash_log_open_next(uint64_t time_ms)
+{
+    uint32_t next = (flog.head_sector + 1) % FLASH_LOG_SECTOR_NB;
+    struct flash_log_sector_hdr hdr = {
+        .magic = FLASH_LOG_SECTOR_MAGIC,
+        .seq = flog.head_seq + 1,
+        .record_seq = flog.record_seq,
+        .time_ms = MAX(time_ms, flog.last_ms),
+    };
+    bool stalled = false;
+    int ret;
+
+    // the head caught up with the worker
+    while (flog_erase.running && flog_erase.sector == next) {
+        stalled = true;
+        k_condvar_wait(&flog_erase_done, &flog_mutex, K_FOREVER);
+    }
+
+    if (flog.ready > 0) {
+        flog.ready--;
+    } else {
+        if (flog.used_sectors == FLASH_LOG_SECTOR_NB) {
+            if (!IS_ENABLED(CONFIG_APP_FLASH_LOG_OVERWRITE)) {
+                return -ENOSPC;
+            }
+            ret = flash_log_drop_tail();
+            if (ret != 0) {
+                return ret;
+            }
+        }
+        stalled = (flog_erase.target > 0);
+        ret = flash_log_erase_sector(next);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    if (stalled) {
+        flog.erase_stalls++;
+    }
+    flash_log_kick_erase();
+    ret = app_flash_wbuf_write(flash_log_addr(next, 0), &hdr, sizeof(hdr));
+    if (ret != 0) {
+        LOG_ERR("failed to write log sector header. error: %d", ret);
+        // the sectors ahead are erased again before use
+        flog.ready = 0;
+        return ret;
+    }
+
+    flog.head_sector = next;
+    flog.head_seq = hdr.seq;
+    flog.head_offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    flog_index[next] = flash_log_index_key(hdr.time_ms);
+    if (flog.used_sectors++ == 0) {
+        flog.tail_sector = next;
+        flog.tail_seq = hdr.seq;
+    }
+    return 0;
+}
+
+//  ========== flash_log_scan ==============================================================
+// boot-time recovery: locate the newest sector, walk back over the contiguous run of
+// sequence numbers to find the tail, then replay the head sector to find the write offset.
+// the time index is rebuilt from the sector headers read on the way, without record reads.
+// the records of the head sector, the only one a power cut can have left half written,
+// are checked against their CRC; the other sectors are checked as they are read
+static int flash_log_scan(void)
+{
+    struct flash_log_sector_hdr sector_hdr;
+    struct flash_log_record_hdr hdr;
+    bool found = false;
+    int ret;
+
+    for (uint32_t sector = 0; sector < FLASH_LOG_SECTOR_NB; sector++) {
+        if (!flash_log_read_sector_hdr(sector, &sector_hdr)) {
+            continue;
+        }
+        flog_index[sector] = flash_log_index_key(sector_hdr.time_ms);
+        if (!found || flash_log_seq_before(flog.head_seq, sector_hdr.seq)) {
+            flog.head_sector = sector;
+            flog.head_seq = sector_hdr.seq;
+            flog.record_seq = sector_hdr.record_seq;
+            flog.last_ms = sector_hdr.time_ms;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        // empty log, the first append opens sector 0
+        flog.head_sector = FLASH_LOG_SECTOR_NB - 1;
+        flog.head_seq = 0;
+        flog.head_offset = FLASH_LOG_SECTOR_SIZE;
+        flog.used_sectors = 0;
+        return 0;
+    }
+
+    // sectors outside this run are stale (interrupted erase or trimmed) and get
+    // erased again when the head reaches them
+    flog.tail_sector = flog.head_sector;
+    flog.tail_seq = flog.head_seq;
+    flog.used_sectors = 1;
+    while (flog.used_sectors < FLASH_LOG_SECTOR_NB) {
+        uint32_t prev = (flog.tail_sector + FLASH_LOG_SECTOR_NB - 1) % FLASH_LOG_SECTOR_NB;
+        if (!flash_log_read_sector_hdr(prev, &sector_hdr) ||
+            sector_hdr.seq != flog.tail_seq - 1) {
+            break;
+        }
+        flog.tail_sector = prev;
+        flog.tail_seq = sector_hdr.seq;
+        flog.used_sectors++;
+    }
+
+    flog.head_offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    while ((ret = flash_log_read_record_hdr(flog.head_sector, flog.head_offset, &hdr)) == 1) {
+        // a payload cut short keeps its header, so the next append still goes after it
+        ret = flash_log_check_record(flog.head_sector, flog.head_offset, &hdr);
+        if (ret == -EBADMSG) {
+            LOG_WRN("corrupt record %u in log sector %u at 0x%X", hdr.seq,
+                    flog.head_sector, flog.head_offset);
+            flog.corrupt++;
+        } else if (ret < 0) {
+            return ret;
+        }
+        flog.record_seq = hdr.seq + 1;
+        flog.last_ms = MAX(flog.last_ms, hdr.time_ms);
+        flog.head_offset += flash_log_record_span(hdr.length);
+    }
+    if (ret == -EBADMSG) {
+        // a record header was torn by a power cut, close the sector
+        LOG_WRN("torn record in log sector %u at 0x%X, sector closed",
+               flog.head_sector, flog.head_offset);
+        flog.head_offset = FLASH_LOG_SECTOR_SIZE;
+    } else if (ret < 0) {
+        return ret;
+    }
+    return 0;
+}
+
+//  ========== app_flash_log_init ==========================================================
+int8_t app_flash_log_init(const struct device *dev)
+{
+    if (!device_is_ready(dev)) {
+        LOG_ERR("%s: device is not ready", dev->name);
+        return -ENODEV;
+    }
+
+    // a second init remounts the log as a reset would: the worker of the previous mount
+    // is stopped and erases nothing ahead until told again
+    if (flog_erase.mounted) {
+        struct k_work_sync sync;
+
+        (void)k_work_cancel_delayable_sync(&flog_erase.work, &sync);
+        flog_erase.target = 0;
+        flog_erase.busy = NULL;
+    }
+    flog_erase.mounted = true;
+
+    // every access goes through the page coalescing buffer
+    int ret = app_flash_wbuf_init(dev);
+    if (ret != 0) {
+        return ret;
+    }
+
+    k_mutex_init(&flog_mutex);
+    memset(&flog, 0, sizeof(flog));
+    k_work_init_delayable(&flog_erase.work, flash_log_erase_handler);
+
+    uint32_t start = k_cycle_get_32();
+    ret = flash_log_scan();
+    flog.scan_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+    if (ret != 0) {
+        LOG_ERR("record log scan failed. error: %d", ret);
+        return ret;
+    }
+
+    LOG_INF("record log: %u/%u sectors used, head %u @0x%X (seq %u), tail %u, scan %u us",
+           flog.used_sectors, FLASH_LOG_SECTOR_NB, flog.head_sector, flog.head_offset,
+           flog.head_seq, flog.tail_sector, flog.scan_us);
+    LOG_INF("next record %u, %u corrupt records in the head sector", flog.record_seq,
+            flog.corrupt);
+    return 0;
+}
+
+//  ========== app_flash_log_append ========================================================
+int8_t app_flash_log_append(const uint8_t *data, size_t length, uint64_t time_ms,
+                            struct app_flash_log_cursor *where)
+{
+    struct flash_log_record_hdr hdr;
+    int ret;
+
+    if (!data || length == 0 || length > FLASH_LOG_RECORD_MAX) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+
+    if (flog.used_sectors == 0 ||
+        flog.head_offset + flash_log_record_span(length) > FLASH_LOG_SECTOR_SIZE) {
+        ret = flash_log_open_next(time_ms);
+        if (ret != 0) {
+            goto out;
+        }
+    }
+
+    // header first: after a power cut during the payload the boot scan still steps over
+    // the partially programmed area instead of programming it a second time. the CRC is
+    // therefore computed up front, in one pass over the payload still in RAM
+    hdr.length = (uint16_t)length;
+    hdr.length_inv = (uint16_t)~length;
+    hdr.seq = flog.record_seq;
+    hdr.time_ms = time_ms;
+    hdr.crc = app_crc32_update(flash_log_record_crc(&hdr), data, length);
+    ret = app_flash_wbuf_write(flash_log_addr(flog.head_sector, flog.head_offset),
+                      &hdr, sizeof(hdr));
+    if (ret == 0) {
+        ret = app_flash_wbuf_write(flash_log_addr(flog.head_sector, flog.head_offset) +
+                          FLASH_LOG_RECORD_HDR_SIZE, data, length);
+    }
+    if (ret != 0) {
+        LOG_ERR("failed to append record. error: %d", ret);
+        // never reuse a partially programmed area
+        flog.head_offset = FLASH_LOG_SECTOR_SIZE;
+        goto out;
+    }
+
+    if (where) {
+        where->sector = flog.head_sector;
+        where->offset = flog.head_offset;
+        where->seq = flog.head_seq;
+        where->record_seq = hdr.seq;
+        where->time_ms = time_ms;
+    }
+    flog.head_offset += flash_log_record_span(length);
+    flog.last_ms = MAX(flog.last_ms, time_ms);
+    flog.record_seq++;
+    flog.records++;
+
+out:
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== flash_log_hdr_at ============================================================
+// caller holds the mutex; returns 1 with the header of the record at the cursor, 0 at the
+// end of the sector
+static int flash_log_hdr_at(const struct app_flash_log_cursor *cursor,
+                            struct flash_log_record_hdr *hdr)
+{
+    int ret;
+
+    if (flash_log_seq_before(cursor->seq, flog.tail_seq) ||
+        flash_log_seq_before(flog.head_seq, cursor->seq) || flog.used_sectors == 0) {
+        return -ENOENT;
+    }
+    if (cursor->seq == flog.head_seq && cursor->offset >= flog.head_offset) {
+        return 0;
+    }
+
+    ret = flash_log_read_record_hdr(cursor->sector, cursor->offset, hdr);
+    if (ret <= 0) {
+        // erased space or a torn header both end the sector
+        return (ret == -EIO) ? ret : 0;
+    }
+    return 1;
+}
+
+//  ========== flash_log_read_payload ======================================================
+// caller holds the mutex; returns 1 and the record length, -EBADMSG (with the length) for
+// a record whose payload does not match its CRC
+static int flash_log_read_payload(struct app_flash_log_cursor *cursor,
+                                  const struct flash_log_record_hdr *hdr, uint8_t *data,
+                                  size_t size, size_t *length)
+{
+    int ret;
+
+    *length = hdr->length;
+    cursor->record_seq = hdr->seq;
+    cursor->time_ms = hdr->time_ms;
+    if (hdr->length > size) {
+        return -ENOMEM;
+    }
+    ret = app_flash_wbuf_read(flash_log_addr(cursor->sector, cursor->offset) +
+                     FLASH_LOG_RECORD_HDR_SIZE, data, hdr->length);
+    if (ret != 0) {
+        return ret;
+    }
+
+    // verified only now, when the record is actually used
+    if (app_crc32_update(flash_log_record_crc(hdr), data, hdr->length) != hdr->crc) {
+        LOG_WRN("corrupt record %u in log sector %u at 0x%X", hdr->seq, cursor->sector,
+                cursor->offset);
+        flog.corrupt++;
+        return -EBADMSG;
+    }
+    return 1;
+}
+
+//  ========== flash_log_read_at ===========================================================
+// caller holds the mutex; returns 1 and the record length, 0 at the end of the sector,
+// -EBADMSG (with the length) for a corrupt record
+static int flash_log_read_at(struct app_flash_log_cursor *cursor, uint8_t *data,
+                             size_t size, size_t *length)
+{
+    struct flash_log_record_hdr hdr;
+    int ret = flash_log_hdr_at(cursor, &hdr);
+
+    if (ret <= 0) {
+        return ret;
+    }
+    return flash_log_read_payload(cursor, &hdr, data, size, length);
+}
+
+//  ========== app_flash_log_read ==========================================================
+// -EBADMSG if the record fails its CRC check
+int8_t app_flash_log_read(const struct app_flash_log_cursor *cursor, uint8_t *data, size_t size,
+                          size_t *length)
+{
+    struct app_flash_log_cursor at;
+
+    if (!cursor || !data || !length) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    at = *cursor;
+    int ret = flash_log_read_at(&at, data, size, length);
+    k_mutex_unlock(&flog_mutex);
+
+    if (ret == 0) {
+        return -ENOENT;
+    }
+    return (ret == 1) ? 0 : ret;
+}
+
+//  ========== app_flash_log_iter_init =====================================================
+// position the cursor on the oldest record
+int8_t app_flash_log_iter_init(struct app_flash_log_cursor *cursor)
+{
+    if (!cursor) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    cursor->sector = flog.tail_sector;
+    cursor->seq = flog.tail_seq;
+    cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    int ret = (flog.used_sectors == 0) ? -ENOENT : 0;
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== app_flash_log_iter_next =====================================================
+// copy the record at the cursor and advance; -ENOENT once the head is reached. corrupt
+// records are skipped, their header still gives the span to step over
+int8_t app_flash_log_iter_next(struct app_flash_log_cursor *cursor, uint8_t *data, size_t size,
+                               size_t *length)
+{
+    int ret;
+
+    if (!cursor || !data || !length) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+
+    // records trimmed under the cursor: resume from the new tail
+    if (flog.used_sectors != 0 && flash_log_seq_before(cursor->seq, flog.tail_seq)) {
+        cursor->sector = flog.tail_sector;
+        cursor->seq = flog.tail_seq;
+        cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    }
+
+    while ((ret = flash_log_read_at(cursor, data, size, length)) == 0 || ret == -EBADMSG) {
+        if (ret == -EBADMSG) {
+            cursor->offset += flash_log_record_span(*length);
+            continue;
+        }
+        if (cursor->seq == flog.head_seq) {
+            ret = -ENOENT;
+            break;
+        }
+        cursor->sector = (cursor->sector + 1) % FLASH_LOG_SECTOR_NB;
+        cursor->seq++;
+        cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    }
+
+    // skip an oversized record too, so a fixed-size reader cannot stall on it
+    if (ret == 1 || ret == -ENOMEM) {
+        cursor->offset += flash_log_record_span(*length);
+    }
+
+    k_mutex_unlock(&flog_mutex);
+    return (ret == 1) ? 0 : ret;
+}
+
+//  ========== app_flash_log_seek ==========================================================
+// position the cursor for app_flash_log_iter_next() on the first record numbered
+// record_seq or later: binary search of the sector headers, log2(sectors) reads, then a
+// walk over the record headers of one sector. -ENOENT if the log is empty
+int8_t app_flash_log_seek(struct app_flash_log_cursor *cursor, uint32_t record_seq)
+{
+    struct flash_log_sector_hdr sector_hdr;
+    struct flash_log_record_hdr hdr;
+    uint32_t lo = 0;
+    uint32_t hi;
+    int ret = 0;
+
+    if (!cursor) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    if (flog.used_sectors == 0) {
+        ret = -ENOENT;
+        goto out;
+    }
+
+    // lo: first sector, counted from the tail, starting after record_seq
+    hi = flog.used_sectors;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (!flash_log_read_sector_hdr((flog.tail_sector + mid) % FLASH_LOG_SECTOR_NB,
+                                       &sector_hdr)) {
+            ret = -EIO;
+            goto out;
+        }
+        if (flash_log_seq_before(record_seq, sector_hdr.record_seq)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    if (lo > 0) {
+        lo--;
+    }
+
+    cursor->sector = (flog.tail_sector + lo) % FLASH_LOG_SECTOR_NB;
+    cursor->seq = flog.tail_seq + lo;
+    cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    while ((ret = flash_log_hdr_at(cursor, &hdr)) == 1 &&
+           flash_log_seq_before(hdr.seq, record_seq)) {
+        cursor->offset += flash_log_record_span(hdr.length);
+    }
+    ret = (ret < 0) ? ret : 0;
+
+out:
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== app_flash_log_query_init ====================================================
+// binary search of the time index for the first sector that can hold a record of the
+// range, in RAM and in log2(sectors) steps however full the log is. -ENOENT if the log
+// is empty
+int8_t app_flash_log_query_init(struct app_flash_log_query *query, uint64_t from_ms,
+                                uint64_t to_ms)
+{
+    uint32_t from_s = flash_log_index_key(from_ms);
+    uint32_t lo = 0;
+    uint32_t hi;
+    int ret = 0;
+
+    if (!query || to_ms < from_ms) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    if (flog.used_sectors == 0) {
+        ret = -ENOENT;
+        goto out;
+    }
+
+    // lo: first sector, counted from the tail, starting at or after from_s
+    hi = flog.used_sectors;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (flog_index[(flog.tail_sector + mid) % FLASH_LOG_SECTOR_NB] < from_s) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // the range may begin in the sector before. the index is the running maximum of the
+    // record times, so no earlier sector holds a record of the range, even out of order
+    if (lo > 0) {
+        lo--;
+    }
+
+    query->cursor.sector = (flog.tail_sector + lo) % FLASH_LOG_SECTOR_NB;
+    query->cursor.seq = flog.tail_seq + lo;
+    query->cursor.offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    query->from_ms = from_ms;
+    query->to_ms = to_ms;
+
+out:
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== app_flash_log_query_next ====================================================
+// copy the next record of the range and advance; -ENOENT once the head or a sector
+// starting after the range is reached. records outside the range are stepped over on
+// their header alone, corrupt ones are skipped as in app_flash_log_iter_next()
+int8_t app_flash_log_query_next(struct app_flash_log_query *query, uint8_t *data, size_t size,
+                                size_t *length)
+{
+    struct app_flash_log_cursor *cursor;
+    struct flash_log_record_hdr hdr;
+    uint32_t to_s;
+    int ret;
+
+    if (!query || !data || !length) {
+        return -EINVAL;
+    }
+    cursor = &query->cursor;
+    // a sector is keyed by the latest time logged before it, its records may still be up to
+    // FLASH_LOG_KEY_SKEW_S older (see CONFIG_APP_FLASH_LOG_KEY_SKEW_S)
+    to_s = flash_log_index_key(query->to_ms);
+    to_s = (to_s > UINT32_MAX - FLASH_LOG_KEY_SKEW_S) ? UINT32_MAX : to_s + FLASH_LOG_KEY_SKEW_S;
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+
+    // records trimmed under the cursor: resume from the new tail
+    if (flog.used_sectors != 0 && flash_log_seq_before(cursor->seq, flog.tail_seq)) {
+        cursor->sector = flog.tail_sector;
+        cursor->seq = flog.tail_seq;
+        cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+    }
+
+    while (1) {
+        ret = flash_log_hdr_at(cursor, &hdr);
+        if (ret == 0) {
+            uint32_t next = (cursor->sector + 1) % FLASH_LOG_SECTOR_NB;
+            if (cursor->seq == flog.head_seq || flog_index[next] > to_s) {
+                ret = -ENOENT;
+                break;
+            }
+            cursor->sector = next;
+            cursor->seq++;
+            cursor->offset = FLASH_LOG_SECTOR_HDR_SIZE;
+            continue;
+        }
+        if (ret < 0) {
+            break;
+        }
+
+        if (hdr.time_ms < query->from_ms || hdr.time_ms > query->to_ms) {
+            cursor->offset += flash_log_record_span(hdr.length);
+            continue;
+        }
+        ret = flash_log_read_payload(cursor, &hdr, data, size, length);
+        if (ret == -EIO) {
+            break;
+        }
+        // an oversized record is skipped too, so a fixed-size reader cannot stall on it
+        cursor->offset += flash_log_record_span(hdr.length);
+        if (ret != -EBADMSG) {
+            break;
+        }
+    }
+
+    k_mutex_unlock(&flog_mutex);
+    return (ret == 1) ? 0 : ret;
+}
+
+//  ========== app_flash_log_trim ==========================================================
+// release every sector older than the one holding the cursor; once the cursor has
+// consumed the whole log, the head sector is released too
+int8_t app_flash_log_trim(const struct app_flash_log_cursor *upto)
+{
+    int ret = 0;
+
+    if (!upto) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+
+    while (flog.used_sectors > 1 && flash_log_seq_before(flog.tail_seq, upto->seq)) {
+        ret = flash_log_drop_tail();
+        if (ret != 0) {
+            goto out;
+        }
+    }
+
+    if (flog.used_sectors == 1 && upto->seq == flog.head_seq &&
+        upto->offset >= flog.head_offset) {
+        ret = flash_log_drop_tail();
+        if (ret == 0) {
+            // the next append opens the following sector, spreading wear
+            flog.head_offset = FLASH_LOG_SECTOR_SIZE;
+        }
+    }
+
+out:
+    // released sectors leave room to erase ahead
+    flash_log_kick_erase();
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== app_flash_log_clear =========================================================
+int8_t app_flash_log_clear(void)
+{
+    int ret = 0;
+
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    while (flog.used_sectors > 0 && ret == 0) {
+        ret = flash_log_drop_tail();
+    }
+    flog.head_offset = FLASH_LOG_SECTOR_SIZE;
+    flash_log_kick_erase();
+    k_mutex_unlock(&flog_mutex);
+    return ret;
+}
+
+//  ========== app_flash_log_sync ==========================================================
+// push records still held in the page buffer to the flash
+int8_t app_flash_log_sync(void)
+{
+    return app_flash_wbuf_sync();
+}
+
+//  ========== app_flash_log_erase_ahead ===================================================
+// keep up to sectors erased ahead of the head, at least two sectors are left to the
+// records. busy, if any, is polled before each erase; while it returns true the worker
+// retries every CONFIG_APP_FLASH_LOG_ERASE_DEFER_MS. 0 erases on the append path again
+int8_t app_flash_log_erase_ahead(uint32_t sectors, app_flash_log_busy_t busy)
+{
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    flog_erase.target = MIN(sectors, FLASH_LOG_SECTOR_NB - 2);
+    flog_erase.busy = busy;
+    flog.ready = MIN(flog.ready, flog_erase.target);
+    flash_log_kick_erase();
+    k_mutex_unlock(&flog_mutex);
+    return 0;
+}
+
+//  ========== app_flash_log_get_info ======================================================
+void app_flash_log_get_info(struct app_flash_log_info *info)
+{
+    k_mutex_lock(&flog_mutex, K_FOREVER);
+    info->sectors = FLASH_LOG_SECTOR_NB;
+    info->used_sectors = flog.used_sectors;
+    info->head_sector = flog.head_sector;
+    info->head_offset = flog.head_offset;
+    info->tail_sector = flog.tail_sector;
+    info->head_seq = flog.head_seq;
+    info->records = flog.records;
+    info->next_record_seq = flog.record_seq;
+    info->corrupt = flog.corrupt;
+    info->scan_us = flog.scan_us;
+    info->ready_sectors = flog.ready;
+    info->erase_stalls = flog.erase_stalls;
+    info->erase_deferred = flog.erase_deferred;
+    info->last_ms = flog.last_ms;
+    k_mutex_unlock(&flog_mutex);
+}
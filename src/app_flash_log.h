@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FLASH_LOG_H
+#define APP_FLASH_LOG_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+
+//  ========== defines =====================================================================
+// append-only circular log over a partition of the MX25R64. Every 4 KB sector starts
+// with a sequence-numbered header; records never span two sectors. Each record carries
+// its own sequence number, a timestamp and a CRC-32, checked when it is read back. The
+// time of the first record of each sector is kept in RAM as a sparse index for range
+// queries, record timestamps are expected not to go backwards. Released sectors are only
+// invalidated; the sectors ahead of the head are erased in the background, so that an
+// append does not wait for a 4 KB erase.
+#define FLASH_LOG_OFFSET            CONFIG_APP_FLASH_LOG_OFFSET
+#define FLASH_LOG_SIZE              CONFIG_APP_FLASH_LOG_SIZE
+#define FLASH_LOG_SECTOR_SIZE       4096
+#define FLASH_LOG_SECTOR_NB         (FLASH_LOG_SIZE / FLASH_LOG_SECTOR_SIZE)
+#define FLASH_LOG_SECTOR_MAGIC      0x36534C33      // "6SL3", timestamped records
+#define FLASH_LOG_SECTOR_HDR_SIZE   20              // magic + sequence + first record + time
+#define FLASH_LOG_RECORD_HDR_SIZE   20              // length + inverted length + seq + time + CRC
+#define FLASH_LOG_RECORD_MAX        (FLASH_LOG_SECTOR_SIZE - FLASH_LOG_SECTOR_HDR_SIZE - \
+                                     FLASH_LOG_RECORD_HDR_SIZE)
+
+//  ========== types =======================================================================
+// tells the erase-ahead worker to leave the flash to the writer for now
+typedef bool (*app_flash_log_busy_t)(void);
+
+// position of a record in the log, stays valid until its sector is trimmed
+struct app_flash_log_cursor {
+    uint32_t sector;            // sector index inside the partition
+    uint32_t offset;            // byte offset of the record header inside the sector
+    uint32_t seq;               // sequence number of the sector
+    uint32_t record_seq;        // sequence number of the record last appended or read
+    uint64_t time_ms;           // timestamp of the record last appended or read
+};
+
+// range query over the record timestamps, bounds included
+struct app_flash_log_query {
+    struct app_flash_log_cursor cursor;
+    uint64_t from_ms;
+    uint64_t to_ms;
+};
+
+struct app_flash_log_info {
+    uint32_t sectors;           // sectors in the partition
+    uint32_t used_sectors;      // sectors between tail and head, inclusive
+    uint32_t head_sector;       // sector currently being written
+    uint32_t head_offset;       // next write offset in the head sector
+    uint32_t tail_sector;       // oldest sector holding records
+    uint32_t head_seq;          // sequence number of the head sector
+    uint32_t records;           // records appended since boot
+    uint32_t next_record_seq;   // sequence number of the next record
+    uint32_t corrupt;           // records skipped on a CRC mismatch since boot
+    uint32_t scan_us;           // duration of the boot-time head/tail scan
+    uint32_t ready_sectors;     // sectors erased ahead of the head
+    uint32_t erase_stalls;      // sectors opened with an erase on the append path
+    uint32_t erase_deferred;    // erase-ahead passes put off while the writer was busy
+    uint64_t last_ms;           // latest record timestamp
+};
+
+//  ========== prototypes ==================================================================
+int8_t app_flash_log_init(const struct device *dev);
+int8_t app_flash_log_append(const uint8_t *data, size_t length, uint64_t time_ms,
+                            struct app_flash_log_cursor *where);
+int8_t app_flash_log_read(const struct app_flash_log_cursor *cursor, uint8_t *data, size_t size,
+                          size_t *length);
+int8_t app_flash_log_iter_init(struct app_flash_log_cursor *cursor);
+int8_t app_flash_log_iter_next(struct app_flash_log_cursor *cursor, uint8_t *data, size_t size,
+                               size_t *length);
+int8_t app_flash_log_seek(struct app_flash_log_cursor *cursor, uint32_t record_seq);
+int8_t app_flash_log_query_init(struct app_flash_log_query *query, uint64_t from_ms,
+                                uint64_t to_ms);
+int8_t app_flash_log_query_next(struct app_flash_log_query *query, uint8_t *data, size_t size,
+                                size_t *length);
+int8_t app_flash_log_trim(const struct app_flash_log_cursor *upto);
+int8_t app_flash_log_clear(void);
+int8_t app_flash_log_sync(void);
+int8_t app_flash_log_erase_ahead(uint32_t sectors, app_flash_log_busy_t busy);
+void app_flash_log_get_info(struct app_flash_log_info *info);
+
+#endif /* APP_FLASH_LOG_H */
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_flash_wbuf.h"
+#include "app_housekeeping.h"
+#include "app_probe.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_flash_wbuf, CONFIG_APP_STORAGE_LOG_LEVEL);
+
+BUILD_ASSERT(IS_POWER_OF_TWO(FLASH_WBUF_PAGE_SIZE));
+
+//  ========== types =======================================================================
+struct flash_wbuf_page {
+    off_t page;
+    uint8_t data[FLASH_WBUF_PAGE_SIZE] __aligned(4);
+};
+
+//  ========== globals =====================================================================
+// single page buffer: RAM footprint is bounded to one program page
+static struct {
+    const struct device *dev;
+    off_t page;                 // base address of the buffered page, -1 when none
+    uint16_t lo;                // pending range [lo, hi) not yet programmed
+    uint16_t hi;
+    uint16_t filled;            // payload bytes inside the pending range
+    uint8_t erasing;            // erases running outside the mutex
+    uint8_t held;               // whole pages in wbuf_held, programmed after the erase
+    uint8_t data[FLASH_WBUF_PAGE_SIZE] __aligned(4);
+} wbuf = { .page = -1 };
+
+// a NOR part neither programs nor reads while it erases: whole pages are held here
+// instead of blocking the writer in the driver until the erase is over
+static struct flash_wbuf_page wbuf_held[MAX(FLASH_WBUF_HELD_PAGES, 1)];
+
+static struct app_flash_wbuf_stats wbuf_stats;
+static uint64_t wbuf_flush_us_total;
+static struct k_mutex wbuf_mutex;
+static struct k_work_delayable wbuf_flush_work;
+
+//  ========== flash_wbuf_account ==========================================================
+static void flash_wbuf_account(uint32_t start_cycles)
+{
+    uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - start_cycles);
+
+    wbuf_stats.pages_programmed++;
+    wbuf_flush_us_total += us;
+    if (wbuf_stats.flush_us_min == 0 || us < wbuf_stats.flush_us_min) {
+        wbuf_stats.flush_us_min = us;
+    }
+    if (us > wbuf_stats.flush_us_max) {
+        wbuf_stats.flush_us_max = us;
+    }
+}
+
+//  ========== flash_wbuf_program ==========================================================
+// caller holds the mutex. programming only clears bits, so a page held during an erase
+// and programmed after later ones still ends up with the same content
+static int flash_wbuf_program(off_t page, const uint8_t *data)
+{
+    int ret;
+
+    if (wbuf.erasing) {
+        if (wbuf.held < FLASH_WBUF_HELD_PAGES) {
+            wbuf_held[wbuf.held].page = page;
+            memcpy(wbuf_held[wbuf.held].data, data, FLASH_WBUF_PAGE_SIZE);
+            wbuf.held++;
+            wbuf_stats.held_pages++;
+            wbuf_stats.held_max = MAX(wbuf_stats.held_max, wbuf.held);
+            return 0;
+        }
+        // the driver waits for the end of the erase
+        wbuf_stats.erase_waits++;
+    }
+
+    uint32_t start = k_cycle_get_32();
+    ret = APP_PROBE(PROBE_FLASH_WRITE, flash_write(wbuf.dev, page, data, FLASH_WBUF_PAGE_SIZE));
+    if (ret != 0) {
+        LOG_ERR("failed to program flash page 0x%lX. error: %d", (long)page, ret);
+        return ret;
+    }
+    flash_wbuf_account(start);
+    return 0;
+}
+
+//  ========== flash_wbuf_program_held =====================================================
+// caller holds the mutex, once the last erase is over
+static int flash_wbuf_program_held(void)
+{
+    uint8_t held = wbuf.held;
+    int ret = 0;
+
+    wbuf.held = 0;
+    for (uint8_t i = 0; i < held; i++) {
+        int err = flash_wbuf_program(wbuf_held[i].page, wbuf_held[i].data);
+        ret = (ret != 0) ? ret : err;
+    }
+    return ret;
+}
+
+//  ========== flash_wbuf_drop_held ========================================================
+// held pages inside an erased range are obsolete
+static void flash_wbuf_drop_held(off_t addr, size_t size)
+{
+    uint8_t kept = 0;
+
+    for (uint8_t i = 0; i < wbuf.held; i++) {
+        if (wbuf_held[i].page < addr || wbuf_held[i].page >= addr + (off_t)size) {
+            if (kept != i) {
+                wbuf_held[kept] = wbuf_held[i];
+            }
+            kept++;
+        }
+    }
+    wbuf.held = kept;
+}
+
+//  ========== flash_wbuf_flush ============================================================
+// program the buffered page as a whole; the untouched bytes are 0xFF, which leaves
+// erased cells and already programmed cells unchanged on NOR flash
+static int flash_wbuf_flush(void)
+{
+    int ret;
+
+    if (wbuf.page < 0 || wbuf.filled == 0) {
+        return 0;
+    }
+
+    ret = flash_wbuf_program(wbuf.page, wbuf.data);
+    if (ret != 0) {
+        wbuf.page = -1;
+        wbuf.filled = 0;
+        return ret;
+    }
+    wbuf_stats.bytes_padded += FLASH_WBUF_PAGE_SIZE - wbuf.filled;
+
+    if (wbuf.hi == FLASH_WBUF_PAGE_SIZE) {
+        wbuf.page = -1;
+    } else {
+        // keep the page open so later appends land in the same program page
+        memset(&wbuf.data[wbuf.lo], 0xFF, wbuf.hi - wbuf.lo);
+        wbuf.lo = wbuf.hi;
+    }
+    wbuf.filled = 0;
+    return 0;
+}
+
+//  ========== flash_wbuf_flush_work =======================================================
+static void flash_wbuf_flush_work(struct k_work *work)
+{
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    if (wbuf.filled != 0 && flash_wbuf_flush() == 0) {
+        wbuf_stats.timeout_flushes++;
+    }
+    k_mutex_unlock(&wbuf_mutex);
+}
+
+//  ========== app_flash_wbuf_init =========================================================
+int8_t app_flash_wbuf_init(const struct device *dev)
+{
+    if (!device_is_ready(dev)) {
+        LOG_ERR("%s: device is not ready", dev->name);
+        return -ENODEV;
+    }
+
+    // initialized again: what the RAM page and the held pages still had is lost, as
+    // over a reset
+    if (wbuf.dev) {
+        struct k_work_sync sync;
+
+        (void)k_work_cancel_delayable_sync(&wbuf_flush_work, &sync);
+    }
+
+    k_mutex_init(&wbuf_mutex);
+    k_work_init_delayable(&wbuf_flush_work, flash_wbuf_flush_work);
+    wbuf.dev = dev;
+    wbuf.page = -1;
+    wbuf.filled = 0;
+    wbuf.held = 0;
+    app_flash_wbuf_reset_stats();
+    return 0;
+}
+
+//  ========== app_flash_wbuf_write ========================================================
+int8_t app_flash_wbuf_write(off_t addr, const void *data, size_t length)
+{
+    const uint8_t *src = data;
+    int ret = 0;
+
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+
+    while (length > 0) {
+        off_t page = addr & ~((off_t)FLASH_WBUF_PAGE_SIZE - 1);
+        uint16_t off = (uint16_t)(addr - page);
+        size_t chunk = MIN((size_t)(FLASH_WBUF_PAGE_SIZE - off), length);
+
+        // a different page, or a rewind inside the same one, closes the buffer
+        if (wbuf.page >= 0 && (wbuf.page != page || off < wbuf.hi)) {
+            ret = flash_wbuf_flush();
+            if (ret != 0) {
+                goto out;
+            }
+            wbuf.page = -1;
+        }
+
+        // whole aligned page: program straight from the caller, no copy
+        if (wbuf.page < 0 && chunk == FLASH_WBUF_PAGE_SIZE) {
+            ret = flash_wbuf_program(page, src);
+            if (ret != 0) {
+                goto out;
+            }
+            wbuf_stats.direct_pages++;
+        } else {
+            if (wbuf.page < 0) {
+                wbuf.page = page;
+                wbuf.lo = off;
+                wbuf.hi = off;
+                memset(wbuf.data, 0xFF, sizeof(wbuf.data));
+            }
+            if (wbuf.filled == 0) {
+                wbuf.lo = off;
+            }
+            memcpy(&wbuf.data[off], src, chunk);
+            wbuf.hi = off + chunk;
+            wbuf.filled += chunk;
+
+            if (wbuf.hi == FLASH_WBUF_PAGE_SIZE) {
+                ret = flash_wbuf_flush();
+                if (ret != 0) {
+                    goto out;
+                }
+            }
+        }
+
+        wbuf_stats.bytes_written += chunk;
+        addr += chunk;
+        src += chunk;
+        length -= chunk;
+    }
+
+    // bound the time data can sit in RAM before it reaches the flash. the flush runs
+    // on the housekeeping queue, below the acquisition and storage threads
+    if (wbuf.filled != 0 && FLASH_WBUF_FLUSH_MS > 0) {
+        k_work_schedule_for_queue(app_housekeeping_queue(), &wbuf_flush_work,
+                                  K_MSEC(FLASH_WBUF_FLUSH_MS));
+    }
+
+out:
+    k_mutex_unlock(&wbuf_mutex);
+    return ret;
+}
+
+//  ========== app_flash_wbuf_read =========================================================
+// read-through: pending bytes still in RAM are merged over the flash content, held
+// pages the way programming them will
+int8_t app_flash_wbuf_read(off_t addr, void *data, size_t length)
+{
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+
+    int ret = APP_PROBE(PROBE_FLASH_READ, flash_read(wbuf.dev, addr, data, length));
+    for (uint8_t i = 0; ret == 0 && i < wbuf.held; i++) {
+        off_t lo = MAX(addr, wbuf_held[i].page);
+        off_t hi = MIN(addr + (off_t)length, wbuf_held[i].page + FLASH_WBUF_PAGE_SIZE);
+        for (off_t a = lo; a < hi; a++) {
+            ((uint8_t *)data)[a - addr] &= wbuf_held[i].data[a - wbuf_held[i].page];
+        }
+    }
+    if (ret == 0 && wbuf.page >= 0 && wbuf.filled != 0) {
+        off_t lo = MAX(addr, wbuf.page + wbuf.lo);
+        off_t hi = MIN(addr + (off_t)length, wbuf.page + wbuf.hi);
+        if (lo < hi) {
+            memcpy((uint8_t *)data + (lo - addr), &wbuf.data[lo - wbuf.page], hi - lo);
+        }
+    }
+
+    k_mutex_unlock(&wbuf_mutex);
+    return ret;
+}
+
+//  ========== app_flash_wbuf_erase ========================================================
+// pending data inside the erased range is obsolete and simply dropped. the erase runs
+// without the mutex: writes meanwhile fill the RAM page or are held as whole pages, up
+// to FLASH_WBUF_HELD_PAGES. nothing may be written inside the range being erased
+int8_t app_flash_wbuf_erase(off_t addr, size_t size)
+{
+    int ret, err;
+
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    if (wbuf.page >= addr && wbuf.page < addr + (off_t)size) {
+        wbuf.page = -1;
+        wbuf.filled = 0;
+    }
+    flash_wbuf_drop_held(addr, size);
+    wbuf.erasing++;
+    k_mutex_unlock(&wbuf_mutex);
+
+    ret = APP_PROBE(PROBE_FLASH_ERASE, flash_erase(wbuf.dev, addr, size));
+
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    if (--wbuf.erasing == 0) {
+        err = flash_wbuf_program_held();
+        ret = (ret != 0) ? ret : err;
+    }
+    k_mutex_unlock(&wbuf_mutex);
+    return ret;
+}
+
+//  ========== app_flash_wbuf_sync =========================================================
+int8_t app_flash_wbuf_sync(void)
+{
+    int ret = 0;
+
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    if (wbuf.filled != 0) {
+        ret = flash_wbuf_flush();
+        if (ret == 0) {
+            wbuf_stats.sync_flushes++;
+        }
+    }
+    k_mutex_unlock(&wbuf_mutex);
+    return ret;
+}
+
+//  ========== app_flash_wbuf_get_stats ====================================================
+void app_flash_wbuf_get_stats(struct app_flash_wbuf_stats *stats)
+{
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    *stats = wbuf_stats;
+    stats->flush_us_mean = (wbuf_stats.pages_programmed != 0) ?
+                           (uint32_t)(wbuf_flush_us_total / wbuf_stats.pages_programmed) : 0;
+    k_mutex_unlock(&wbuf_mutex);
+}
+
+//  ========== app_flash_wbuf_reset_stats ==================================================
+void app_flash_wbuf_reset_stats(void)
+{
+    k_mutex_lock(&wbuf_mutex, K_FOREVER);
+    memset(&wbuf_stats, 0, sizeof(wbuf_stats));
+    wbuf_flush_us_total = 0;
+    k_mutex_unlock(&wbuf_mutex);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_FLASH_WBUF_H
+#define APP_FLASH_WBUF_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/flash.h>
+
+//  ========== defines =====================================================================
+// write-coalescing layer in front of flash_write(): data is gathered in one RAM copy of
+// a NOR program page and only whole, aligned pages are programmed
+#define FLASH_WBUF_PAGE_SIZE        CONFIG_APP_FLASH_WBUF_PAGE_SIZE
+#define FLASH_WBUF_FLUSH_MS         CONFIG_APP_FLASH_WBUF_FLUSH_MS
+#define FLASH_WBUF_HELD_PAGES       CONFIG_APP_FLASH_WBUF_HELD_PAGES
+
+//  ========== types =======================================================================
+struct app_flash_wbuf_stats {
+    uint32_t pages_programmed;  // page program operations issued
+    uint32_t direct_pages;      // full pages written straight from the caller buffer
+    uint32_t bytes_written;     // payload bytes accepted from callers
+    uint32_t bytes_padded;      // 0xFF filler bytes programmed to complete pages
+    uint32_t sync_flushes;      // partial pages flushed by app_flash_wbuf_sync()
+    uint32_t timeout_flushes;   // partial pages flushed by the flush timeout
+    uint32_t flush_us_min;      // page program latency
+    uint32_t flush_us_max;
+    uint32_t flush_us_mean;
+    uint32_t held_pages;        // pages held in RAM while the part was erasing
+    uint32_t held_max;          // most pages held during one erase
+    uint32_t erase_waits;       // programs that found the part erasing and no room left
+};
+
+//  ========== prototypes ==================================================================
+int8_t app_flash_wbuf_init(const struct device *dev);
+int8_t app_flash_wbuf_write(off_t addr, const void *data, size_t length);
+int8_t app_flash_wbuf_read(off_t addr, void *data, size_t length);
+int8_t app_flash_wbuf_erase(off_t addr, size_t size);
+int8_t app_flash_wbuf_sync(void);
+void app_flash_wbuf_get_stats(struct app_flash_wbuf_stats *stats);
+void app_flash_wbuf_reset_stats(void);
+
+#endif /* APP_FLASH_WBUF_H */
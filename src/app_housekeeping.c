@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// lowest-priority work queue of the application: clock syncs and delayed flash flushes
+// run here, never on the system workqueue which preempts the acquisition thread
+#include "app_housekeeping.h"
+#include "app_clock.h"
+#include "app_ds3231.h"
+
+#include <zephyr/init.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_housekeeping, CONFIG_APP_LOG_LEVEL);
+
+//  ========== globals =====================================================================
+K_THREAD_STACK_DEFINE(hk_stack, CONFIG_APP_HOUSEKEEPING_STACK_SIZE);
+static struct k_work_q hk_queue;
+
+static struct k_work_delayable hk_sync_work;
+static const struct device *hk_ds3231_dev;
+static int64_t hk_sync_due_ms;
+
+static struct app_housekeeping_stats hk_stats;
+static struct k_spinlock hk_lock;
+
+//  ========== hk_sync_handler =============================================================
+// discipline the clock against the DS3231, the interval follows the drift estimate
+static void hk_sync_handler(struct k_work *work)
+{
+    int64_t late_ms = k_uptime_get() - hk_sync_due_ms;
+    uint32_t next_s;
+
+    (void)app_ds3231_periodic_sync(hk_ds3231_dev);
+
+    k_spinlock_key_t key = k_spin_lock(&hk_lock);
+    hk_stats.syncs++;
+    if (late_ms > HOUSEKEEPING_LATE_MS) {
+        hk_stats.late++;
+    }
+    hk_stats.late_ms_max = MAX(hk_stats.late_ms_max, (uint32_t)MAX(late_ms, 0));
+    k_spin_unlock(&hk_lock, key);
+
+    next_s = app_clock_next_sync_s();
+    hk_sync_due_ms = k_uptime_get() + ((int64_t)next_s * MSEC_PER_SEC);
+    (void)k_work_reschedule_for_queue(&hk_queue, &hk_sync_work, K_SECONDS(next_s));
+}
+
+//  ========== hk_init =====================================================================
+// started before main(), so the other modules can schedule work on it from their init
+static int hk_init(void)
+{
+    const struct k_work_queue_config config = {
+        .name = "housekeeping",
+    };
+
+    k_work_queue_init(&hk_queue);
+    k_work_queue_start(&hk_queue, hk_stack, K_THREAD_STACK_SIZEOF(hk_stack),
+                       CONFIG_APP_HOUSEKEEPING_PRIORITY, &config);
+    k_work_init_delayable(&hk_sync_work, hk_sync_handler);
+    return 0;
+}
+SYS_INIT(hk_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+//  ========== app_housekeeping_queue ======================================================
+struct k_work_q *app_housekeeping_queue(void)
+{
+    return &hk_queue;
+}
+
+//  ========== app_housekeeping_start_sync =================================================
+int8_t app_housekeeping_start_sync(const struct device *ds3231_dev)
+{
+    if (!ds3231_dev) {
+        return -EINVAL;
+    }
+    hk_ds3231_dev = ds3231_dev;
+
+    // the first sync runs at the shortest interval, then the discipline takes over
+    hk_sync_due_ms = k_uptime_get() + ((int64_t)app_clock_next_sync_s() * MSEC_PER_SEC);
+    (void)k_work_reschedule_for_queue(&hk_queue, &hk_sync_work,
+                                      K_SECONDS(app_clock_next_sync_s()));
+    LOG_INF("clock sync scheduled in %u s", app_clock_next_sync_s());
+    return 0;
+}
+
+//  ========== app_housekeeping_get_stats ==================================================
+void app_housekeeping_get_stats(struct app_housekeeping_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&hk_lock);
+    *stats = hk_stats;
+    k_spin_unlock(&hk_lock, key);
+}
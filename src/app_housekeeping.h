@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_HOUSEKEEPING_H
+#define APP_HOUSEKEEPING_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+
+//  ========== defines =====================================================================
+#define HOUSEKEEPING_LATE_MS        1000    // a job this late past its due time is reported
+
+//  ========== types =======================================================================
+struct app_housekeeping_stats {
+    uint32_t syncs;             // clock syncs against the DS3231
+    uint32_t late;              // syncs started more than HOUSEKEEPING_LATE_MS past due
+    uint32_t late_ms_max;       // worst delay of a sync past its due time
+};
+
+//  ========== prototypes ==================================================================
+struct k_work_q *app_housekeeping_queue(void);
+int8_t app_housekeeping_start_sync(const struct device *ds3231_dev);
+void app_housekeeping_get_stats(struct app_housekeeping_stats *stats);
+
+#endif /* APP_HOUSEKEEPING_H */
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// cycle-count probes around the driver calls, with a shell front-end
+#if defined(CONFIG_APP_PROBE)
+
+#include "app_probe.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+
+#if defined(CONFIG_APP_PROBE_SHELL)
+#include <zephyr/shell/shell.h>
+#endif
+
+//  ========== globals =====================================================================
+static const char *const probe_names[PROBE_COUNT] = {
+    [PROBE_ADC_READ] = "adc_read",
+    [PROBE_ADC_STREAM_PUT] = "adc_stream_put",
+    [PROBE_FLASH_WRITE] = "flash_write",
+    [PROBE_FLASH_READ] = "flash_read",
+    [PROBE_FLASH_ERASE] = "flash_erase",
+    [PROBE_I2C_READ] = "i2c_read",
+    [PROBE_I2C_WRITE] = "i2c_write",
+    [PROBE_RTC_READ] = "rtc_read",
+};
+
+// probes fire from threads and from the ADC callback, the spinlock covers both
+static struct app_probe_stats probes[PROBE_COUNT];
+static struct k_spinlock probe_lock;
+
+//  ========== probe_bucket ================================================================
+static inline uint8_t probe_bucket(uint32_t cycles)
+{
+    return (cycles == 0) ? 0 : (uint8_t)(32 - __builtin_clz(cycles));
+}
+
+//  ========== app_probe_record ============================================================
+void app_probe_record(enum app_probe_id id, uint32_t cycles)
+{
+    struct app_probe_stats *p;
+    k_spinlock_key_t key;
+
+    if (id >= PROBE_COUNT) {
+        return;
+    }
+    p = &probes[id];
+
+    key = k_spin_lock(&probe_lock);
+    if (p->count == 0 || cycles < p->min_cycles) {
+        p->min_cycles = cycles;
+    }
+    if (cycles > p->max_cycles) {
+        p->max_cycles = cycles;
+    }
+    p->count++;
+    p->total_cycles += cycles;
+    p->hist[MIN(probe_bucket(cycles), PROBE_BUCKETS - 1)]++;
+    k_spin_unlock(&probe_lock, key);
+}
+
+//  ========== app_probe_name ==============================================================
+const char *app_probe_name(enum app_probe_id id)
+{
+    return (id < PROBE_COUNT) ? probe_names[id] : NULL;
+}
+
+//  ========== app_probe_get ===============================================================
+int8_t app_probe_get(enum app_probe_id id, struct app_probe_stats *stats)
+{
+    k_spinlock_key_t key;
+
+    if (id >= PROBE_COUNT || !stats) {
+        return -EINVAL;
+    }
+    key = k_spin_lock(&probe_lock);
+    *stats = probes[id];
+    k_spin_unlock(&probe_lock, key);
+    return 0;
+}
+
+//  ========== app_probe_reset =============================================================
+void app_probe_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&probe_lock);
+    memset(probes, 0, sizeof(probes));
+    k_spin_unlock(&probe_lock, key);
+}
+
+//  ========== probe_line ==================================================================
+// one output line, to the shell that asked for it or to the console
+static void probe_line(const void *sh, const char *fmt, ...)
+{
+    char line[96];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+#if defined(CONFIG_APP_PROBE_SHELL)
+    if (sh) {
+        shell_print((const struct shell *)sh, "%s", line);
+        return;
+    }
+#endif
+    printk("%s\n", line);
+}
+
+//  ========== probe_us10 ==================================================================
+// cycles to tenths of microseconds, printed as "%u.%u"
+static inline uint32_t probe_us10(uint64_t cycles)
+{
+    return (uint32_t)(k_cyc_to_ns_floor64(cycles) / 100);
+}
+
+//  ========== probe_report ================================================================
+static void probe_report(const void *sh, int only)
+{
+    struct app_probe_stats s;
+
+    probe_line(sh, "%-14s %8s %9s %9s %9s", "probe", "count", "min us", "mean us", "max us");
+    for (int id = 0; id < PROBE_COUNT; id++) {
+        uint32_t min, mean, max;
+
+        if ((only >= 0 && id != only) || app_probe_get(id, &s) != 0) {
+            continue;
+        }
+        min = probe_us10(s.min_cycles);
+        mean = s.count ? probe_us10(s.total_cycles / s.count) : 0;
+        max = probe_us10(s.max_cycles);
+        probe_line(sh, "%-14s %8u %7u.%u %7u.%u %7u.%u", probe_names[id], s.count,
+                   min / 10, min % 10, mean / 10, mean % 10, max / 10, max % 10);
+
+        // histogram of a single probe only, one line per non-empty bucket
+        if (only < 0) {
+            continue;
+        }
+        for (int b = 0; b < PROBE_BUCKETS; b++) {
+            if (s.hist[b] == 0) {
+                continue;
+            }
+            uint32_t upper = probe_us10(1ULL << b);
+
+            probe_line(sh, "  < %7u.%u us %8u", upper / 10, upper % 10, s.hist[b]);
+        }
+    }
+}
+
+//  ========== app_probe_dump ==============================================================
+void app_probe_dump(void)
+{
+    probe_report(NULL, -1);
+}
+
+#if defined(CONFIG_APP_PROBE_SHELL)
+//  ========== shell commands ==============================================================
+static int cmd_probe_show(const struct shell *sh, size_t argc, char **argv)
+{
+    if (argc < 2) {
+        probe_report(sh, -1);
+        return 0;
+    }
+    for (int id = 0; id < PROBE_COUNT; id++) {
+        if (strcmp(argv[1], probe_names[id]) == 0) {
+            probe_report(sh, id);
+            return 0;
+        }
+    }
+    shell_error(sh, "unknown probe %s", argv[1]);
+    return -EINVAL;
+}
+
+static int cmd_probe_reset(const struct shell *sh, size_t argc, char **argv)
+{
+    app_probe_reset();
+    shell_print(sh, "probe statistics cleared");
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(probe_cmds,
+    SHELL_CMD_ARG(show, NULL, "show [probe]: statistics, with the histogram of one probe",
+                  cmd_probe_show, 1, 1),
+    SHELL_CMD(reset, NULL, "clear all probe statistics", cmd_probe_reset),
+    SHELL_SUBCMD_SET_END
+);
+SHELL_CMD_REGISTER(probe, &probe_cmds, "driver call timing probes", NULL);
+#endif /* CONFIG_APP_PROBE_SHELL */
+
+#endif /* CONFIG_APP_PROBE */
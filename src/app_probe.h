@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_PROBE_H
+#define APP_PROBE_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+//  ========== defines =====================================================================
+// log2 histogram: bucket b counts durations of [2^(b-1), 2^b) cycles, bucket 0 is 0
+#define PROBE_BUCKETS               32
+
+// time a driver call, APP_PROBE(PROBE_FLASH_WRITE, flash_write(...)) evaluates to the
+// return value of the call. disabled, the macros leave the bare call and nothing else
+#if defined(CONFIG_APP_PROBE)
+#define APP_PROBE(id, call)                                                     \
+    ({                                                                          \
+        uint32_t _probe_start = k_cycle_get_32();                               \
+        __typeof__(call) _probe_ret = (call);                                   \
+        app_probe_record((id), k_cycle_get_32() - _probe_start);                \
+        _probe_ret;                                                             \
+    })
+#define APP_PROBE_BEGIN(name)       uint32_t name = k_cycle_get_32()
+#define APP_PROBE_END(id, name)     app_probe_record((id), k_cycle_get_32() - (name))
+#else
+#define APP_PROBE(id, call)         (call)
+#define APP_PROBE_BEGIN(name)
+#define APP_PROBE_END(id, name)
+#endif
+
+//  ========== types =======================================================================
+enum app_probe_id {
+    PROBE_ADC_READ,             // one-shot adc_read()
+    PROBE_ADC_STREAM_PUT,       // block hand-off from the streaming thread
+    PROBE_FLASH_WRITE,
+    PROBE_FLASH_READ,
+    PROBE_FLASH_ERASE,
+    PROBE_I2C_READ,             // DS3231 register reads
+    PROBE_I2C_WRITE,
+    PROBE_RTC_READ,             // counter_get_value() on the on-board RTC
+    PROBE_COUNT,
+};
+
+struct app_probe_stats {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint32_t hist[PROBE_BUCKETS];
+};
+
+//  ========== prototypes ==================================================================
+#if defined(CONFIG_APP_PROBE)
+void app_probe_record(enum app_probe_id id, uint32_t cycles);
+const char *app_probe_name(enum app_probe_id id);
+int8_t app_probe_get(enum app_probe_id id, struct app_probe_stats *stats);
+void app_probe_reset(void);
+void app_probe_dump(void);
+#endif
+
+#endif /* APP_PROBE_H */
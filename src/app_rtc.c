@@ -7,166 +7,289 @@
 
 //  ========== includes ==============================================================================
 #include "app_rtc.h"
+#include "app_probe.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_rtc, CONFIG_APP_TIME_LOG_LEVEL);
+
+//  ========== types =================================================================================
+// fixed-point tick scale, value = ticks * whole + ticks * frac / 2^32. exact for the
+// power-of-two frequencies of the RTC, otherwise below one unit per 2^32 ticks
+struct rtc_scale {
+    uint32_t whole;
+    uint32_t frac;
+};
+
+// a counter extended to 64 bits. base and offsets are published through a seqlock so
+// that timestamps can be taken from ISRs and ADC callbacks without blocking, the rest is
+// set once by rtc_extend()
+struct rtc_counter {
+    struct app_seqlock lock;
+    uint64_t base;              // extended ticks at the last counter wrap
+    int64_t offset_us;          // RTC time minus the extended counter time
+    int64_t offset_ms;
+
+    const struct device *dev;
+    uint64_t period;            // ticks per counter wrap, top value + 1
+    struct rtc_scale to_us;
+    struct rtc_scale to_ms;
+};
 
 //  ========== globals ===============================================================================
-// global variable to track the offset between the system clock and RTC
-static int64_t system_rtc_offset_ms = 0;
-static struct k_mutex offset_mutex;
+// the RTC, extended by app_rtc_init()
+static struct rtc_counter rtc_ext;
+
+#if defined(CONFIG_APP_BENCH)
+// the counter of the benchmark, extended the same way
+static struct rtc_counter rtc_bench;
+#endif
+
+//  ========== rtc_scale_init ========================================================================
+// the only divisions, done once
+static struct rtc_scale rtc_scale_init(uint32_t units_per_s, uint32_t frequency)
+{
+    struct rtc_scale scale = {
+        .whole = units_per_s / frequency,
+        .frac = (uint32_t)(((uint64_t)(units_per_s % frequency) << 32) / frequency),
+    };
+    return scale;
+}
+
+//  ========== rtc_scale =============================================================================
+// 32x32 products only, no overflow for any 64-bit tick count the RTC can reach
+static inline uint64_t rtc_scale(uint64_t ticks, struct rtc_scale scale)
+{
+    return (ticks * scale.whole) + ((ticks >> 32) * scale.frac) +
+           (((ticks & UINT32_MAX) * scale.frac) >> 32);
+}
+
+//  ========== rtc_wrap_handler ======================================================================
+// counter top callback, once per wrap: 512 s for the 24-bit RTC at 32.768 kHz
+static void rtc_wrap_handler(const struct device *dev, void *user_data)
+{
+    struct rtc_counter *counter = user_data;
+
+    k_spinlock_key_t key = app_seqlock_write_begin(&counter->lock);
+    counter->base += counter->period;
+    app_seqlock_write_end(&counter->lock, key);
+}
+
+//  ========== rtc_offset_publish ====================================================================
+static void rtc_offset_publish(int64_t offset_us, int64_t offset_ms)
+{
+    k_spinlock_key_t key = app_seqlock_write_begin(&rtc_ext.lock);
+    rtc_ext.offset_us = offset_us;
+    rtc_ext.offset_ms = offset_ms;
+    app_seqlock_write_end(&rtc_ext.lock, key);
+}
+
+//  ========== rtc_read ==============================================================================
+// extended ticks and the offsets of the same snapshot
+static uint64_t rtc_read(struct rtc_counter *counter, int64_t *offset_us, int64_t *offset_ms)
+{
+    uint64_t base;
+    uint32_t ticks;
+    uint32_t seq;
+    bool pending;
+
+    do {
+        seq = app_seqlock_read_begin(&counter->lock);
+        base = counter->base;
+        *offset_us = counter->offset_us;
+        *offset_ms = counter->offset_ms;
+        (void)APP_PROBE(PROBE_RTC_READ, counter_get_value(counter->dev, &ticks));
+        // the counter wrapped but the callback has not run yet: interrupts are masked or
+        // the caller preempted it. read within the snapshot, a callback run between the
+        // two reads clears the flag but also forces the retry
+        pending = (ticks < (counter->period / 2)) &&
+                  (counter_get_pending_int(counter->dev) > 0);
+    } while (app_seqlock_read_retry(&counter->lock, seq));
+
+    return base + ticks + (pending ? counter->period : 0);
+}
+
+//  ========== rtc_extend ============================================================================
+// sets the top callback that extends dev into counter, then starts dev
+static int8_t rtc_extend(struct rtc_counter *counter, const struct device *dev)
+{
+    uint32_t top = counter_get_top_value(dev);
+    uint32_t frequency = counter_get_frequency(dev);
+    struct counter_top_cfg top_cfg = {
+        .ticks = top,
+        .callback = rtc_wrap_handler,
+        .user_data = counter,
+        .flags = COUNTER_TOP_CFG_DONT_RESET,
+    };
+
+    counter->period = (uint64_t)top + 1;
+    counter->to_us = rtc_scale_init(USEC_PER_SEC, frequency);
+    counter->to_ms = rtc_scale_init(MSEC_PER_SEC, frequency);
+
+    int8_t ret = counter_set_top_value(dev, &top_cfg);
+    if (ret < 0) {
+        // still usable until the first wrap
+        LOG_WRN("failed to set the RTC wrap callback, time not extended: %d", ret);
+    }
+
+    // start the counter
+    ret = counter_start(dev);
+    if (ret < 0) {
+        LOG_ERR("failed to start RTC: %d", ret);
+        return ret;
+    }
+    counter->dev = dev;
+    return 0;
+}
 
 //  ========== app_rtc_init ==========================================================================
+// starts the counter and extends it to 64 bits with the top callback. idempotent
 const struct device *app_rtc_init(void)
 {
-    const struct device *rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc0));
+    const struct device *rtc_dev = DEVICE_DT_GET(RTC_COUNTER_NODE);
+    if (rtc_ext.dev) {
+        return rtc_ext.dev;
+    }
     if (!device_is_ready(rtc_dev)) {
-        printk("RTC device is not ready\n");
+        LOG_ERR("RTC device is not ready");
         return NULL;
     }
-
-    // start the counter
-    int8_t ret = counter_start(rtc_dev);
-    if (ret < 0) {
-        printk("failed to start RTC: %d\n", ret);
+    if (rtc_extend(&rtc_ext, rtc_dev) < 0) {
         return NULL;
     }
 
-    // initialize mutex
-    k_mutex_init(&offset_mutex);
+    uint32_t frequency = counter_get_frequency(rtc_dev);
 
-    printk("RTC initialized and started successfully (device: %s)\n", rtc_dev->name);
+    LOG_INF("RTC initialized and started successfully (device: %s, %u Hz, wraps every %llu s)",
+            rtc_dev->name, frequency, rtc_ext.period / frequency);
     return rtc_dev;
 }
 
+//  ========== app_rtc_ticks =========================================================================
+// monotonic 64-bit tick count since app_rtc_init(), lock-free, callable from ISRs
+uint64_t app_rtc_ticks(void)
+{
+    int64_t offset_us, offset_ms;
+
+    return rtc_read(&rtc_ext, &offset_us, &offset_ms);
+}
+
+//  ========== app_rtc_ticks_to_us ===================================================================
+uint64_t app_rtc_ticks_to_us(uint64_t ticks)
+{
+    return rtc_scale(ticks, rtc_ext.to_us);
+}
+
+//  ========== app_rtc_now_us ========================================================================
+// RTC time in microseconds, lock-free, callable from ISRs. the resolution is one tick,
+// 30.5 us at 32.768 kHz
+int64_t app_rtc_now_us(void)
+{
+    int64_t offset_us, offset_ms;
+    uint64_t ticks = rtc_read(&rtc_ext, &offset_us, &offset_ms);
+
+    return (int64_t)rtc_scale(ticks, rtc_ext.to_us) + offset_us;
+}
+
 //  ========== app_rtc_set_time ======================================================================
 int8_t app_rtc_set_time(const struct device *rtc_dev, uint64_t target_time_ms)
 {
-    if (!rtc_dev) {
-        printk("RTC device is NULL\n");
-        return -EINVAL;
-    }
+    int64_t offset_us, offset_ms;
 
-    uint32_t rtc_ticks;
-    int8_t ret = counter_get_value(rtc_dev, &rtc_ticks);
-    if (ret < 0) {
-        printk("failed to read RTC ticks: %d\n", ret);
-        return ret;
+    if (!rtc_dev || rtc_dev != rtc_ext.dev) {
+        LOG_ERR("RTC device is NULL or not initialized");
+        return -EINVAL;
     }
 
-    uint32_t frequency = counter_get_frequency(rtc_dev);
-    int64_t rtc_time_ms = ((int64_t)rtc_ticks * 1000) / frequency;
-
-    int64_t new_offset = (int64_t)target_time_ms - rtc_time_ms;
+    uint64_t ticks = rtc_read(&rtc_ext, &offset_us, &offset_ms);
+    offset_us = (int64_t)(target_time_ms * USEC_PER_MSEC) - (int64_t)rtc_scale(ticks, rtc_ext.to_us);
+    offset_ms = (int64_t)target_time_ms - (int64_t)rtc_scale(ticks, rtc_ext.to_ms);
 
-    // safely update the global offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    system_rtc_offset_ms = new_offset;
-    k_mutex_unlock(&offset_mutex);
+    // publish the new offset to lock-free readers
+    rtc_offset_publish(offset_us, offset_ms);
 
-    printk("RTC time logically set to %llu ms via offset (%lld ms)\n", target_time_ms, new_offset);
+    LOG_INF("RTC time logically set to %llu ms via offset (%lld us)", target_time_ms, offset_us);
     return 0;
 }
 
 //  ========== app_rtc_sync_uptime ===================================================================
-// synchronize the system uptime with the on-board RTC.
+// compare the RTC timebase with the system uptime. the RTC time no longer depends on the
+// uptime, the offset between both is only checked and reported
 int8_t app_rtc_sync_uptime(const struct device *rtc_dev)
 {
-    if (!rtc_dev) {
-        printk("RTC device is NULL\n");
+    if (!rtc_dev || rtc_dev != rtc_ext.dev) {
+        LOG_ERR("RTC device is NULL or not initialized");
         return -EINVAL;
     }
 
-    uint32_t rtc_ticks;
-    uint32_t top_value;
-    uint32_t frequency;
-    int64_t rtc_time_ms;
-    int64_t current_uptime_ms;
-    int64_t new_offset_ms;
-
     // get system cycle count before and after RTC read
     uint64_t t1_cycles = k_cycle_get_64();
-
-    // retrieve the current RTC counter value
-    int8_t ret = counter_get_value(rtc_dev, &rtc_ticks);
-    if (ret < 0) {
-        printk("failed to get RTC counter value, error: %d\n", ret);
-        return ret;
-    }
-
+    uint64_t rtc_us = app_rtc_ticks_to_us(app_rtc_ticks());
     uint64_t t2_cycles = k_cycle_get_64();
 
-    // compute midpoint cycle time and convert to milliseconds
-    uint64_t mid_cycles = (t1_cycles + t2_cycles) / 2;
-    uint64_t sys_clk_hz = sys_clock_hw_cycles_per_sec();
-    current_uptime_ms = (mid_cycles * 1000) / sys_clk_hz;
-
-    // get the counter's top value and frequency
-    top_value = counter_get_top_value(rtc_dev);
-    frequency = counter_get_frequency(rtc_dev);
-
-    // convert the RTC ticks to milliseconds
-    rtc_time_ms = ((int64_t)rtc_ticks * 1000) / frequency;
-
-    // debug output
-    printk("RTC ticks: %u, top: %u, freq: %u Hz, time_ms: %lld\n",
-           rtc_ticks, top_value, frequency, rtc_time_ms);
-
-    // calculate the offset between RTC time and system uptime
-    new_offset_ms = rtc_time_ms - current_uptime_ms;
+    // midpoint of the read, in microseconds of uptime
+    int64_t uptime_us = (int64_t)k_cyc_to_us_floor64((t1_cycles + t2_cycles) / 2);
+    int64_t offset_us = (int64_t)rtc_us - uptime_us;
 
     // validate the offset (example: restrict offset to ±1 year for sanity)
-    if (new_offset_ms < -ONE_YEAR_MS || new_offset_ms > ONE_YEAR_MS) {
-        printk("offset out of range! calculation error\n");
+    if (offset_us / 1000 < -ONE_YEAR_MS || offset_us / 1000 > ONE_YEAR_MS) {
+        LOG_ERR("offset out of range! calculation error");
         return -EINVAL;
     }
 
-    // safely update the global offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    system_rtc_offset_ms = new_offset_ms;
-    k_mutex_unlock(&offset_mutex);
-
-    // debugging output
-    printk("calculated offset (ms): %lld\n", system_rtc_offset_ms);
-
+    LOG_DBG("RTC minus uptime: %lld us", offset_us);
     return 0;
 }
 
 //  ========== app_rtc_get_time ======================================================================
+// lock-free, callable from interrupt context
 uint64_t app_rtc_get_time()
 {
-    int64_t current_uptime_ms = k_uptime_get();
-    int64_t offset_ms;
+    int64_t offset_us, offset_ms;
+    uint64_t ticks = rtc_read(&rtc_ext, &offset_us, &offset_ms);
+    int64_t timestamp_ms = (int64_t)rtc_scale(ticks, rtc_ext.to_ms) + offset_ms;
 
-    // safely read the offset
-    k_mutex_lock(&offset_mutex, K_FOREVER);
-    offset_ms = system_rtc_offset_ms;
-    k_mutex_unlock(&offset_mutex);
-
-    // check for overflow or underflow
-    if (offset_ms > 0 &&
-        current_uptime_ms > UINT64_MAX - offset_ms) {
-        printk("overflow detected in timestamp calculation\n");
-        return UINT64_MAX;
-    }
-    if (offset_ms < 0 &&
-        current_uptime_ms < (uint64_t)(-offset_ms)) {
-        printk("underflow detected in timestamp calculation\n");
+    // check for underflow
+    if (timestamp_ms < 0) {
+        LOG_WRN("underflow detected in timestamp calculation");
         return 0;
     }
-    uint64_t timestamp_ms = current_uptime_ms + offset_ms;
-    return timestamp_ms;
+    return (uint64_t)timestamp_ms;
 }
 
 //  ========== app_rtc_periodic_sync==================================================================
 int8_t app_rtc_periodic_sync(const struct device *rtc_dev)
 {
     if (!rtc_dev) {
-        printk("RTC device is NULL\n");
+        LOG_ERR("RTC device is NULL");
         return -EINVAL;
     }
     
     // call this periodically from a thread or workqueue
     int8_t ret = app_rtc_sync_uptime(rtc_dev);
     if (ret < 0) {
-        printk("periodic sync failed, error: %d", ret);
+        LOG_ERR("periodic sync failed, error: %d", ret);
     }
     return 0;
-}
\ No newline at end of file
+}
+
+#if defined(CONFIG_APP_BENCH)
+//  ========== app_rtc_bench_extend ==================================================================
+// extends another counter, a simulated one, the RTC time is left alone
+int8_t app_rtc_bench_extend(const struct device *dev)
+{
+    if (!dev) {
+        return -EINVAL;
+    }
+    memset(&rtc_bench, 0, sizeof(rtc_bench));
+    return rtc_extend(&rtc_bench, dev);
+}
+
+//  ========== app_rtc_bench_ticks ===================================================================
+// app_rtc_ticks() of that counter
+uint64_t app_rtc_bench_ticks(void)
+{
+    int64_t offset_us, offset_ms;
+
+    return rtc_read(&rtc_bench, &offset_us, &offset_ms);
+}
+#endif /* CONFIG_APP_BENCH */
@@ -16,15 +16,58 @@
 #include <zephyr/drivers/counter.h>
 #include <zephyr/sys_clock.h> 
 
+#include "app_seqlock.h"
+
 //  ========== defines =====================================================================
-#define ONE_YEAR_MS                 365LL * 24 * 60 * 60 * 1000
+#define ONE_YEAR_MS                 31536000000LL
+
+// on-board RTC counter, the native_sim counter stands in for it on host builds
+#if DT_NODE_HAS_STATUS(DT_NODELABEL(rtc0), okay)
+#define RTC_COUNTER_NODE            DT_NODELABEL(rtc0)
+#else
+#define RTC_COUNTER_NODE            DT_NODELABEL(counter0)
+#endif
 #define CONFIG_COUNTER_NRF_RTC
 
+// the hardware counter (24 bits on the nRF52) is extended to a 64-bit tick count by its
+// wrap callback. ticks convert to time by precomputed fixed-point multipliers. sample
+// blocks are not stamped from it: the clock discipline runs on the kernel uptime, RTC1
+// counting the same 32.768 kHz crystal, see app_adc_block
+
+//  ========== types =======================================================================
+#if defined(CONFIG_APP_BENCH)
+// when the simulated wrap callback runs: with the wrap, a quarter period late, or inside
+// a read, at the counter value or at the pending flag
+enum app_rtc_wrap_mode {
+    APP_RTC_WRAP_ON_TIME,
+    APP_RTC_WRAP_LATE,
+    APP_RTC_WRAP_IN_VALUE,
+    APP_RTC_WRAP_IN_PENDING,
+    APP_RTC_WRAP_MODES,
+};
+
+struct app_rtc_wrap_result {
+    uint32_t wraps;
+    uint32_t reads;
+    uint32_t pending_reads;     // reads with a wrap not yet handled by the callback
+    uint32_t errors;            // extended count different from the true one
+    uint32_t backwards;         // extended count below the previous read
+};
+#endif
+
 //  ========== prototypes ==================================================================
 const struct device *app_rtc_init(void);
+uint64_t app_rtc_ticks(void);
+uint64_t app_rtc_ticks_to_us(uint64_t ticks);
+int64_t app_rtc_now_us(void);
 int8_t app_rtc_set_time(const struct device *rtc_dev, uint64_t target_time_ms);
 int8_t  app_rtc_sync_uptime(const struct device *rtc_dev);
 uint64_t app_rtc_get_time();
 int8_t app_rtc_periodic_sync(const struct device *rtc_dev);
+#if defined(CONFIG_APP_BENCH)
+int8_t app_rtc_bench_extend(const struct device *dev);
+uint64_t app_rtc_bench_ticks(void);
+int8_t app_rtc_bench_wraps(uint32_t wraps, struct app_rtc_wrap_result *result);
+#endif
 
 #endif /* APP_RTC_H */
\ No newline at end of file
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// simulated 24-bit counter for the benchmark: a counter device whose count only moves when
+// the benchmark steps it, and whose wrap callback runs on time, late, or in the middle of
+// a read. app_rtc extends it with the code that extends the RTC
+#if defined(CONFIG_APP_BENCH)
+
+#include "app_rtc.h"
+
+//  ========== defines =====================================================================
+#define RTC_SIM_PERIOD              (1ULL << 24)    // nRF52 RTC counter width
+#define RTC_SIM_FREQUENCY           32768
+
+//  ========== globals =====================================================================
+static struct {
+    uint64_t now;               // true tick count
+    uint64_t wraps_done;        // wraps the callback has handled
+    enum app_rtc_wrap_mode mode;
+    const struct device *dev;
+    counter_top_callback_t callback;
+    void *user_data;
+} rtc_sim;
+
+//  ========== rtc_sim_wrap ================================================================
+// the held wrap callback, as the interrupt would run it
+static void rtc_sim_wrap(void)
+{
+    rtc_sim.wraps_done++;
+    if (rtc_sim.callback) {
+        rtc_sim.callback(rtc_sim.dev, rtc_sim.user_data);
+    }
+}
+
+//  ========== rtc_sim_pending =============================================================
+static bool rtc_sim_pending(void)
+{
+    return (rtc_sim.now / RTC_SIM_PERIOD) > rtc_sim.wraps_done;
+}
+
+//  ========== rtc_sim_start ===============================================================
+static int rtc_sim_start(const struct device *dev)
+{
+    return 0;
+}
+
+//  ========== rtc_sim_stop ================================================================
+static int rtc_sim_stop(const struct device *dev)
+{
+    return 0;
+}
+
+//  ========== rtc_sim_get_value ===========================================================
+static int rtc_sim_get_value(const struct device *dev, uint32_t *ticks)
+{
+    if (rtc_sim.mode == APP_RTC_WRAP_IN_VALUE && rtc_sim_pending()) {
+        rtc_sim_wrap();
+    }
+    *ticks = (uint32_t)(rtc_sim.now % RTC_SIM_PERIOD);
+    return 0;
+}
+
+//  ========== rtc_sim_set_top_value =======================================================
+// only the full range of the hardware counter, which app_rtc asks for
+static int rtc_sim_set_top_value(const struct device *dev, const struct counter_top_cfg *cfg)
+{
+    if (cfg->ticks != RTC_SIM_PERIOD - 1) {
+        return -ENOTSUP;
+    }
+    rtc_sim.dev = dev;
+    rtc_sim.callback = cfg->callback;
+    rtc_sim.user_data = cfg->user_data;
+    return 0;
+}
+
+//  ========== rtc_sim_get_pending_int =====================================================
+static uint32_t rtc_sim_get_pending_int(const struct device *dev)
+{
+    if (rtc_sim.mode == APP_RTC_WRAP_IN_PENDING && rtc_sim_pending()) {
+        rtc_sim_wrap();
+    }
+    return rtc_sim_pending() ? 1 : 0;
+}
+
+//  ========== rtc_sim_get_top_value =======================================================
+static uint32_t rtc_sim_get_top_value(const struct device *dev)
+{
+    return RTC_SIM_PERIOD - 1;
+}
+
+// counter device on the simulated count, no alarms
+static const struct counter_driver_api rtc_sim_api = {
+    .start = rtc_sim_start,
+    .stop = rtc_sim_stop,
+    .get_value = rtc_sim_get_value,
+    .set_top_value = rtc_sim_set_top_value,
+    .get_pending_int = rtc_sim_get_pending_int,
+    .get_top_value = rtc_sim_get_top_value,
+};
+
+static const struct counter_config_info rtc_sim_config = {
+    .max_top_value = RTC_SIM_PERIOD - 1,
+    .freq = RTC_SIM_FREQUENCY,
+    .flags = COUNTER_CONFIG_INFO_COUNT_UP,
+    .channels = 0,
+};
+
+DEVICE_DEFINE(rtc_sim, "rtc_sim", NULL, NULL, NULL, &rtc_sim_config, POST_KERNEL,
+              CONFIG_KERNEL_INIT_PRIORITY_DEVICE, &rtc_sim_api);
+
+//  ========== app_rtc_bench_wraps =========================================================
+// drives the simulated counter through wraps and checks that the extended count equals
+// the true one at every read. the wrap callback cycles through the modes, one per wrap,
+// a late callback running a quarter period after its wrap. the RTC time is not touched
+int8_t app_rtc_bench_wraps(uint32_t wraps, struct app_rtc_wrap_result *result)
+{
+    uint64_t previous = 0;
+    uint32_t seed = 0x2545f491;
+    int8_t ret;
+
+    if (!result) {
+        return -EINVAL;
+    }
+    memset(result, 0, sizeof(*result));
+    memset(&rtc_sim, 0, sizeof(rtc_sim));
+
+    ret = app_rtc_bench_extend(DEVICE_GET(rtc_sim));
+    if (ret < 0) {
+        return ret;
+    }
+
+    while (rtc_sim.now < wraps * RTC_SIM_PERIOD) {
+        uint64_t wrap = rtc_sim.now / RTC_SIM_PERIOD;
+        uint64_t next = (wrap + 1) * RTC_SIM_PERIOD;
+        uint64_t ticks;
+
+        rtc_sim.mode = (enum app_rtc_wrap_mode)(wrap % APP_RTC_WRAP_MODES);
+        if (rtc_sim_pending() &&
+            (rtc_sim.mode == APP_RTC_WRAP_ON_TIME ||
+             (rtc_sim.mode == APP_RTC_WRAP_LATE &&
+              (rtc_sim.now % RTC_SIM_PERIOD) >= (RTC_SIM_PERIOD / 4)))) {
+            rtc_sim_wrap();
+        }
+        if (rtc_sim_pending()) {
+            result->pending_reads++;
+        }
+
+        ticks = app_rtc_bench_ticks();
+        result->reads++;
+        if (ticks != rtc_sim.now) {
+            result->errors++;
+        }
+        if (ticks < previous) {
+            result->backwards++;
+        }
+        previous = ticks;
+
+        // up to 1/64 of a period per step, landing exactly on each wrap
+        seed = (seed * 1664525u) + 1013904223u;
+        rtc_sim.now = MIN(rtc_sim.now + 1 + ((seed >> 8) % (RTC_SIM_PERIOD / 64)), next);
+    }
+    result->wraps = (uint32_t)(rtc_sim.now / RTC_SIM_PERIOD);
+    return 0;
+}
+
+#endif /* CONFIG_APP_BENCH */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SEQLOCK_H
+#define APP_SEQLOCK_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+
+//  ========== types =======================================================================
+// sequence lock for small, rarely written state read on every sample timestamp.
+// readers never block and may run in ISRs: they copy the state and retry if a write
+// happened meanwhile. writers are serialized by a spinlock, which also masks interrupts
+// so that a reader in an ISR cannot spin on a writer it preempted.
+struct app_seqlock {
+    atomic_t seq;               // odd while a write is in progress
+    struct k_spinlock lock;
+};
+
+//  ========== app_seqlock_read_begin ======================================================
+static inline uint32_t app_seqlock_read_begin(const struct app_seqlock *sl)
+{
+    uint32_t seq;
+
+    do {
+        seq = (uint32_t)atomic_get(&sl->seq);
+    } while (seq & 1);
+    barrier_dmem_fence_full();
+    return seq;
+}
+
+//  ========== app_seqlock_read_retry ======================================================
+// true if the state copied since app_seqlock_read_begin() may be torn
+static inline bool app_seqlock_read_retry(const struct app_seqlock *sl, uint32_t seq)
+{
+    barrier_dmem_fence_full();
+    return (uint32_t)atomic_get(&sl->seq) != seq;
+}
+
+//  ========== app_seqlock_write_begin =====================================================
+static inline k_spinlock_key_t app_seqlock_write_begin(struct app_seqlock *sl)
+{
+    k_spinlock_key_t key = k_spin_lock(&sl->lock);
+
+    atomic_inc(&sl->seq);
+    barrier_dmem_fence_full();
+    return key;
+}
+
+//  ========== app_seqlock_write_end =======================================================
+static inline void app_seqlock_write_end(struct app_seqlock *sl, k_spinlock_key_t key)
+{
+    barrier_dmem_fence_full();
+    atomic_inc(&sl->seq);
+    k_spin_unlock(&sl->lock, key);
+}
+
+#endif /* APP_SEQLOCK_H */
@@ -0,0 +1,478 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// spectral summaries of the stream: Hann windows with overlap, Q15 real FFT, power
+// averaged per bin over a period, then reduced to band powers, peak frequency and RMS
+#if defined(CONFIG_APP_SPECTRUM)
+
+#include "app_spectrum.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <zephyr/sys/byteorder.h>
+#if SPECTRUM_HAS_CMSIS
+#include <arm_math.h>
+#endif
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_spectrum, CONFIG_APP_ADC_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define SPECTRUM_Q                  15
+#define SPECTRUM_HEADROOM           (1 << 14)   // windowed peak, the butterflies cannot overflow
+#define SPECTRUM_HANN_POWER         0.375f      // mean of the squared Hann window
+
+BUILD_ASSERT(IS_POWER_OF_TWO(SPECTRUM_FFT_SIZE), "the FFT size must be a power of two");
+BUILD_ASSERT(SPECTRUM_HOP > 0, "the windows must advance");
+
+//  ========== globals =====================================================================
+// analysis state, only touched by the thread calling app_spectrum_process() and by the
+// statistics call, serialized by the mutex
+static struct {
+    app_spectrum_sink_t sink;
+    uint8_t bands;
+    uint16_t band_first[SPECTRUM_MAX_BANDS];    // bin range of each band, empty if
+    uint16_t band_last[SPECTRUM_MAX_BANDS];     // first > last
+
+    int16_t frame[SPECTRUM_FFT_SIZE];   // samples of the next window
+    uint16_t fill;
+
+    bool open;                          // a period is being accumulated
+    uint64_t start_ms;
+    uint32_t samples;
+    int64_t sum;
+    uint64_t sum_sq;
+    uint16_t windows;
+    float power[SPECTRUM_BINS];         // |X[k]|^2 summed over the windows, ADC counts^2
+
+    struct app_spectrum_stats stats;
+} spec;
+
+K_MUTEX_DEFINE(spectrum_mutex);
+
+// Q15 tables, filled once at init
+static int16_t spectrum_hann[SPECTRUM_FFT_SIZE];
+static int16_t spectrum_twiddle[SPECTRUM_FFT_SIZE / 2][2];  // cos, sin of 2 pi k / N
+
+// the FFT input and output, word aligned for CMSIS-DSP. the output holds a whole
+// spectrum: some CMSIS-DSP versions write the mirrored half as well
+static int16_t spectrum_work[SPECTRUM_FFT_SIZE] __aligned(4);
+static int16_t spectrum_out[2 * SPECTRUM_FFT_SIZE] __aligned(4);
+
+#if SPECTRUM_HAS_CMSIS
+static arm_rfft_instance_q15 spectrum_rfft;
+#endif
+
+//  ========== spectrum_q15 ================================================================
+static inline int16_t spectrum_q15(float x)
+{
+    return (int16_t)CLAMP(lroundf(x * (1 << SPECTRUM_Q)), INT16_MIN, INT16_MAX);
+}
+
+//  ========== spectrum_parse_bands ========================================================
+// CONFIG_APP_SPECTRUM_BANDS lists increasing edges in Hz, a band per pair of neighbours.
+// band b takes the bins of frequency edge[b] <= f < edge[b + 1], the last one Nyquist as
+// well. returns the band count
+static int spectrum_parse_bands(void)
+{
+    const char *p = CONFIG_APP_SPECTRUM_BANDS;
+    uint32_t prev = 0;
+    bool first = true;
+    int n = 0;
+
+    while (*p) {
+        char *end;
+        uint32_t edge = strtoul(p, &end, 10);
+
+        if (end == p || (!first && edge <= prev)) {
+            return -EINVAL;
+        }
+        if (!first) {
+            if (n == SPECTRUM_MAX_BANDS) {
+                return -EINVAL;
+            }
+            spec.band_first[n] = DIV_ROUND_UP(prev * SPECTRUM_FFT_SIZE, SPECTRUM_RATE_HZ);
+            spec.band_last[n] = MIN(DIV_ROUND_UP(edge * SPECTRUM_FFT_SIZE, SPECTRUM_RATE_HZ),
+                                    SPECTRUM_BINS) - 1;
+            if (2 * edge >= SPECTRUM_RATE_HZ) {
+                spec.band_last[n] = SPECTRUM_BINS - 1;
+            }
+            n++;
+        }
+        prev = edge;
+        first = false;
+        p = end;
+        while (*p == ',' || *p == ' ') {
+            p++;
+        }
+    }
+    return (n > 0) ? n : -EINVAL;
+}
+
+//  ========== spectrum_cfft ===============================================================
+// in-place radix-2 complex FFT of m points, interleaved real and imaginary parts. each
+// stage halves its outputs, so the result is scaled by 1 / m and stays in range for
+// inputs below SPECTRUM_HEADROOM
+static void spectrum_cfft(int16_t *z, uint16_t m)
+{
+    // bit-reversed order
+    for (uint16_t i = 1, j = 0; i < m; i++) {
+        uint16_t bit = m >> 1;
+
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            int16_t re = z[2 * i];
+            int16_t im = z[(2 * i) + 1];
+
+            z[2 * i] = z[2 * j];
+            z[(2 * i) + 1] = z[(2 * j) + 1];
+            z[2 * j] = re;
+            z[(2 * j) + 1] = im;
+        }
+    }
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        uint16_t half = len / 2;
+        uint16_t step = SPECTRUM_FFT_SIZE / len;    // W_len^j = W_N^(j * N / len)
+
+        for (uint16_t i = 0; i < m; i += len) {
+            for (uint16_t j = 0; j < half; j++) {
+                int16_t *a = &z[2 * (i + j)];
+                int16_t *b = &z[2 * (i + j + half)];
+                int32_t c = spectrum_twiddle[j * step][0];
+                int32_t s = spectrum_twiddle[j * step][1];
+                // b * W, W = c - js
+                int32_t tr = ((b[0] * c) + (b[1] * s) + (1 << (SPECTRUM_Q - 1))) >> SPECTRUM_Q;
+                int32_t ti = ((b[1] * c) - (b[0] * s) + (1 << (SPECTRUM_Q - 1))) >> SPECTRUM_Q;
+
+                b[0] = (int16_t)((a[0] - tr) >> 1);
+                b[1] = (int16_t)((a[1] - ti) >> 1);
+                a[0] = (int16_t)((a[0] + tr) >> 1);
+                a[1] = (int16_t)((a[1] + ti) >> 1);
+            }
+        }
+    }
+}
+
+//  ========== app_spectrum_rfft_scalar ====================================================
+// portable kernel: the N real samples, read as N / 2 complex ones (even samples real, odd
+// imaginary), go through a half-size complex FFT which is then split into the N-point
+// real spectrum, X[k] = (A + W_N^k * B / j) / 4 with A = Z[k] + Z*[m - k] and
+// B = Z[k] - Z*[m - k]
+void app_spectrum_rfft_scalar(int16_t *in, int16_t *out)
+{
+    const uint16_t m = SPECTRUM_FFT_SIZE / 2;
+
+    spectrum_cfft(in, m);
+
+    out[0] = (int16_t)((in[0] + in[1]) >> 1);
+    out[1] = 0;
+    out[2 * m] = (int16_t)((in[0] - in[1]) >> 1);
+    out[(2 * m) + 1] = 0;
+
+    for (uint16_t k = 1; k < m; k++) {
+        int32_t zr = in[2 * k];
+        int32_t zi = in[(2 * k) + 1];
+        int32_t yr = in[2 * (m - k)];
+        int32_t yi = in[(2 * (m - k)) + 1];
+        int64_t ar = zr + yr;
+        int64_t ai = zi - yi;
+        int64_t br = zr - yr;
+        int64_t bi = zi + yi;
+        int64_t c = spectrum_twiddle[k][0];
+        int64_t s = spectrum_twiddle[k][1];
+
+        out[2 * k] = (int16_t)(((ar * (1 << SPECTRUM_Q)) + (bi * c) - (br * s) +
+                                (1 << (SPECTRUM_Q + 1))) >> (SPECTRUM_Q + 2));
+        out[(2 * k) + 1] = (int16_t)(((ai * (1 << SPECTRUM_Q)) - (br * c) - (bi * s) +
+                                      (1 << (SPECTRUM_Q + 1))) >> (SPECTRUM_Q + 2));
+    }
+}
+
+#if SPECTRUM_HAS_CMSIS
+//  ========== app_spectrum_rfft_cmsis =====================================================
+// arm_rfft_q15() scales its output by 2 / N whatever the size (8.8 format at 256 points,
+// upscaled by 7 bits), one more rounded halving gives the 1 / N of the scalar kernel
+void app_spectrum_rfft_cmsis(int16_t *in, int16_t *out)
+{
+    arm_rfft_q15(&spectrum_rfft, in, out);
+    for (uint16_t k = 0; k < 2 * SPECTRUM_BINS; k++) {
+        out[k] = (int16_t)((out[k] + 1) >> 1);
+    }
+}
+#endif
+
+//  ========== spectrum_window =============================================================
+// one window of spec.frame into the period power. the window mean is removed first, an
+// ADC offset would leak into the lowest bands. block floating point: the samples are
+// shifted so that the largest one sits just below SPECTRUM_HEADROOM, small signals keep
+// their resolution through the FFT scaling, and the power is shifted back
+static void spectrum_window(void)
+{
+    uint32_t start_cycles = k_cycle_get_32();
+    int32_t sum = 0;
+    int32_t mean;
+    int32_t peak = 0;
+    int shift = 0;
+
+    for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        sum += spec.frame[n];
+    }
+    mean = sum / SPECTRUM_FFT_SIZE;
+    for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        peak = MAX(peak, abs(spec.frame[n] - mean));
+    }
+    if (peak > 0) {
+        while ((peak << (shift + 1)) < SPECTRUM_HEADROOM) {
+            shift++;
+        }
+        while (shift <= 0 && (peak >> -shift) >= SPECTRUM_HEADROOM) {
+            shift--;
+        }
+    }
+
+    for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        int32_t x = spec.frame[n] - mean;
+
+        x = (shift >= 0) ? (x * (1 << shift)) : (x >> -shift);
+
+        spectrum_work[n] = (int16_t)(((x * spectrum_hann[n]) + (1 << (SPECTRUM_Q - 1))) >>
+                                     SPECTRUM_Q);
+    }
+
+#if SPECTRUM_HAS_CMSIS
+    app_spectrum_rfft_cmsis(spectrum_work, spectrum_out);
+#else
+    app_spectrum_rfft_scalar(spectrum_work, spectrum_out);
+#endif
+
+    // |X[k] / N|^2 back in ADC counts^2: Parseval gives the mean square of the window
+    // as the sum over all N bins
+    float scale = ldexpf(1.0f, -2 * shift);
+
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++) {
+        int32_t re = spectrum_out[2 * k];
+        int32_t im = spectrum_out[(2 * k) + 1];
+
+        spec.power[k] += (float)((uint32_t)((re * re) + (im * im))) * scale;
+    }
+    spec.windows++;
+    spec.stats.windows++;
+    spec.stats.cycles += k_cycle_get_32() - start_cycles;
+}
+
+//  ========== spectrum_close ==============================================================
+// reduce the period to its summary and hand it to the sink
+static void spectrum_close(void)
+{
+    struct app_spectrum_summary summary = {
+        .start_time = spec.start_ms,
+        .rate_hz = SPECTRUM_RATE_HZ,
+        .fft_size = SPECTRUM_FFT_SIZE,
+        .windows = spec.windows,
+        .bands = spec.bands,
+    };
+    float mean = (float)spec.sum / spec.samples;
+    float variance = ((float)spec.sum_sq / spec.samples) - (mean * mean);
+
+    summary.rms = (uint16_t)MIN(lroundf(sqrtf(MAX(variance, 0.0f))), UINT16_MAX);
+
+    for (uint8_t b = 0; b < spec.bands; b++) {
+        summary.power_cb[b] = SPECTRUM_POWER_NONE;
+    }
+
+    if (spec.windows > 0) {
+        // one-sided spectrum: the bins between DC and Nyquist stand for their mirror too,
+        // and the Hann window took 1 - SPECTRUM_HANN_POWER of the power away
+        float norm = 1.0f / (SPECTRUM_HANN_POWER * spec.windows);
+        uint16_t k = 1;
+
+        for (uint16_t i = 2; i < SPECTRUM_BINS; i++) {
+            if (spec.power[i] > spec.power[k]) {
+                k = i;
+            }
+        }
+        // parabola through the log power of the strongest bin and its neighbours, close
+        // to the shape of the Hann main lobe
+        float delta = 0.0f;
+
+        if (k < SPECTRUM_BINS - 1 && spec.power[k - 1] > 0.0f && spec.power[k + 1] > 0.0f) {
+            float l = logf(spec.power[k - 1]);
+            float c = logf(spec.power[k]);
+            float r = logf(spec.power[k + 1]);
+            float d = l - (2.0f * c) + r;
+
+            if (d < 0.0f) {
+                delta = CLAMP(0.5f * (l - r) / d, -0.5f, 0.5f);
+            }
+        }
+        if (spec.power[k] > 0.0f) {
+            summary.peak_mhz = (uint32_t)lroundf(((k + delta) * SPECTRUM_RATE_HZ * 1000.0f) /
+                                                 SPECTRUM_FFT_SIZE);
+        }
+
+        for (uint8_t b = 0; b < spec.bands; b++) {
+            float power = 0.0f;
+
+            for (uint16_t i = spec.band_first[b]; i <= spec.band_last[b]; i++) {
+                power += spec.power[i] * ((i == 0 || i == SPECTRUM_BINS - 1) ? 1.0f : 2.0f);
+            }
+            power *= norm;
+            if (power > 0.0f) {
+                summary.power_cb[b] = (int16_t)CLAMP(lroundf(1000.0f * log10f(power)),
+                                                     INT16_MIN + 1, INT16_MAX);
+            }
+        }
+    }
+
+    spec.open = false;
+    spec.stats.summaries++;
+    LOG_DBG("spectrum: %u windows, peak %u mHz, RMS %u", summary.windows, summary.peak_mhz,
+            summary.rms);
+    if (spec.sink && spec.sink(&summary) != 0) {
+        spec.stats.sink_errors++;
+    }
+}
+
+//  ========== app_spectrum_init ===========================================================
+int8_t app_spectrum_init(app_spectrum_sink_t sink)
+{
+    int ret;
+
+    k_mutex_lock(&spectrum_mutex, K_FOREVER);
+    memset(&spec, 0, sizeof(spec));
+    spec.sink = sink;
+
+    // periodic Hann, overlapping windows add up to a constant at 50 and 75 %
+    for (uint16_t n = 0; n < SPECTRUM_FFT_SIZE; n++) {
+        spectrum_hann[n] = spectrum_q15(0.5f - (0.5f * cosf((2.0f * (float)M_PI * n) /
+                                                             SPECTRUM_FFT_SIZE)));
+    }
+    for (uint16_t k = 0; k < SPECTRUM_FFT_SIZE / 2; k++) {
+        float phi = (2.0f * (float)M_PI * k) / SPECTRUM_FFT_SIZE;
+
+        spectrum_twiddle[k][0] = spectrum_q15(cosf(phi));
+        spectrum_twiddle[k][1] = spectrum_q15(sinf(phi));
+    }
+
+    ret = spectrum_parse_bands();
+    if (ret < 0) {
+        LOG_ERR("invalid band edges \"%s\"", CONFIG_APP_SPECTRUM_BANDS);
+    } else {
+        spec.bands = (uint8_t)ret;
+        ret = 0;
+    }
+#if SPECTRUM_HAS_CMSIS
+    if (ret == 0 && arm_rfft_init_q15(&spectrum_rfft, SPECTRUM_FFT_SIZE, 0, 1) != ARM_MATH_SUCCESS) {
+        LOG_ERR("CMSIS-DSP has no %u-point real FFT", SPECTRUM_FFT_SIZE);
+        ret = -EINVAL;
+    }
+#endif
+    k_mutex_unlock(&spectrum_mutex);
+
+    if (ret == 0) {
+        LOG_INF("spectrum: %u-point FFT every %u samples at %u Hz, %u bands, %s kernel",
+                SPECTRUM_FFT_SIZE, SPECTRUM_HOP, SPECTRUM_RATE_HZ, spec.bands,
+                SPECTRUM_HAS_CMSIS ? "CMSIS-DSP" : "scalar");
+    }
+    return ret;
+}
+
+//  ========== app_spectrum_process ========================================================
+// consecutive samples of the stream, start_us is the timestamp of samples[0]. summaries
+// cover CONFIG_APP_SPECTRUM_PERIOD_S of samples each, a window straddling two periods
+// counts in the second one
+void app_spectrum_process(const int16_t *samples, uint16_t count, int64_t start_us)
+{
+    k_mutex_lock(&spectrum_mutex, K_FOREVER);
+    if (spec.bands == 0) {
+        // not initialized
+        k_mutex_unlock(&spectrum_mutex);
+        return;
+    }
+
+    for (uint16_t i = 0; i < count;) {
+        uint16_t n = MIN(count - i, SPECTRUM_FFT_SIZE - spec.fill);
+
+        if (!spec.open) {
+            spec.open = true;
+            spec.start_ms = (uint64_t)((start_us + ((int64_t)i * SPECTRUM_INTERVAL_US)) / 1000);
+            spec.samples = 0;
+            spec.sum = 0;
+            spec.sum_sq = 0;
+            spec.windows = 0;
+            memset(spec.power, 0, sizeof(spec.power));
+        }
+        n = MIN(n, SPECTRUM_PERIOD_SAMPLES - spec.samples);
+
+        memcpy(&spec.frame[spec.fill], &samples[i], n * sizeof(int16_t));
+        for (uint16_t j = i; j < i + n; j++) {
+            spec.sum += samples[j];
+            spec.sum_sq += (uint64_t)((int32_t)samples[j] * samples[j]);
+        }
+        spec.fill += n;
+        spec.samples += n;
+        i += n;
+
+        if (spec.fill == SPECTRUM_FFT_SIZE) {
+            spectrum_window();
+            memmove(spec.frame, &spec.frame[SPECTRUM_HOP],
+                    (SPECTRUM_FFT_SIZE - SPECTRUM_HOP) * sizeof(int16_t));
+            spec.fill = SPECTRUM_FFT_SIZE - SPECTRUM_HOP;
+        }
+        if (spec.samples == SPECTRUM_PERIOD_SAMPLES) {
+            spectrum_close();
+        }
+    }
+    spec.stats.samples += count;
+    k_mutex_unlock(&spectrum_mutex);
+}
+
+//  ========== app_spectrum_encode =========================================================
+// serialize a summary as a log record, returns its length
+int app_spectrum_encode(const struct app_spectrum_summary *summary, uint8_t *out, size_t size)
+{
+    size_t length;
+
+    if (!summary || !out || summary->bands > SPECTRUM_MAX_BANDS) {
+        return -EINVAL;
+    }
+    length = SPECTRUM_HDR_SIZE + (2 * summary->bands);
+    if (size < length) {
+        return -ENOMEM;
+    }
+
+    out[0] = SPECTRUM_MAGIC;
+    out[1] = summary->bands;
+    sys_put_be16(summary->rate_hz, &out[2]);
+    sys_put_be16(summary->fft_size, &out[4]);
+    sys_put_be16(summary->windows, &out[6]);
+    sys_put_be64(summary->start_time, &out[8]);
+    sys_put_be32(summary->peak_mhz, &out[16]);
+    sys_put_be16(summary->rms, &out[20]);
+    out[22] = 0;
+    out[23] = 0;
+    for (uint8_t b = 0; b < summary->bands; b++) {
+        sys_put_be16((uint16_t)summary->power_cb[b], &out[SPECTRUM_HDR_SIZE + (2 * b)]);
+    }
+    return (int)length;
+}
+
+//  ========== app_spectrum_get_stats ======================================================
+void app_spectrum_get_stats(struct app_spectrum_stats *stats)
+{
+    k_mutex_lock(&spectrum_mutex, K_FOREVER);
+    *stats = spec.stats;
+    k_mutex_unlock(&spectrum_mutex);
+}
+
+#endif /* CONFIG_APP_SPECTRUM */
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_SPECTRUM_H
+#define APP_SPECTRUM_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+#include "app_adc.h"
+#if defined(CONFIG_APP_DSP)
+#include "app_dsp.h"
+#endif
+
+//  ========== defines =====================================================================
+// Q15 real FFT over Hann windows of the filtered stream, summarized once per period
+#if defined(CONFIG_APP_DSP)
+#define SPECTRUM_RATE_HZ            DSP_OUTPUT_RATE_HZ
+#define SPECTRUM_INTERVAL_US        DSP_OUTPUT_INTERVAL_US
+#else
+#define SPECTRUM_RATE_HZ            ADC_STREAM_RATE_HZ
+#define SPECTRUM_INTERVAL_US        ADC_STREAM_INTERVAL_US
+#endif
+#define SPECTRUM_FFT_SIZE           CONFIG_APP_SPECTRUM_FFT_SIZE
+#define SPECTRUM_HOP                (SPECTRUM_FFT_SIZE - \
+                                     ((SPECTRUM_FFT_SIZE * CONFIG_APP_SPECTRUM_OVERLAP_PCT) / 100))
+#define SPECTRUM_BINS               ((SPECTRUM_FFT_SIZE / 2) + 1)   // DC to Nyquist
+#define SPECTRUM_PERIOD_SAMPLES     ((uint32_t)CONFIG_APP_SPECTRUM_PERIOD_S * SPECTRUM_RATE_HZ)
+#define SPECTRUM_MAX_BANDS          16
+
+// summary record, big-endian like the Steim-2 blocks it is logged next to:
+//   u8 magic, u8 bands, u16 rate_hz, u16 fft_size, u16 windows, u64 start_time (ms),
+//   u32 peak frequency (mHz), u16 RMS (ADC counts), u16 reserved,
+//   then per band the mean power in 0.01 dB above 1 count^2, i16
+#define SPECTRUM_MAGIC              0x46    // 'F'
+#define SPECTRUM_HDR_SIZE           24
+#define SPECTRUM_MAX_SIZE           (SPECTRUM_HDR_SIZE + (2 * SPECTRUM_MAX_BANDS))
+#define SPECTRUM_POWER_NONE         INT16_MIN   // band without energy, or without bins
+
+// CMSIS-DSP real FFT when the library is built in, the scalar kernel otherwise
+#if defined(CONFIG_APP_SPECTRUM_CMSIS)
+#define SPECTRUM_HAS_CMSIS          1
+#else
+#define SPECTRUM_HAS_CMSIS          0
+#endif
+
+//  ========== types =======================================================================
+struct app_spectrum_summary {
+    uint64_t start_time;        // first sample of the period (ms since epoch)
+    uint16_t rate_hz;
+    uint16_t fft_size;
+    uint16_t windows;           // windows averaged
+    uint8_t bands;
+    uint32_t peak_mhz;          // strongest frequency above DC
+    uint16_t rms;               // of the samples around their mean, ADC counts
+    int16_t power_cb[SPECTRUM_MAX_BANDS];   // 0.01 dB, CONFIG_APP_SPECTRUM_BANDS edges
+};
+
+struct app_spectrum_stats {
+    uint64_t samples;
+    uint32_t windows;
+    uint32_t summaries;
+    uint32_t sink_errors;
+    uint64_t cycles;            // time spent windowing and transforming
+};
+
+// receives each summary at the end of its period
+typedef int (*app_spectrum_sink_t)(const struct app_spectrum_summary *summary);
+
+// real FFT of SPECTRUM_FFT_SIZE Q15 samples, destroyed, scaled by 1 / SPECTRUM_FFT_SIZE.
+// out receives bins 0 to SPECTRUM_BINS - 1 as real, imaginary pairs
+typedef void (*app_spectrum_rfft_t)(int16_t *in, int16_t *out);
+
+//  ========== prototypes ==================================================================
+int8_t app_spectrum_init(app_spectrum_sink_t sink);
+void app_spectrum_process(const int16_t *samples, uint16_t count, int64_t start_us);
+int app_spectrum_encode(const struct app_spectrum_summary *summary, uint8_t *out, size_t size);
+void app_spectrum_get_stats(struct app_spectrum_stats *stats);
+void app_spectrum_rfft_scalar(int16_t *in, int16_t *out);
+#if SPECTRUM_HAS_CMSIS
+void app_spectrum_rfft_cmsis(int16_t *in, int16_t *out);
+#endif
+
+#endif /* APP_SPECTRUM_H */
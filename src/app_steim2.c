@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#include "app_steim2.h"
+
+#include <zephyr/sys/byteorder.h>
+
+//  ========== defines =====================================================================
+// 2-bit control codes stored in word 0 of every frame
+#define STEIM2_C_NONE       0x0     // header word or unused
+#define STEIM2_C_BYTES      0x1     // four 8-bit differences
+#define STEIM2_C_LONG       0x2     // dnib 01: 1x30, 10: 2x15, 11: 3x10
+#define STEIM2_C_SHORT      0x3     // dnib 00: 5x6, 01: 6x5, 10: 7x4
+
+//  ========== types =======================================================================
+// packings in order of density, the encoder takes the first one that fits
+struct steim2_packing {
+    uint8_t count;              // differences per word
+    uint8_t bits;               // width of each difference
+    uint8_t code;               // control code
+    uint8_t dnib;               // decode nibble in bits 31..30, unused for code 01
+};
+
+static const struct steim2_packing steim2_packings[] = {
+    { 7,  4, STEIM2_C_SHORT, 0x2 },
+    { 6,  5, STEIM2_C_SHORT, 0x1 },
+    { 5,  6, STEIM2_C_SHORT, 0x0 },
+    { 4,  8, STEIM2_C_BYTES, 0x0 },
+    { 3, 10, STEIM2_C_LONG,  0x3 },
+    { 2, 15, STEIM2_C_LONG,  0x2 },
+    { 1, 30, STEIM2_C_LONG,  0x1 },
+};
+
+//  ========== steim2_bits_needed ==========================================================
+// smallest two's complement width holding the difference
+static inline uint8_t steim2_bits_needed(int32_t diff)
+{
+    uint32_t magnitude = (diff < 0) ? ~(uint32_t)diff : (uint32_t)diff;
+    return (magnitude == 0) ? 1 : (uint8_t)(33 - __builtin_clz(magnitude));
+}
+
+//  ========== steim2_sign_extend ==========================================================
+static inline int32_t steim2_sign_extend(uint32_t value, uint8_t bits)
+{
+    uint32_t sign = 1u << (bits - 1);
+    value &= (1u << bits) - 1;
+    return (int32_t)((value ^ sign) - sign);
+}
+
+//  ========== steim2_put_hdr ==============================================================
+static void steim2_put_hdr(const struct app_steim2_block_hdr *hdr, uint8_t *out)
+{
+    out[0] = STEIM2_BLOCK_MAGIC;
+    out[1] = hdr->frames;
+    sys_put_be16(hdr->rate_hz, &out[2]);
+    sys_put_be16(hdr->samples, &out[4]);
+    out[6] = 0;
+    out[7] = 0;
+    sys_put_be64(hdr->start_time, &out[8]);
+}
+
+//  ========== app_steim2_encode ===========================================================
+// previous is the last sample of the preceding block, it only affects the first
+// difference which decoders replace with the forward integration constant X0.
+// returns the encoded size in bytes
+int app_steim2_encode(const int16_t *samples, uint16_t count, int32_t previous,
+                      const struct app_steim2_block_hdr *hdr, uint8_t *out, size_t size)
+{
+    uint8_t widths[8];
+    uint32_t frame[STEIM2_FRAME_WORDS];
+    uint8_t *frames_out = out + STEIM2_BLOCK_HDR_SIZE;
+    uint8_t nframes = 0;
+    uint8_t word = 3;               // X0 and Xn occupy words 1 and 2 of the first frame
+    uint16_t i = 0;
+    struct app_steim2_block_hdr block;
+
+    if (!samples || !hdr || !out || count == 0) {
+        return -EINVAL;
+    }
+
+    memset(frame, 0, sizeof(frame));
+    frame[1] = (uint32_t)(int32_t)samples[0];
+    frame[2] = (uint32_t)(int32_t)samples[count - 1];
+
+    while (i < count) {
+        const struct steim2_packing *pk = NULL;
+        uint16_t avail = MIN(count - i, 7);
+        uint8_t max_width = 0;
+        uint32_t data = 0;
+
+        // widths of the next differences, shared by every candidate packing
+        for (uint16_t k = 0; k < avail; k++) {
+            int32_t prev = (i + k == 0) ? previous : samples[i + k - 1];
+            widths[k] = steim2_bits_needed((int32_t)samples[i + k] - prev);
+        }
+
+        for (size_t p = 0; p < ARRAY_SIZE(steim2_packings); p++) {
+            if (steim2_packings[p].count > avail) {
+                continue;
+            }
+            max_width = 0;
+            for (uint8_t k = 0; k < steim2_packings[p].count; k++) {
+                max_width = MAX(max_width, widths[k]);
+            }
+            if (max_width <= steim2_packings[p].bits) {
+                pk = &steim2_packings[p];
+                break;
+            }
+        }
+        if (!pk) {
+            return -ERANGE;
+        }
+
+        for (uint8_t k = 0; k < pk->count; k++) {
+            int32_t prev = (i + k == 0) ? previous : samples[i + k - 1];
+            uint32_t diff = (uint32_t)((int32_t)samples[i + k] - prev) & ((1u << pk->bits) - 1);
+            data = (data << pk->bits) | diff;
+        }
+        if (pk->code != STEIM2_C_BYTES) {
+            data |= (uint32_t)pk->dnib << 30;
+        }
+
+        frame[word] = data;
+        frame[0] |= (uint32_t)pk->code << (30 - (2 * word));
+        i += pk->count;
+
+        // flush a complete frame, or the last partially used one
+        if (++word == STEIM2_FRAME_WORDS || i == count) {
+            if (STEIM2_BLOCK_HDR_SIZE + ((size_t)nframes + 1) * STEIM2_FRAME_SIZE > size ||
+                nframes == UINT8_MAX) {
+                return -ENOMEM;
+            }
+            for (uint8_t w = 0; w < STEIM2_FRAME_WORDS; w++) {
+                sys_put_be32(frame[w], &frames_out[(nframes * STEIM2_FRAME_SIZE) + (w * 4)]);
+            }
+            nframes++;
+            memset(frame, 0, sizeof(frame));
+            word = 1;
+        }
+    }
+
+    block = *hdr;
+    block.samples = count;
+    block.frames = nframes;
+    steim2_put_hdr(&block, out);
+    return STEIM2_BLOCK_HDR_SIZE + (nframes * STEIM2_FRAME_SIZE);
+}
+
+//  ========== app_steim2_decode ===========================================================
+// returns the number of samples, or -EBADMSG if the reverse integration constant
+// does not match the last decoded sample
+int app_steim2_decode(const uint8_t *in, size_t length, struct app_steim2_block_hdr *hdr,
+                      int16_t *samples, uint16_t max)
+{
+    uint16_t n = 0;
+    int32_t x0 = 0;
+    int32_t xn = 0;
+    int32_t last = 0;
+
+    if (!in || !hdr || !samples || length < STEIM2_BLOCK_HDR_SIZE ||
+        in[0] != STEIM2_BLOCK_MAGIC) {
+        return -EINVAL;
+    }
+
+    hdr->frames = in[1];
+    hdr->rate_hz = sys_get_be16(&in[2]);
+    hdr->samples = sys_get_be16(&in[4]);
+    hdr->start_time = sys_get_be64(&in[8]);
+    if (length < STEIM2_BLOCK_HDR_SIZE + ((size_t)hdr->frames * STEIM2_FRAME_SIZE) ||
+        hdr->samples > max) {
+        return -ENOMEM;
+    }
+
+    for (uint8_t f = 0; f < hdr->frames; f++) {
+        const uint8_t *frame = in + STEIM2_BLOCK_HDR_SIZE + (f * STEIM2_FRAME_SIZE);
+        uint32_t nibbles = sys_get_be32(frame);
+
+        for (uint8_t w = 1; w < STEIM2_FRAME_WORDS && n < hdr->samples; w++) {
+            uint32_t data = sys_get_be32(&frame[w * 4]);
+            uint8_t code = (nibbles >> (30 - (2 * w))) & 0x3;
+            uint8_t cnt;
+            uint8_t bits;
+
+            if (f == 0 && w == 1) {
+                x0 = (int32_t)data;
+                continue;
+            }
+            if (f == 0 && w == 2) {
+                xn = (int32_t)data;
+                continue;
+            }
+
+            switch (code) {
+            case STEIM2_C_BYTES:
+                cnt = 4; bits = 8;
+                break;
+            case STEIM2_C_LONG:
+                cnt = data >> 30;
+                bits = (cnt == 1) ? 30 : (cnt == 2) ? 15 : 10;
+                break;
+            case STEIM2_C_SHORT:
+                switch (data >> 30) {
+                case 0x0: cnt = 5; bits = 6; break;
+                case 0x1: cnt = 6; bits = 5; break;
+                case 0x2: cnt = 7; bits = 4; break;
+                default: return -EBADMSG;
+                }
+                break;
+            default:
+                continue;
+            }
+            if (cnt == 0) {
+                return -EBADMSG;
+            }
+
+            for (int8_t k = cnt - 1; k >= 0 && n < hdr->samples; k--) {
+                int32_t diff = steim2_sign_extend(data >> (k * bits), bits);
+                // the first difference is relative to the previous block, X0 replaces it
+                last = (n == 0) ? x0 : last + diff;
+                samples[n++] = (int16_t)last;
+            }
+        }
+    }
+
+    if (n != hdr->samples || last != xn) {
+        return -EBADMSG;
+    }
+    return n;
+}
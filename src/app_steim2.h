@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_STEIM2_H
+#define APP_STEIM2_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+//  ========== defines =====================================================================
+// a compressed block is a 16-byte header followed by standard big-endian Steim-2 frames,
+// so the frames can be copied unchanged into the data section of a miniSEED record
+#define STEIM2_FRAME_SIZE           64      // 16 words of 32 bits
+#define STEIM2_FRAME_WORDS          16
+#define STEIM2_BLOCK_HDR_SIZE       16
+#define STEIM2_BLOCK_MAGIC          0x53    // 'S'
+
+// worst case: one difference per data word, plus X0/Xn in the first frame
+#define STEIM2_MAX_FRAMES(n)        DIV_ROUND_UP((n) + 2, STEIM2_FRAME_WORDS - 1)
+#define STEIM2_MAX_SIZE(n)          (STEIM2_BLOCK_HDR_SIZE + STEIM2_MAX_FRAMES(n) * STEIM2_FRAME_SIZE)
+
+//  ========== types =======================================================================
+struct app_steim2_block_hdr {
+    uint64_t start_time;        // timestamp of the first sample (ms since epoch)
+    uint16_t rate_hz;           // sample rate of the block
+    uint16_t samples;           // number of samples encoded
+    uint8_t frames;             // number of 64-byte frames following the header
+};
+
+//  ========== prototypes ==================================================================
+int app_steim2_encode(const int16_t *samples, uint16_t count, int32_t previous,
+                      const struct app_steim2_block_hdr *hdr, uint8_t *out, size_t size);
+int app_steim2_decode(const uint8_t *in, size_t length, struct app_steim2_block_hdr *hdr,
+                      int16_t *samples, uint16_t max);
+
+#endif /* APP_STEIM2_H */
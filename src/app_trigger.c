@@ -0,0 +1,300 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+#if defined(CONFIG_APP_TRIGGER)
+
+#include "app_trigger.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_trigger, CONFIG_APP_ADC_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define TRIGGER_Q                   16
+#define TRIGGER_ALPHA_Q             24
+#define TRIGGER_LTA_FLOOR           (1 << TRIGGER_Q)    // one ADC count, quiet input never triggers
+#define TRIGGER_RING_SIZE           MAX(TRIGGER_PRE_SAMPLES, 1)
+
+//  ========== globals =====================================================================
+// detector state, only touched by the thread calling app_trigger_process() and by the
+// configuration and statistics calls, serialized by the mutex
+static struct {
+    app_trigger_sink_t sink;
+    struct app_trigger_config config;
+    uint32_t dc_alpha;              // Q24 smoothing factors, 1 / window length
+    uint32_t sta_alpha;
+    uint32_t lta_alpha;
+    uint32_t pre_samples;
+    uint32_t post_samples;
+
+    bool primed;
+    int64_t dc;                     // Q16 running mean, removes the geophone bias
+    int64_t sta;                    // Q16 averages of the absolute amplitude
+    int64_t lta;
+    uint32_t warmup;                // samples left before the LTA is trusted
+
+    bool active;
+    bool detriggered;               // below the off ratio, recording the post-trigger
+    uint32_t post_left;
+
+    int16_t ring[TRIGGER_RING_SIZE];    // pre-trigger history, oldest at ring_head
+    uint32_t ring_head;
+    uint32_t ring_count;
+
+    int16_t out[TRIGGER_OUT_SAMPLES];   // event samples waiting for the sink
+    uint16_t out_count;
+    int64_t out_start_us;
+    bool out_first;
+
+    struct app_trigger_stats stats;
+} trig;
+
+K_MUTEX_DEFINE(trigger_mutex);
+
+//  ========== trigger_alpha ===============================================================
+static inline uint32_t trigger_alpha(uint32_t ms)
+{
+    uint32_t n = MAX(TRIGGER_MS_TO_SAMPLES(ms), 1);
+    return (uint32_t)((1ULL << TRIGGER_ALPHA_Q) / n);
+}
+
+//  ========== trigger_average =============================================================
+// one step of the recursive average: avg += (x - avg) * alpha
+static inline int64_t trigger_average(int64_t avg, int64_t x, uint32_t alpha)
+{
+    return avg + (((x - avg) * alpha) >> TRIGGER_ALPHA_Q);
+}
+
+//  ========== trigger_apply_config ========================================================
+static void trigger_apply_config(const struct app_trigger_config *config)
+{
+    trig.config = *config;
+    trig.config.pre_ms = MIN(config->pre_ms, CONFIG_APP_TRIGGER_PRE_MS);
+    trig.dc_alpha = trigger_alpha(TRIGGER_DC_MS);
+    trig.sta_alpha = trigger_alpha(config->sta_ms);
+    trig.lta_alpha = trigger_alpha(config->lta_ms);
+    trig.pre_samples = MIN(TRIGGER_MS_TO_SAMPLES(trig.config.pre_ms), TRIGGER_PRE_SAMPLES);
+    trig.post_samples = TRIGGER_MS_TO_SAMPLES(config->post_ms);
+
+    // restart the detector, the averages no longer match the windows
+    trig.primed = false;
+    trig.active = false;
+    trig.ring_head = 0;
+    trig.ring_count = 0;
+    trig.out_count = 0;
+}
+
+//  ========== trigger_flush ===============================================================
+static void trigger_flush(void)
+{
+    int ret = 0;
+
+    if (trig.out_count == 0) {
+        return;
+    }
+    if (trig.sink) {
+        ret = trig.sink(trig.out, trig.out_count, trig.out_start_us, trig.out_first);
+    }
+    if (ret < 0) {
+        trig.stats.sink_errors++;
+    }
+    trig.stats.samples_out += trig.out_count;
+    trig.stats.blocks_out++;
+    trig.out_first = false;
+    trig.out_count = 0;
+}
+
+//  ========== trigger_emit ================================================================
+static inline void trigger_emit(int16_t sample, int64_t t_us)
+{
+    if (trig.out_count == 0) {
+        trig.out_start_us = t_us;
+    }
+    trig.out[trig.out_count++] = sample;
+    if (trig.out_count == TRIGGER_OUT_SAMPLES) {
+        trigger_flush();
+    }
+}
+
+//  ========== trigger_on ==================================================================
+// open an event window with the pre-trigger history, oldest sample first
+static void trigger_on(int64_t t_us)
+{
+    int64_t start_us = t_us - ((int64_t)trig.ring_count * TRIGGER_INTERVAL_US);
+    uint32_t index = (trig.ring_head + trig.pre_samples - trig.ring_count) % MAX(trig.pre_samples, 1);
+
+    trig.active = true;
+    trig.detriggered = false;
+    trig.out_first = true;
+    trig.stats.events++;
+    trig.stats.last_trigger_us = t_us;
+
+    for (uint32_t i = 0; i < trig.ring_count; i++) {
+        trigger_emit(trig.ring[index], start_us + ((int64_t)i * TRIGGER_INTERVAL_US));
+        index = (index + 1) % trig.pre_samples;
+    }
+    trig.ring_head = 0;
+    trig.ring_count = 0;
+}
+
+//  ========== trigger_off =================================================================
+static void trigger_off(void)
+{
+    trigger_flush();
+    trig.active = false;
+}
+
+//  ========== app_trigger_init ============================================================
+int8_t app_trigger_init(app_trigger_sink_t sink)
+{
+    const struct app_trigger_config config = {
+        .sta_ms = CONFIG_APP_TRIGGER_STA_MS,
+        .lta_ms = CONFIG_APP_TRIGGER_LTA_MS,
+        .on_ratio = CONFIG_APP_TRIGGER_ON_RATIO,
+        .off_ratio = CONFIG_APP_TRIGGER_OFF_RATIO,
+        .pre_ms = CONFIG_APP_TRIGGER_PRE_MS,
+        .post_ms = CONFIG_APP_TRIGGER_POST_MS,
+    };
+
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+    memset(&trig, 0, sizeof(trig));
+    trig.sink = sink;
+    trigger_apply_config(&config);
+    k_mutex_unlock(&trigger_mutex);
+
+    LOG_INF("STA/LTA trigger: sta %u ms, lta %u ms, on %u/100, off %u/100",
+           config.sta_ms, config.lta_ms, config.on_ratio, config.off_ratio);
+    return 0;
+}
+
+//  ========== app_trigger_set_config ======================================================
+int8_t app_trigger_set_config(const struct app_trigger_config *config)
+{
+    if (!config || config->sta_ms == 0 || config->lta_ms <= config->sta_ms ||
+        config->off_ratio == 0 || config->on_ratio <= config->off_ratio) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+    // close a running event first, its tail would not be contiguous anymore
+    if (trig.active) {
+        trigger_off();
+    }
+    trigger_apply_config(config);
+    k_mutex_unlock(&trigger_mutex);
+    return 0;
+}
+
+//  ========== app_trigger_get_config ======================================================
+void app_trigger_get_config(struct app_trigger_config *config)
+{
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+    *config = trig.config;
+    k_mutex_unlock(&trigger_mutex);
+}
+
+//  ========== app_trigger_process =========================================================
+// run the detector over a block of consecutive samples, start_us being the timestamp
+// of samples[0]. outside events only the pre-trigger ring is written
+void app_trigger_process(const int16_t *samples, uint16_t count, int64_t start_us)
+{
+    uint32_t start_cycles = k_cycle_get_32();
+
+    if (!samples || count == 0) {
+        return;
+    }
+
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+
+    if (!trig.primed) {
+        trig.dc = (int64_t)samples[0] << TRIGGER_Q;
+        trig.sta = 0;
+        trig.lta = 0;
+        trig.warmup = TRIGGER_MS_TO_SAMPLES(trig.config.lta_ms);
+        trig.primed = true;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        int64_t t_us = start_us + ((int64_t)i * TRIGGER_INTERVAL_US);
+        int64_t x = (int64_t)samples[i] << TRIGGER_Q;
+        int64_t cf;
+        int64_t sta_scaled;
+        int64_t lta;
+
+        trig.dc = trigger_average(trig.dc, x, trig.dc_alpha);
+        cf = (x >= trig.dc) ? (x - trig.dc) : (trig.dc - x);
+        trig.sta = trigger_average(trig.sta, cf, trig.sta_alpha);
+
+        // the LTA is frozen during events so that long arrivals do not raise their
+        // own detrigger level
+        if (!trig.active) {
+            trig.lta = trigger_average(trig.lta, cf, trig.lta_alpha);
+        }
+        if (trig.warmup > 0) {
+            trig.warmup--;
+        }
+
+        sta_scaled = trig.sta * 100;
+        lta = MAX(trig.lta, TRIGGER_LTA_FLOOR);
+
+        if (!trig.active) {
+            if (trig.warmup == 0 && sta_scaled > lta * trig.config.on_ratio) {
+                trigger_on(t_us);
+                trigger_emit(samples[i], t_us);
+            } else if (trig.pre_samples > 0) {
+                trig.ring[trig.ring_head] = samples[i];
+                trig.ring_head = (trig.ring_head + 1) % trig.pre_samples;
+                trig.ring_count = MIN(trig.ring_count + 1, trig.pre_samples);
+            }
+            continue;
+        }
+
+        trigger_emit(samples[i], t_us);
+
+        if (!trig.detriggered) {
+            if (sta_scaled < lta * trig.config.off_ratio) {
+                trig.detriggered = true;
+                trig.post_left = trig.post_samples;
+            }
+        } else if (sta_scaled > lta * trig.config.on_ratio) {
+            // retriggered within the post-trigger: keep the same event going
+            trig.detriggered = false;
+        } else if (trig.post_left == 0) {
+            trigger_off();
+        } else {
+            trig.post_left--;
+        }
+    }
+
+    trig.stats.samples_in += count;
+    trig.stats.cycles += k_cycle_get_32() - start_cycles;
+    k_mutex_unlock(&trigger_mutex);
+}
+
+//  ========== app_trigger_active ==========================================================
+bool app_trigger_active(void)
+{
+    return trig.active;
+}
+
+//  ========== app_trigger_get_stats =======================================================
+void app_trigger_get_stats(struct app_trigger_stats *stats)
+{
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+    *stats = trig.stats;
+    k_mutex_unlock(&trigger_mutex);
+}
+
+//  ========== app_trigger_reset_stats =====================================================
+void app_trigger_reset_stats(void)
+{
+    k_mutex_lock(&trigger_mutex, K_FOREVER);
+    memset(&trig.stats, 0, sizeof(trig.stats));
+    k_mutex_unlock(&trigger_mutex);
+}
+
+#endif /* CONFIG_APP_TRIGGER */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_TRIGGER_H
+#define APP_TRIGGER_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+#include "app_adc.h"
+#if defined(CONFIG_APP_DSP)
+#include "app_dsp.h"
+#endif
+
+//  ========== defines =====================================================================
+// recursive STA/LTA on the DC-free absolute amplitude, in Q16 fixed point
+// the detector runs behind the filter stage, at its output rate
+#if defined(CONFIG_APP_DSP)
+#define TRIGGER_RATE_HZ             DSP_OUTPUT_RATE_HZ
+#define TRIGGER_INTERVAL_US         DSP_OUTPUT_INTERVAL_US
+#else
+#define TRIGGER_RATE_HZ             ADC_STREAM_RATE_HZ
+#define TRIGGER_INTERVAL_US         ADC_STREAM_INTERVAL_US
+#endif
+#define TRIGGER_MS_TO_SAMPLES(ms)   ((uint32_t)(((uint64_t)(ms) * TRIGGER_RATE_HZ) / 1000))
+#define TRIGGER_PRE_SAMPLES         TRIGGER_MS_TO_SAMPLES(CONFIG_APP_TRIGGER_PRE_MS)
+#define TRIGGER_OUT_SAMPLES         CONFIG_APP_TRIGGER_OUT_SAMPLES
+#define TRIGGER_DC_MS               10000   // time constant of the DC tracker
+
+//  ========== types =======================================================================
+// runtime thresholds, ratios scaled by 100 (300 = STA three times above LTA)
+struct app_trigger_config {
+    uint32_t sta_ms;
+    uint32_t lta_ms;
+    uint16_t on_ratio;
+    uint16_t off_ratio;
+    uint32_t pre_ms;            // capped by CONFIG_APP_TRIGGER_PRE_MS
+    uint32_t post_ms;
+};
+
+struct app_trigger_stats {
+    uint32_t events;
+    uint64_t samples_in;        // samples seen by the detector
+    uint64_t samples_out;       // samples committed inside event windows
+    uint32_t blocks_out;
+    uint32_t sink_errors;
+    int64_t last_trigger_us;    // timestamp of the last trigger-on sample
+    uint64_t cycles;            // time spent in app_trigger_process()
+};
+
+// receives each event block in order, start_us is the timestamp of samples[0];
+// first is set on the first block of an event
+typedef int (*app_trigger_sink_t)(const int16_t *samples, uint16_t count, int64_t start_us,
+                                  bool first);
+
+//  ========== prototypes ==================================================================
+int8_t app_trigger_init(app_trigger_sink_t sink);
+int8_t app_trigger_set_config(const struct app_trigger_config *config);
+void app_trigger_get_config(struct app_trigger_config *config);
+void app_trigger_process(const int16_t *samples, uint16_t count, int64_t start_us);
+bool app_trigger_active(void);
+void app_trigger_get_stats(struct app_trigger_stats *stats);
+void app_trigger_reset_stats(void);
+
+#endif /* APP_TRIGGER_H */
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// uplink packetizer: reads the record log from the oldest unacknowledged record and packs
+// it into frames of the largest payload the current data rate allows
+#if defined(CONFIG_APP_UPLINK)
+
+#include "app_uplink.h"
+#include "app_eeprom.h"
+#include "app_housekeeping.h"
+
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_uplink, CONFIG_APP_UPLINK_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define UPLINK_RECORD_MAX           STEIM2_MAX_SIZE(STEIM2_MAX_BLOCK_SAMPLES)
+#define UPLINK_VARINT_MAX           10      // LEB128 bytes of a 64-bit value
+
+//  ========== types =======================================================================
+// outcome of packing one frame
+struct uplink_frame_info {
+    struct app_flash_log_cursor end;    // cursor after the last whole record of the frame
+    uint16_t records;                   // whole records, a last slice counts as one
+    uint16_t record_bytes;              // record bytes carried
+    uint16_t slice;                     // fragment frames: bytes of the slice
+    uint32_t seq;                       // fragment frames: sequence number of the record
+    bool last;                          // fragment frames: last slice of the record
+};
+
+//  ========== globals =====================================================================
+static struct {
+    const struct app_uplink_transport *transport;
+    struct app_flash_log_cursor next;   // first record not acknowledged yet
+    bool positioned;                    // next holds a position in the log
+    uint32_t frag_seq;                  // record being sent in slices
+    uint32_t frag_offset;               // bytes of it already acknowledged, 0 if none
+    struct app_uplink_stats stats;
+} uplink;
+
+static struct k_mutex uplink_mutex;
+static struct k_work_delayable uplink_work;
+static uint32_t uplink_session_frames;  // acknowledged by the bursts of the session so far
+
+static uint8_t uplink_frame[UPLINK_FRAME_MAX];
+static uint8_t uplink_record[UPLINK_RECORD_MAX];
+
+//  ========== uplink_put_varint ===========================================================
+static inline size_t uplink_put_varint(uint8_t *out, uint64_t value)
+{
+    size_t n = 0;
+
+    do {
+        out[n] = (uint8_t)(value & 0x7F);
+        value >>= 7;
+        if (value) {
+            out[n] |= 0x80;
+        }
+        n++;
+    } while (value);
+    return n;
+}
+
+//  ========== uplink_zigzag ===============================================================
+// small deltas of either sign stay small
+static inline uint64_t uplink_zigzag(int64_t value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+//  ========== uplink_strip_time ===========================================================
+// a Steim-2 block repeats the record time in its header: left out on air, the receiver
+// restores it from the frame. returns the length to send
+static size_t uplink_strip_time(uint8_t *record, size_t length, uint64_t time_ms,
+                                uint8_t *flags)
+{
+    if (length < STEIM2_BLOCK_HDR_SIZE || record[0] != STEIM2_BLOCK_MAGIC ||
+        sys_get_be64(&record[8]) != time_ms) {
+        return length;
+    }
+    memmove(&record[8], &record[16], length - 16);
+    *flags |= UPLINK_RECORD_STRIPPED;
+    return length - 8;
+}
+
+//  ========== uplink_pack_slice ===========================================================
+// a record larger than a frame goes out in slices, each one acknowledged before the next.
+// the first slice carries the record time and length
+static int uplink_pack_slice(const struct app_flash_log_cursor *cursor, size_t length,
+                             uint8_t flags, size_t capacity, struct uplink_frame_info *info)
+{
+    uint32_t offset = uplink.frag_offset;
+    size_t pos = 1;
+    size_t slice;
+
+    pos += uplink_put_varint(&uplink_frame[pos], cursor->record_seq);
+    pos += uplink_put_varint(&uplink_frame[pos], offset);
+    if (offset == 0) {
+        pos += uplink_put_varint(&uplink_frame[pos], cursor->time_ms);
+        pos += uplink_put_varint(&uplink_frame[pos], (length << 2) | flags);
+    }
+    if (pos >= capacity || offset >= length) {
+        return -EMSGSIZE;
+    }
+
+    slice = MIN(capacity - pos, length - offset);
+    info->last = (offset + slice == length);
+    uplink_frame[0] = UPLINK_FRAME_FRAGMENT | (info->last ? UPLINK_FRAME_LAST : 0);
+    memcpy(&uplink_frame[pos], &uplink_record[offset], slice);
+
+    info->end = *cursor;
+    info->records = info->last ? 1 : 0;
+    info->record_bytes = slice;
+    info->slice = slice;
+    info->seq = cursor->record_seq;
+    return pos + slice;
+}
+
+//  ========== uplink_pack =================================================================
+// fill uplink_frame with as many whole records following uplink.next as fit. returns the
+// frame length, 0 once the log is consumed
+static int uplink_pack(size_t capacity, struct uplink_frame_info *info)
+{
+    struct app_flash_log_cursor cursor = uplink.next;
+    struct app_flash_log_cursor before;
+    uint8_t head[4 * UPLINK_VARINT_MAX];
+    uint32_t prev_seq = 0;
+    uint64_t prev_ms = 0;
+    size_t pos = 0;
+    size_t length;
+    size_t n;
+    uint8_t flags;
+    int ret;
+
+    memset(info, 0, sizeof(*info));
+    while (1) {
+        before = cursor;
+        ret = app_flash_log_iter_next(&cursor, uplink_record, sizeof(uplink_record), &length);
+        if (ret == -ENOMEM) {
+            LOG_WRN("record %u too large for the uplink, skipped", cursor.record_seq);
+            uplink.stats.oversized++;
+            continue;
+        }
+        if (ret == -ENOENT) {
+            break;
+        }
+        if (ret != 0) {
+            return ret;
+        }
+
+        flags = 0;
+        length = uplink_strip_time(uplink_record, length, cursor.time_ms, &flags);
+        n = 0;
+        if (info->records == 0) {
+            if (uplink.frag_offset > 0 && cursor.record_seq != uplink.frag_seq) {
+                // the record being sliced left the log, overwritten or trimmed
+                uplink.frag_offset = 0;
+            }
+            if (uplink.frag_offset > 0) {
+                return uplink_pack_slice(&cursor, length, flags, capacity, info);
+            }
+            head[n++] = UPLINK_FRAME_RECORDS;
+            n += uplink_put_varint(&head[n], cursor.record_seq);
+            n += uplink_put_varint(&head[n], cursor.time_ms);
+            n += uplink_put_varint(&head[n], (length << 2) | flags);
+            if (n + length > capacity) {
+                return uplink_pack_slice(&cursor, length, flags, capacity, info);
+            }
+        } else {
+            if (cursor.record_seq != prev_seq + 1) {
+                flags |= UPLINK_RECORD_GAP;
+            }
+            n += uplink_put_varint(&head[n], (length << 2) | flags);
+            if (flags & UPLINK_RECORD_GAP) {
+                n += uplink_put_varint(&head[n], cursor.record_seq - prev_seq - 1);
+            }
+            n += uplink_put_varint(&head[n], uplink_zigzag((int64_t)(cursor.time_ms - prev_ms)));
+            if (pos + n + length > capacity) {
+                // opens the next frame
+                cursor = before;
+                break;
+            }
+        }
+
+        memcpy(&uplink_frame[pos], head, n);
+        pos += n;
+        memcpy(&uplink_frame[pos], uplink_record, length);
+        pos += length;
+        prev_seq = cursor.record_seq;
+        prev_ms = cursor.time_ms;
+        info->records++;
+        info->record_bytes += length;
+    }
+
+    if (info->records == 0) {
+        // nothing left to send, step over the oversized records for good
+        uplink.next = cursor;
+    }
+    info->end = cursor;
+    return pos;
+}
+
+//  ========== uplink_send =================================================================
+static int uplink_send(size_t length)
+{
+    int ret = -EIO;
+
+    for (int attempt = 1; attempt <= CONFIG_APP_UPLINK_RETRIES; attempt++) {
+        uplink.stats.air_bytes += length + UPLINK_LORAWAN_OVERHEAD;
+        ret = uplink.transport->send(UPLINK_FPORT, uplink_frame, (uint8_t)length);
+        if (ret == 0) {
+            return 0;
+        }
+        uplink.stats.failures++;
+        LOG_WRN("uplink frame not acknowledged, attempt %d. error: %d", attempt, ret);
+    }
+    return ret;
+}
+
+//  ========== uplink_handler ==============================================================
+// one uplink session per period on the housekeeping queue, in bursts of
+// CONFIG_APP_UPLINK_BURST_FRAMES frames so that the flush and erase-ahead work of the
+// flash log runs in between
+static void uplink_handler(struct k_work *work)
+{
+    int ret = app_uplink_flush(CONFIG_APP_UPLINK_BURST_FRAMES);
+
+    if (ret == CONFIG_APP_UPLINK_BURST_FRAMES) {
+        // more may be waiting, the session goes on after a pause
+        uplink_session_frames += ret;
+        (void)k_work_reschedule_for_queue(app_housekeeping_queue(), &uplink_work,
+                                          K_MSEC(CONFIG_APP_UPLINK_BURST_GAP_MS));
+        return;
+    }
+
+    if (ret < 0) {
+        LOG_WRN("uplink session stopped after %u frames. error: %d", uplink_session_frames,
+                ret);
+    } else {
+        LOG_INF("uplink session: %u frames acknowledged", uplink_session_frames + ret);
+    }
+    uplink_session_frames = 0;
+    (void)k_work_reschedule_for_queue(app_housekeeping_queue(), &uplink_work,
+                                      K_SECONDS(CONFIG_APP_UPLINK_PERIOD_S));
+}
+
+//  ========== app_uplink_init =============================================================
+int8_t app_uplink_init(const struct app_uplink_transport *transport)
+{
+    if (!transport || !transport->max_payload || !transport->send) {
+        return -EINVAL;
+    }
+
+    k_mutex_init(&uplink_mutex);
+    memset(&uplink, 0, sizeof(uplink));
+    uplink.transport = transport;
+    k_work_init_delayable(&uplink_work, uplink_handler);
+    uplink_session_frames = 0;
+    return 0;
+}
+
+//  ========== app_uplink_flush ============================================================
+// send the records logged since the last acknowledged one, at most max_frames frames (0
+// for no limit). a frame is sent up to CONFIG_APP_UPLINK_RETRIES times; its records are
+// trimmed from the log once acknowledged, a session stopped by a failure resumes from
+// the first unacknowledged record. returns the frames acknowledged
+int app_uplink_flush(uint32_t max_frames)
+{
+    struct uplink_frame_info info;
+    uint32_t sent = 0;
+    int ret = 0;
+    int len;
+
+    if (!uplink.transport) {
+        return -ENODEV;
+    }
+
+    k_mutex_lock(&uplink_mutex, K_FOREVER);
+    uplink.stats.sessions++;
+
+    if (!uplink.positioned) {
+        if (app_flash_log_iter_init(&uplink.next) != 0) {
+            // empty log
+            goto out;
+        }
+        uplink.positioned = true;
+    }
+
+    while (max_frames == 0 || sent < max_frames) {
+        len = uplink_pack(MIN(uplink.transport->max_payload(), sizeof(uplink_frame)), &info);
+        if (len <= 0) {
+            ret = len;
+            break;
+        }
+        ret = uplink_send(len);
+        if (ret != 0) {
+            break;
+        }
+
+        sent++;
+        uplink.stats.frames++;
+        uplink.stats.record_bytes += info.record_bytes;
+        if (info.slice) {
+            uplink.stats.fragments++;
+            uplink.frag_seq = info.seq;
+            uplink.frag_offset += info.slice;
+            if (!info.last) {
+                continue;
+            }
+            uplink.frag_offset = 0;
+        }
+        uplink.stats.records += info.records;
+        uplink.next = info.end;
+
+        // acknowledged: the sectors before the next record can be erased and reused
+        (void)app_flash_log_trim(&uplink.next);
+    }
+
+out:
+    k_mutex_unlock(&uplink_mutex);
+    return (ret < 0) ? ret : (int)sent;
+}
+
+//  ========== app_uplink_start ============================================================
+// first session one period from now
+int8_t app_uplink_start(void)
+{
+    if (!uplink.transport) {
+        return -ENODEV;
+    }
+    return (k_work_schedule_for_queue(app_housekeeping_queue(), &uplink_work,
+                                      K_SECONDS(CONFIG_APP_UPLINK_PERIOD_S)) < 0) ? -EIO : 0;
+}
+
+//  ========== app_uplink_get_stats ========================================================
+void app_uplink_get_stats(struct app_uplink_stats *stats)
+{
+    k_mutex_lock(&uplink_mutex, K_FOREVER);
+    *stats = uplink.stats;
+    k_mutex_unlock(&uplink_mutex);
+}
+
+#endif /* CONFIG_APP_UPLINK */
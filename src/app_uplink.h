@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef APP_UPLINK_H
+#define APP_UPLINK_H
+
+//  ========== includes ====================================================================
+#include <zephyr/kernel.h>
+
+#include "app_flash_log.h"
+
+//  ========== defines =====================================================================
+// frames travel as confirmed uplinks on one application port. every frame starts with a
+// type byte; integers are LEB128 varints, time deltas zigzag-encoded varints
+//   records:  type, seq, time_ms, then per record: len_flags, [seq gap], [dt_ms], payload
+//             (no seq gap nor dt for the first record, the frame header gives them)
+//   fragment: type, seq, offset, [time_ms, len_flags when offset is 0], payload slice
+#define UPLINK_FPORT                2
+#define UPLINK_FRAME_MAX            222     // largest EU868 application payload (DR4, DR5)
+#define UPLINK_LORAWAN_OVERHEAD     13      // MHDR + FHDR without options + FPort + MIC
+
+#define UPLINK_FRAME_RECORDS        0x00    // whole records
+#define UPLINK_FRAME_FRAGMENT       0x40    // slice of a record larger than a frame
+#define UPLINK_FRAME_LAST           0x20    // with FRAGMENT: last slice of the record
+
+// low bits of len_flags, the length is len_flags >> 2
+#define UPLINK_RECORD_STRIPPED      0x01    // Steim-2 start time left out, equal to time_ms
+#define UPLINK_RECORD_GAP           0x02    // a seq gap follows (records skipped in the log)
+
+//  ========== types =======================================================================
+// link to the network, the LoRaWAN stack or the local mock
+struct app_uplink_transport {
+    // largest application payload of the next uplink at the current data rate
+    uint8_t (*max_payload)(void);
+    // send one confirmed frame, 0 once the network server acknowledged it
+    int (*send)(uint8_t port, const uint8_t *frame, uint8_t length);
+};
+
+struct app_uplink_stats {
+    uint32_t sessions;          // calls to app_uplink_flush()
+    uint32_t frames;            // frames acknowledged
+    uint32_t fragments;         // of which record fragments
+    uint32_t records;           // records acknowledged, hence trimmable
+    uint32_t failures;          // sends without acknowledgement
+    uint32_t oversized;         // records too large for the uplink buffer, skipped
+    uint64_t record_bytes;      // record bytes in the acknowledged frames
+    uint64_t air_bytes;         // frame bytes plus LoRaWAN overhead, retries included
+};
+
+#if defined(CONFIG_APP_UPLINK_MOCK)
+struct app_uplink_mock_stats {
+    uint32_t frames;            // frames received
+    uint32_t dropped;           // frames lost on purpose
+    uint32_t records;           // records reassembled
+    uint32_t duplicates;        // records received twice
+    uint32_t errors;            // frames or records that failed to decode
+    uint64_t samples;           // samples decoded from the Steim-2 blocks
+    uint32_t last_seq;          // sequence number of the last record
+};
+#endif
+
+//  ========== prototypes ==================================================================
+int8_t app_uplink_init(const struct app_uplink_transport *transport);
+int app_uplink_flush(uint32_t max_frames);
+int8_t app_uplink_start(void);
+void app_uplink_get_stats(struct app_uplink_stats *stats);
+
+#if defined(CONFIG_APP_UPLINK_MOCK)
+const struct app_uplink_transport *app_uplink_mock_transport(void);
+void app_uplink_mock_set_dr(uint8_t dr);
+void app_uplink_mock_get_stats(struct app_uplink_mock_stats *stats);
+#endif
+
+#endif /* APP_UPLINK_H */
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2025
+ * Regis Rousseau
+ * Univ Lyon, INSA Lyon, Inria, CITI, EA3720
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+//  ========== includes ====================================================================
+// mock LoRaWAN transport for native_sim: plays the network server, reassembles the
+// records from the frames, decodes the Steim-2 blocks again and acknowledges
+#if defined(CONFIG_APP_UPLINK_MOCK)
+
+#include "app_uplink.h"
+#include "app_eeprom.h"
+
+#include <zephyr/sys/byteorder.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(app_uplink_mock, CONFIG_APP_UPLINK_LOG_LEVEL);
+
+//  ========== defines =====================================================================
+#define MOCK_RECORD_MAX             STEIM2_MAX_SIZE(STEIM2_MAX_BLOCK_SAMPLES)
+
+//  ========== globals =====================================================================
+// EU868 application payload by data rate, without MAC commands in FOpts
+static const uint8_t mock_eu868_payload[] = { 51, 51, 51, 115, 222, 222 };
+
+static struct {
+    uint8_t dr;
+    uint32_t sent;              // frames handed to the mock, drives the loss pattern
+    bool received;              // last_seq is valid
+    struct app_uplink_mock_stats stats;
+
+    // record being reassembled from its slices
+    bool frag_open;
+    uint32_t frag_seq;
+    uint64_t frag_time_ms;
+    uint8_t frag_flags;
+    size_t frag_length;
+    size_t frag_have;
+} mock = {
+    .dr = CONFIG_APP_UPLINK_MOCK_DR,
+};
+
+static uint8_t mock_record[MOCK_RECORD_MAX];
+static int16_t mock_samples[STEIM2_MAX_BLOCK_SAMPLES];
+
+//  ========== mock_get_varint =============================================================
+static bool mock_get_varint(const uint8_t *in, size_t length, size_t *pos, uint64_t *value)
+{
+    uint64_t v = 0;
+
+    for (int shift = 0; shift < 64 && *pos < length; shift += 7) {
+        uint8_t b = in[(*pos)++];
+        v |= (uint64_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+//  ========== mock_unzigzag ===============================================================
+static inline int64_t mock_unzigzag(uint64_t value)
+{
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+//  ========== mock_deliver ================================================================
+// one record of mock_record reassembled: put the Steim-2 start time back and decode the
+// block, its time must match the record time of the frame
+static void mock_deliver(uint32_t seq, uint64_t time_ms, size_t length, uint8_t flags)
+{
+    struct app_steim2_block_hdr hdr;
+    int count;
+
+    if (mock.received && (int32_t)(seq - mock.stats.last_seq) <= 0) {
+        mock.stats.duplicates++;
+        return;
+    }
+    mock.received = true;
+    mock.stats.last_seq = seq;
+
+    if (flags & UPLINK_RECORD_STRIPPED) {
+        memmove(&mock_record[16], &mock_record[8], length - 8);
+        sys_put_be64(time_ms, &mock_record[8]);
+        length += 8;
+    }
+    mock.stats.records++;
+
+    if (mock_record[0] != STEIM2_BLOCK_MAGIC) {
+        // not a sample block, nothing to check
+        return;
+    }
+    count = app_steim2_decode(mock_record, length, &hdr, mock_samples,
+                              ARRAY_SIZE(mock_samples));
+    if (count < 0 || hdr.start_time != time_ms) {
+        LOG_WRN("record %u does not decode. error: %d", seq, count);
+        mock.stats.errors++;
+        return;
+    }
+    mock.stats.samples += count;
+}
+
+//  ========== mock_receive ================================================================
+static bool mock_receive(const uint8_t *frame, size_t length)
+{
+    uint64_t seq, time_ms, len_flags, value, offset;
+    size_t pos = 1;
+    size_t n;
+
+    if (!mock_get_varint(frame, length, &pos, &seq)) {
+        return false;
+    }
+
+    if ((frame[0] & UPLINK_FRAME_FRAGMENT) == 0) {
+        if (!mock_get_varint(frame, length, &pos, &time_ms)) {
+            return false;
+        }
+        for (bool first = true; pos < length; first = false) {
+            if (!mock_get_varint(frame, length, &pos, &len_flags)) {
+                return false;
+            }
+            if (!first) {
+                seq++;
+                if (len_flags & UPLINK_RECORD_GAP) {
+                    if (!mock_get_varint(frame, length, &pos, &value)) {
+                        return false;
+                    }
+                    seq += value;
+                }
+                if (!mock_get_varint(frame, length, &pos, &value)) {
+                    return false;
+                }
+                time_ms += mock_unzigzag(value);
+            }
+            n = len_flags >> 2;
+            if (pos + n > length || n + 8 > sizeof(mock_record)) {
+                return false;
+            }
+            memcpy(mock_record, &frame[pos], n);
+            pos += n;
+            mock_deliver((uint32_t)seq, time_ms, n, len_flags & UPLINK_RECORD_STRIPPED);
+        }
+        return true;
+    }
+
+    if (!mock_get_varint(frame, length, &pos, &offset)) {
+        return false;
+    }
+    if (offset == 0) {
+        if (!mock_get_varint(frame, length, &pos, &time_ms) ||
+            !mock_get_varint(frame, length, &pos, &len_flags) ||
+            (len_flags >> 2) + 8 > sizeof(mock_record)) {
+            return false;
+        }
+        mock.frag_open = true;
+        mock.frag_seq = (uint32_t)seq;
+        mock.frag_time_ms = time_ms;
+        mock.frag_flags = len_flags & UPLINK_RECORD_STRIPPED;
+        mock.frag_length = len_flags >> 2;
+        mock.frag_have = 0;
+    }
+    n = length - pos;
+    if (!mock.frag_open || seq != mock.frag_seq || offset != mock.frag_have ||
+        mock.frag_have + n > mock.frag_length) {
+        return false;
+    }
+    memcpy(&mock_record[mock.frag_have], &frame[pos], n);
+    mock.frag_have += n;
+
+    if (frame[0] & UPLINK_FRAME_LAST) {
+        mock.frag_open = false;
+        if (mock.frag_have != mock.frag_length) {
+            return false;
+        }
+        mock_deliver(mock.frag_seq, mock.frag_time_ms, mock.frag_length, mock.frag_flags);
+    }
+    return true;
+}
+
+//  ========== mock_max_payload ============================================================
+static uint8_t mock_max_payload(void)
+{
+    return mock_eu868_payload[mock.dr];
+}
+
+//  ========== mock_send ===================================================================
+// frames lost on purpose are neither received nor acknowledged
+static int mock_send(uint8_t port, const uint8_t *frame, uint8_t length)
+{
+    if (port != UPLINK_FPORT || length == 0 || length > mock_max_payload()) {
+        mock.stats.errors++;
+        return -EMSGSIZE;
+    }
+
+    mock.sent++;
+    if (CONFIG_APP_UPLINK_MOCK_DROP_EVERY > 0 &&
+        (mock.sent % CONFIG_APP_UPLINK_MOCK_DROP_EVERY) == 0) {
+        mock.stats.dropped++;
+        return -ETIMEDOUT;
+    }
+
+    mock.stats.frames++;
+    if (!mock_receive(frame, length)) {
+        LOG_WRN("malformed uplink frame, type 0x%02X, %u bytes", frame[0], length);
+        mock.stats.errors++;
+    }
+    return 0;
+}
+
+static const struct app_uplink_transport mock_transport = {
+    .max_payload = mock_max_payload,
+    .send = mock_send,
+};
+
+//  ========== app_uplink_mock_transport ===================================================
+const struct app_uplink_transport *app_uplink_mock_transport(void)
+{
+    return &mock_transport;
+}
+
+//  ========== app_uplink_mock_set_dr ======================================================
+void app_uplink_mock_set_dr(uint8_t dr)
+{
+    mock.dr = MIN(dr, ARRAY_SIZE(mock_eu868_payload) - 1);
+}
+
+//  ========== app_uplink_mock_get_stats ===================================================
+void app_uplink_mock_get_stats(struct app_uplink_mock_stats *stats)
+{
+    *stats = mock.stats;
+}
+
+#endif /* CONFIG_APP_UPLINK_MOCK */
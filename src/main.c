@@ -10,43 +10,135 @@
 #include "app_adc.h"
 #include "app_rtc.h"
 #include "app_ds3231.h"
+#if defined(CONFIG_APP_DSP)
+#include "app_dsp.h"
+#endif
+#include "app_trigger.h"
+#if defined(CONFIG_APP_SPECTRUM)
+#include "app_spectrum.h"
+#endif
+#include "app_bench.h"
+#include "app_housekeeping.h"
+#if defined(CONFIG_APP_UPLINK)
+#include "app_uplink.h"
+#endif
+#if defined(CONFIG_APP_EXPORT)
+#include "app_export.h"
+#endif
 
 #include <zephyr/kernel.h>
 #include <stdbool.h>
 #include <stdio.h>
 
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(main, CONFIG_APP_LOG_LEVEL);
+
 //  ========== defines =====================================================================
-#define STACK_SIZE 2048
-#define PRIORITY   2
+#define GEO_ONESHOT_PERIOD_MS   5000    // one-shot reads without APP_ADC_STREAM
+
+// acquisition (ADC thread) > storage (below) > housekeeping (clock sync, flash flush)
+BUILD_ASSERT(CONFIG_APP_ACQ_PRIORITY < CONFIG_APP_STORAGE_PRIORITY,
+	     "the storage thread must not preempt the acquisition thread");
+BUILD_ASSERT(CONFIG_APP_STORAGE_PRIORITY < CONFIG_APP_HOUSEKEEPING_PRIORITY,
+	     "housekeeping must not preempt the storage thread");
 
 //  ========== globals =====================================================================
-bool rtc_thread_flag = true;
-void rtc_thread_func(void)
+// released by main() once the devices and the processing stages are initialized
+K_SEM_DEFINE(geo_start_sem, 0, 1);
+
+#if defined(CONFIG_APP_ADC_STREAM)
+//  ========== storage_busy ============================================================
+// sectors are erased ahead only while the storage thread keeps up with the acquisition
+static bool storage_busy(void)
 {
-	printk("periodic sync thread started\n");
-
-	const struct device *rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc0));
-	const struct device *ds3231_dev = DEVICE_DT_GET_ONE(maxim_ds3231);
-	while (rtc_thread_flag == true) {
-        printk("performing periodic action\n");
-    //    (void)app_rtc_periodic_sync(rtc_dev);
-	//	(void)app_ds3231_periodic_sync(ds3231_dev);
-        k_sleep(K_SECONDS(1));		
+	return app_adc_stream_queued() >= CONFIG_APP_FLASH_LOG_ERASE_BUSY_BLOCKS;
+}
+#endif
+
+#if defined(CONFIG_APP_TRIGGER) || defined(CONFIG_APP_SPECTRUM)
+// record log of the event blocks and spectral summaries
+static const struct device *geo_flash_dev;
+#endif
+
+#if defined(CONFIG_APP_TRIGGER)
+//  ========== event storage ===========================================================
+// only STA/LTA event windows reach the flash, one Steim-2 record per trigger block
+static int event_sink(const int16_t *samples, uint16_t count, int64_t start_us, bool first)
+{
+	if (first) {
+		LOG_INF("event triggered at %lld us", start_us);
 	}
+	return app_eeprom_store_block(geo_flash_dev, samples, count, (uint64_t)(start_us / 1000),
+				      TRIGGER_RATE_HZ, first);
 }
-K_THREAD_DEFINE(rtc_thread_id, STACK_SIZE, rtc_thread_func, NULL, NULL, NULL, PRIORITY, 0, 0);
+#endif
 
-//  ========== interrupt sub-routine =================================================================
-void geo_work_handler(struct k_work *work_geo)
+#if defined(CONFIG_APP_SPECTRUM)
+//  ========== spectrum storage ========================================================
+// one summary record per period, logged whether or not an event was recorded
+static int spectrum_sink(const struct app_spectrum_summary *summary)
+{
+	return app_eeprom_store_spectrum(geo_flash_dev, summary);
+}
+#endif
+
+#if defined(CONFIG_APP_TRIGGER) || defined(CONFIG_APP_SPECTRUM)
+// vertical component (first io-channel) of a multi-channel block, the analysis runs on it
+static int16_t geo_vertical[ADC_STREAM_BLOCK_SAMPLES];
+#endif
+
+#if defined(CONFIG_APP_DSP)
+// filter state of the geophone channel
+static struct app_dsp_filter geo_filter;
+#endif
+
+#if defined(CONFIG_APP_TRIGGER) || defined(CONFIG_APP_SPECTRUM)
+//  ========== geo_process_block =======================================================
+// timestamp, filter, then run the detector and the spectral analysis over one streamed
+// block. a single-channel block is filtered in place, the samples are not copied until
+// the trigger keeps them
+static void geo_process_block(struct app_adc_block *block)
+{
+	// the block is timestamped at its last sample, by the disciplined clock
+	int64_t end_us = app_clock_at_us((int64_t)k_ticks_to_us_floor64(block->uptime_ticks));
+	int64_t start_us = end_us - ((int64_t)(block->count - 1) * ADC_STREAM_INTERVAL_US);
+	int16_t *samples = block->samples;
+	int count = block->count;
+
+	if (block->channels > 1) {
+		count = app_adc_block_get_channel(block, 0, geo_vertical, ARRAY_SIZE(geo_vertical));
+		samples = geo_vertical;
+	}
+
+#if defined(CONFIG_APP_DSP)
+	// DC removal and decimation, outputs lag their input by the FIR delay
+	uint16_t first_index;
+	count = app_dsp_filter_process(&geo_filter, samples, count, samples, count, &first_index);
+	start_us += ((int64_t)first_index * ADC_STREAM_INTERVAL_US) - DSP_DELAY_US;
+#endif
+	if (count > 0) {
+#if defined(CONFIG_APP_TRIGGER)
+		app_trigger_process(samples, count, start_us);
+#endif
+#if defined(CONFIG_APP_SPECTRUM)
+		app_spectrum_process(samples, count, start_us);
+#endif
+	}
+}
+#endif
+
+#if !defined(CONFIG_APP_ADC_STREAM)
+//  ========== geo_sample ==============================================================
+static void geo_sample(void)
 {
 // 	const struct device *rom_dev = DEVICE_DT_GET(SPI_FLASH_DEVICE);
 
 // 	printk("ADC handler called\n");
 // 	app_eeprom_handler(rom_dev);
 
-	printk("test only sensor connected on ADC P0.03\n");
+	LOG_INF("test only sensor connected on ADC P0.03");
 	int16_t value = app_nrf52_get_adc();
-	printk("return velocity: %d mV\n", value);
+	LOG_INF("return velocity: %d mV", value);
 
 	// printk("test only internal and DS3231 RTC device\n");
 
@@ -56,13 +148,74 @@ void geo_work_handler(struct k_work *work_geo)
 	// uint64_t timestamp_ds3231 = app_ds3231_get_time();
 	// printk("timestamp in ms (DS3231): %llu\n", timestamp_ds3231);
 }
-K_WORK_DEFINE(geo_work, geo_work_handler);
 
-void geo_timer_handler(struct k_timer *geo_dum)
+//  ========== geo_acq_thread ==========================================================
+// one-shot reads on a fixed period, in the acquisition thread rather than on the shared
+// system workqueue
+static void geo_acq_thread(void *p1, void *p2, void *p3)
 {
-	k_work_submit(&geo_work);
+	k_sem_take(&geo_start_sem, K_FOREVER);
+
+	int64_t due = k_uptime_get();
+	while (1) {
+		geo_sample();
+		due += GEO_ONESHOT_PERIOD_MS;
+		if (k_uptime_get() > due) {
+			LOG_WRN("one-shot read missed its deadline by %lld ms", k_uptime_get() - due);
+		}
+		k_sleep(K_TIMEOUT_ABS_MS(due));
+	}
 }
-K_TIMER_DEFINE(geo_timer, geo_timer_handler, NULL);
+K_THREAD_DEFINE(geo_acq_tid, CONFIG_APP_ACQ_STACK_SIZE, geo_acq_thread, NULL, NULL, NULL,
+		CONFIG_APP_ACQ_PRIORITY, 0, 0);
+#else
+//  ========== storage_thread ==========================================================
+// consumes the blocks queued by the acquisition thread: filter, trigger and flash. the
+// ring bounds the queue, a consumer that falls behind shows up as ADC overruns
+static void storage_thread(void *p1, void *p2, void *p3)
+{
+	struct app_adc_block *block;
+	struct app_adc_stream_stats stats;
+	struct app_housekeeping_stats hk_stats;
+
+	k_sem_take(&geo_start_sem, K_FOREVER);
+
+	while (1) {
+		block = app_adc_stream_get_block(K_SECONDS(1));
+		if (!block) {
+			LOG_WRN("no ADC block received");
+			continue;
+		}
+		int16_t first_mv = app_nrf52_adc_to_mv(block->samples[0]);
+		uint32_t seq = block->seq;
+
+#if defined(CONFIG_APP_TRIGGER) || defined(CONFIG_APP_SPECTRUM)
+		geo_process_block(block);
+#endif
+		app_adc_stream_release_block(block);
+
+		// report once per second of samples
+		if ((seq % (ADC_STREAM_RATE_HZ / ADC_STREAM_BLOCK_SAMPLES + 1)) == 0) {
+			app_adc_stream_get_stats(&stats);
+			LOG_INF("block %u: first %d mV, rate %u Hz, blocks %u, overruns %u, pool min %u",
+			       seq, first_mv, stats.rate_hz, stats.blocks, stats.overruns,
+			       stats.pool_free_min);
+			app_housekeeping_get_stats(&hk_stats);
+			LOG_INF("queue max %u of %u, %u late ADC reads, %u late syncs (max %u ms)",
+				stats.queue_max, ADC_STREAM_POOL_BLOCKS, stats.late, hk_stats.late,
+				hk_stats.late_ms_max);
+#if defined(CONFIG_APP_TRIGGER)
+			struct app_trigger_stats tstats;
+			app_trigger_get_stats(&tstats);
+			LOG_INF("trigger: %u events, stored %llu of %llu samples", tstats.events,
+			       tstats.samples_out, tstats.samples_in);
+#endif
+		}
+	}
+}
+K_THREAD_DEFINE(storage_tid, CONFIG_APP_STORAGE_STACK_SIZE, storage_thread, NULL, NULL, NULL,
+		CONFIG_APP_STORAGE_PRIORITY, 0, 0);
+#endif /* CONFIG_APP_ADC_STREAM */
 
 // ========== main ===================================================================================
 int8_t main(void)
@@ -70,25 +223,37 @@ int8_t main(void)
 	// initialize DS3231 RTC device via I2C (Pins: SDA -> P0.09, SCL -> P0.0)
 	const struct device *ds3231_dev = app_ds3231_init();
     if (!ds3231_dev) {
-        printk("failed to initialize RTC device\n");
+        LOG_ERR("failed to initialize RTC device");
         return 0;
     } else {
-		app_ds3231_set_time(ds3231_dev, 1721390400); // set to "2024-07-19 12:00:00" UTC
+		// the time is only set when the unit is provisioned: afterwards the DS3231 keeps
+		// it across resets and the clock discipline resumes from its last checkpoint
+		if (app_clock_load() == -ENOENT) {
+			LOG_INF("provisioning the DS3231 time");
+			app_ds3231_set_time(ds3231_dev, CONFIG_APP_CLOCK_PROVISION_TIME);
+		}
+
+		// optional: sub-millisecond syncs on the 1 Hz square wave, if it is wired
+		(void)app_ds3231_sqw_init(ds3231_dev);
+
+		// first sync right away, timestamps are valid from here on
+		(void)app_ds3231_periodic_sync(ds3231_dev);
 	}
 
 	// initialize on-board RTC of MDBT50Q
 	const struct device *rtc_dev = app_rtc_init();
     if (!rtc_dev) {
-        printk("failed to initialize RTC device\n");
+        LOG_ERR("failed to initialize RTC device");
         return 0;
-    } else {
-		app_rtc_set_time(rtc_dev, 1721050200000ULL); // e.g., for "2024-07-15 12:30:00 UTC" in ms
+    } else if (app_clock_now_ms() > 0) {
+		// follows the disciplined time
+		app_rtc_set_time(rtc_dev, app_clock_now_ms());
 	}
 
 	// initialize ADC device
 	int8_t ret = app_nrf52_adc_init();
 	if (ret != 1) {
-		printk("failed to initialize ADC device\n");
+		LOG_ERR("failed to initialize ADC device");
 		return 0;
 	}
 
@@ -96,16 +261,70 @@ int8_t main(void)
 	const struct device *flash_dev = DEVICE_DT_GET(SPI_FLASH_DEVICE);
 	ret = app_eeprom_init(flash_dev);
 	if (ret != 1) {
-		printk("failed to initialize QSPI Flash device\n");
+		LOG_ERR("failed to initialize QSPI Flash device");
 		return 0;
 	}
 
-	printk("ADC nRF52 and RTC DS3231 Example\n");
+	// the log sectors are erased in the background, ahead of the appends
+#if defined(CONFIG_APP_ADC_STREAM)
+	(void)app_flash_log_erase_ahead(CONFIG_APP_FLASH_LOG_ERASE_AHEAD, storage_busy);
+#else
+	(void)app_flash_log_erase_ahead(CONFIG_APP_FLASH_LOG_ERASE_AHEAD, NULL);
+#endif
+
+	LOG_INF("ADC nRF52 and RTC DS3231 Example");
+
+#if defined(CONFIG_APP_EXPORT)
+	// binary dumps of the recovered log on request of scripts/export_rx.py
+	app_export_start();
+#endif
+
+#if defined(CONFIG_APP_BENCH)
+	// benchmark build: measure the pipeline and stop there
+#if defined(CONFIG_APP_DSP)
+	(void)app_dsp_init();
+#endif
+	(void)app_bench_run(ds3231_dev);
+	return 0;
+#endif
+
+#if defined(CONFIG_APP_ADC_STREAM)
+	// continuous acquisition: the storage thread consumes the blocks as they fill
+	ret = app_adc_stream_start();
+	if (ret < 0) {
+		LOG_ERR("failed to start ADC streaming. error: %d", ret);
+		return 0;
+	}
+	for (uint8_t ch = 0; ch < ADC_CHANNELS_NB; ch++) {
+		LOG_INF("ADC channel %u sampled %u ns into the scan", ch,
+			app_adc_channel_skew_ns(ch));
+	}
+
+#if defined(CONFIG_APP_DSP)
+	(void)app_dsp_init();
+	app_dsp_filter_init(&geo_filter);
+#endif
+#if defined(CONFIG_APP_TRIGGER) || defined(CONFIG_APP_SPECTRUM)
+	geo_flash_dev = flash_dev;
+#endif
+#if defined(CONFIG_APP_TRIGGER)
+	(void)app_trigger_init(event_sink);
+#endif
+#if defined(CONFIG_APP_SPECTRUM)
+	(void)app_spectrum_init(spectrum_sink);
+#endif
+#endif
+
+	// periodic clock discipline against the DS3231, on the housekeeping queue
+	(void)app_housekeeping_start_sync(ds3231_dev);
 
-	// enable periodic rtc sync thread
-	rtc_thread_flag = false;
+#if defined(CONFIG_APP_UPLINK_MOCK)
+	// daily uplink of the record log, to the local mock network on native_sim
+	(void)app_uplink_init(app_uplink_mock_transport());
+	(void)app_uplink_start();
+#endif
 
-	// start the timer to trigger the interrupt subroutine every 30 seconds
-	k_timer_start(&geo_timer, K_NO_WAIT, K_MSEC(5000));
+	// hand over to the acquisition and storage threads
+	k_sem_give(&geo_start_sem);
 	return 0;
 }
\ No newline at end of file